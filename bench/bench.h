@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+// a generated scene, and what it's meant to stress
+struct PTBenchScenario
+{
+    std::string name;
+    std::string description;
+    std::string scene_path;
+};
+
+// one phase of the frame over all measured frames, in milliseconds
+struct PTBenchPhase
+{
+    float mean = 0.0f;
+    float median = 0.0f;
+    float p95 = 0.0f;
+    float max = 0.0f;
+};
+
+struct PTBenchResult
+{
+    std::string name;
+    float load_ms = 0.0f;
+    uint32_t frames = 0;
+    // keyed by phase name (update, record, submit, gpu, frame)
+    std::map<std::string, PTBenchPhase> phases;
+};
+
+/**
+ * @brief write out every scenario's scene (and any meshes they need) into a directory. the output only depends on
+ * the code, so the same scenes come out every time
+ *
+ * @returns the scenarios, in the order they should be run
+ */
+std::vector<PTBenchScenario> benchGenerateScenarios(const std::string& directory);
+
+PTBenchPhase benchSummarise(std::vector<float> samples);
+
+bool benchWriteReport(const std::string& path, const std::vector<PTBenchResult>& results, uint32_t frames, float timestep);
+/**
+ * @brief read a report back, flattened into "scenario/phase/statistic" (or "scenario/load_ms") -> value
+ */
+bool benchReadReport(const std::string& path, std::map<std::string, double>& metrics);
+/**
+ * @brief print how each metric changed against a baseline report. a metric regresses if it got slower by more than
+ * the threshold (as a fraction of the baseline), ignoring changes too small to be anything but noise
+ *
+ * @returns the number of regressions
+ */
+int benchCompare(const std::map<std::string, double>& baseline, const std::map<std::string, double>& current, float threshold);
+
+// times the pixel format conversion kernels on a 4k frame and prints their throughput
+void benchKernels();
+/**
+ * @brief check the pixel format conversion kernels against plain per-pixel versions, over every tail length, at
+ * misaligned addresses and in place
+ *
+ * @returns the number of mismatches
+ */
+int benchCheckKernels();
\ No newline at end of file
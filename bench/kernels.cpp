@@ -0,0 +1,124 @@
+#include "bench.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "swizzle.h"
+#include "profiler.h"
+
+using namespace std;
+
+// a 4k frame, which is the size a screenshot would be
+static const size_t KERNEL_PIXELS = 3840 * 2160;
+static const int KERNEL_REPEATS = 20;
+// the vector loops handle 4 or 8 pixels at a time, so this covers every tail length many times over
+static const size_t CHECK_MAX_PIXELS = 300;
+// written around the output to catch a kernel storing past the end
+static const uint8_t CHECK_CANARY = 0xcd;
+
+template <typename F>
+static float bestTimeMs(F kernel)
+{
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < KERNEL_REPEATS; r++)
+    {
+        uint64_t start = profileNow();
+        kernel();
+        best = min(best, profileNow() - start);
+    }
+    return static_cast<float>(best) / 1000000.0f;
+}
+
+static void printKernel(const char* name, float ms, size_t bytes)
+{
+    cout << "    " << name << ": " << ms << "ms (" << (static_cast<float>(bytes) / (ms * 1000000.0f)) << " GB/s)" << endl;
+}
+
+void benchKernels()
+{
+    vector<uint8_t> rgba(KERNEL_PIXELS * 4);
+    vector<uint8_t> bgr(KERNEL_PIXELS * 3);
+    vector<uint8_t> out(KERNEL_PIXELS * 4);
+    for (size_t i = 0; i < rgba.size(); i++)
+        rgba[i] = static_cast<uint8_t>(i * 31);
+    for (size_t i = 0; i < bgr.size(); i++)
+        bgr[i] = static_cast<uint8_t>(i * 17);
+
+    cout << "pixel kernels (" << swizzleKernelName() << "), best of " << KERNEL_REPEATS << " over 3840x2160:" << endl;
+    printKernel("rgba -> bgra", bestTimeMs([&]() { swizzleRGBAToBGRA(rgba.data(), out.data(), KERNEL_PIXELS); }), KERNEL_PIXELS * 8);
+    printKernel("rgba -> bgra in place", bestTimeMs([&]() { swizzleRGBAToBGRA(out.data(), out.data(), KERNEL_PIXELS); }), KERNEL_PIXELS * 8);
+    printKernel("bgr -> rgba", bestTimeMs([&]() { expandBGRToRGBA(bgr.data(), out.data(), KERNEL_PIXELS); }), KERNEL_PIXELS * 7);
+}
+
+// plain per-pixel versions to check the kernels against
+static void referenceRGBAToBGRA(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i++)
+    {
+        uint8_t pixel[4] = { src[(i * 4) + 2], src[(i * 4) + 1], src[(i * 4) + 0], src[(i * 4) + 3] };
+        copy(pixel, pixel + 4, dst + (i * 4));
+    }
+}
+
+static void referenceBGRToRGBA(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i++)
+    {
+        dst[(i * 4) + 0] = src[(i * 3) + 2];
+        dst[(i * 4) + 1] = src[(i * 3) + 1];
+        dst[(i * 4) + 2] = src[(i * 3) + 0];
+        dst[(i * 4) + 3] = 255;
+    }
+}
+
+// runs a kernel writing out_bytes into a buffer offset by `offset` and padded with canaries, and compares the result
+// (and the padding) to the expected output
+template <typename F>
+static bool checkOutput(const char* name, size_t pixels, size_t offset, const vector<uint8_t>& expected, F kernel)
+{
+    vector<uint8_t> out(offset + expected.size() + 16, CHECK_CANARY);
+    kernel(out.data() + offset);
+    bool ok = equal(expected.begin(), expected.end(), out.begin() + offset)
+        && all_of(out.begin(), out.begin() + offset, [](uint8_t b) { return b == CHECK_CANARY; })
+        && all_of(out.begin() + offset + expected.size(), out.end(), [](uint8_t b) { return b == CHECK_CANARY; });
+    if (!ok)
+        cout << "    " << name << " mismatch with " << pixels << " pixels at offset " << offset << endl;
+    return ok;
+}
+
+int benchCheckKernels()
+{
+    int failures = 0;
+    for (size_t pixels = 0; pixels < CHECK_MAX_PIXELS; pixels++)
+    {
+        // misaligned sources and destinations, since rows of a bmp or tga don't start anywhere in particular
+        for (size_t offset = 0; offset < 4; offset++)
+        {
+            vector<uint8_t> rgba(offset + (pixels * 4));
+            vector<uint8_t> bgr(offset + (pixels * 3));
+            for (size_t i = 0; i < rgba.size(); i++)
+                rgba[i] = static_cast<uint8_t>((i * 31) + pixels);
+            for (size_t i = 0; i < bgr.size(); i++)
+                bgr[i] = static_cast<uint8_t>((i * 17) + pixels);
+
+            vector<uint8_t> expected(pixels * 4);
+            referenceRGBAToBGRA(rgba.data() + offset, expected.data(), pixels);
+            if (!checkOutput("rgba -> bgra", pixels, offset, expected, [&](uint8_t* dst) { swizzleRGBAToBGRA(rgba.data() + offset, dst, pixels); }))
+                failures++;
+            if (!checkOutput("rgba -> bgra in place", pixels, offset, expected, [&](uint8_t* dst)
+                {
+                    copy(rgba.begin() + offset, rgba.end(), dst);
+                    swizzleRGBAToBGRA(dst, dst, pixels);
+                }))
+                failures++;
+
+            referenceBGRToRGBA(bgr.data() + offset, expected.data(), pixels);
+            if (!checkOutput("bgr -> rgba", pixels, offset, expected, [&](uint8_t* dst) { expandBGRToRGBA(bgr.data() + offset, dst, pixels); }))
+                failures++;
+        }
+    }
+
+    cout << "pixel kernels (" << swizzleKernelName() << "): " << (failures == 0 ? "all match" : to_string(failures) + " mismatches") << " against the reference for 0-" << (CHECK_MAX_PIXELS - 1) << " pixels" << endl;
+    return failures;
+}
\ No newline at end of file
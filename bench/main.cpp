@@ -0,0 +1,156 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "application.h"
+#include "debug.h"
+#include "bench.h"
+
+using namespace std;
+
+// the first frames are dominated by pipeline creation and first-use costs, and the gpu times lag a couple of frames
+static const uint32_t WARMUP_FRAMES = 10;
+
+// usage: planetarium_bench [--frames n] [--timestep seconds] [--out report.json] [--baseline baseline.json]
+//                          [--threshold fraction] [--scenario name] [--scene-dir directory] [--kernels]
+//                          [--kernels-check]
+int main(int argc, char* argv[])
+{
+    uint32_t frames = 300;
+    float timestep = 1.0f / 60.0f;
+    string report_path = "bin/bench/report.json";
+    string baseline_path = "";
+    float threshold = 0.1f;
+    string only_scenario = "";
+    string scene_directory = "bin/bench/";
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        // just the cpu kernel microbenchmarks, no scenes
+        if (arg == "--kernels")
+        {
+            benchKernels();
+            return EXIT_SUCCESS;
+        }
+        if (arg == "--kernels-check")
+            return (benchCheckKernels() == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+        if (i + 1 >= argc)
+        {
+            cerr << "missing value for '" << arg << "'" << endl;
+            return EXIT_FAILURE;
+        }
+        string value = argv[++i];
+        try
+        {
+            if (arg == "--frames")
+                frames = static_cast<uint32_t>(stoul(value));
+            else if (arg == "--timestep")
+                timestep = stof(value);
+            else if (arg == "--out")
+                report_path = value;
+            else if (arg == "--baseline")
+                baseline_path = value;
+            else if (arg == "--threshold")
+                threshold = stof(value);
+            else if (arg == "--scenario")
+                only_scenario = value;
+            else if (arg == "--scene-dir")
+                scene_directory = value;
+            else
+            {
+                cerr << "unrecognised argument '" << arg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            cerr << "invalid value for '" << arg << "'" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    vector<PTBenchScenario> scenarios;
+    try
+    {
+        scenarios = benchGenerateScenarios(scene_directory);
+    }
+    catch (const std::exception& e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    // each scenario gets a fresh application (and so a fresh device and resource manager), so nothing loaded by one
+    // makes the next look faster than it is
+    vector<PTBenchResult> results;
+    for (const PTBenchScenario& scenario : scenarios)
+    {
+        if (!only_scenario.empty() && scenario.name != only_scenario)
+            continue;
+
+        cout << "running " << scenario.name << " (" << scenario.description << ")..." << endl;
+        debugInit(false);
+
+        PTHeadlessSettings headless;
+        headless.enabled = true;
+        headless.frame_count = frames + WARMUP_FRAMES;
+        headless.timestep = timestep;
+        PTApplication app = PTApplication(640, 480, scenario.scene_path, headless);
+        try
+        {
+            app.start();
+        }
+        catch (const std::exception& e)
+        {
+            debugLog("FATAL ERROR: " + string(e.what()));
+            debugDeinit();
+            cerr << scenario.name << " failed: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+
+        const vector<PTFrameStats>& stats = app.getFrameStats();
+        vector<float> update, record, submit, gpu, frame;
+        for (size_t f = WARMUP_FRAMES; f < stats.size(); f++)
+        {
+            update.push_back(stats[f].update_ms);
+            record.push_back(stats[f].record_ms);
+            submit.push_back(stats[f].submit_ms);
+            gpu.push_back(stats[f].gpu_ms);
+            frame.push_back(stats[f].frame_ms);
+        }
+
+        PTBenchResult result;
+        result.name = scenario.name;
+        result.load_ms = app.getLoadTime();
+        result.frames = static_cast<uint32_t>(frame.size());
+        result.phases["update"] = benchSummarise(update);
+        result.phases["record"] = benchSummarise(record);
+        result.phases["submit"] = benchSummarise(submit);
+        result.phases["gpu"] = benchSummarise(gpu);
+        result.phases["frame"] = benchSummarise(frame);
+        results.push_back(result);
+
+        cout << "    load " << result.load_ms << "ms, median frame " << result.phases["frame"].median << "ms" << endl;
+    }
+
+    if (!benchWriteReport(report_path, results, frames, timestep))
+        return EXIT_FAILURE;
+    cout << "wrote " << report_path << endl;
+
+    if (baseline_path.empty())
+        return EXIT_SUCCESS;
+
+    map<string, double> baseline;
+    map<string, double> current;
+    if (!benchReadReport(baseline_path, baseline) || !benchReadReport(report_path, current))
+        return EXIT_FAILURE;
+
+    int regressions = benchCompare(baseline, current, threshold);
+    if (regressions > 0)
+    {
+        cout << regressions << " regression(s) against " << baseline_path << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "no regressions against " << baseline_path << endl;
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
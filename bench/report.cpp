@@ -0,0 +1,270 @@
+#include "bench.h"
+
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <format>
+#include <algorithm>
+#include <iostream>
+#include <cctype>
+
+using namespace std;
+
+// changes smaller than this are noise, however large they are relatively
+static const double NOISE_FLOOR_MS = 0.05;
+
+PTBenchPhase benchSummarise(vector<float> samples)
+{
+    PTBenchPhase phase;
+    if (samples.empty())
+        return phase;
+
+    sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (float sample : samples)
+        total += sample;
+
+    phase.mean = static_cast<float>(total / samples.size());
+    phase.median = samples[samples.size() / 2];
+    phase.p95 = samples[min(samples.size() - 1, (samples.size() * 95) / 100)];
+    phase.max = samples.back();
+    return phase;
+}
+
+bool benchWriteReport(const string& path, const vector<PTBenchResult>& results, uint32_t frames, float timestep)
+{
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+        filesystem::create_directories(parent);
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "unable to write benchmark report '" << path << "'" << endl;
+        return false;
+    }
+
+    file << "{\n";
+    file << format("    \"frames\": {},\n    \"timestep\": {:.6f},\n    \"scenarios\":\n    {{", frames, timestep);
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        const PTBenchResult& result = results[r];
+        file << (r == 0 ? "\n" : ",\n");
+        file << format("        \"{}\":\n        {{\n            \"frames\": {},\n            \"load_ms\": {:.4f}", result.name, result.frames, result.load_ms);
+        for (const auto& [name, phase] : result.phases)
+            file << format(",\n            \"{}\": {{ \"mean\": {:.4f}, \"median\": {:.4f}, \"p95\": {:.4f}, \"max\": {:.4f} }}", name, phase.mean, phase.median, phase.p95, phase.max);
+        file << "\n        }";
+    }
+    file << "\n    }\n}\n";
+    return true;
+}
+
+// just enough json to read reports back in. every number ends up in the map under the path of keys leading to it
+class PTBenchJSONReader
+{
+private:
+    const string& text;
+    size_t position = 0;
+
+public:
+    PTBenchJSONReader(const string& _text) : text(_text) { }
+
+    bool read(map<string, double>& out)
+    {
+        if (!readValue("", out))
+            return false;
+        skipWhitespace();
+        return position == text.size();
+    }
+
+private:
+    void skipWhitespace()
+    {
+        while (position < text.size() && isspace(static_cast<unsigned char>(text[position])))
+            position++;
+    }
+
+    bool readString(string& out)
+    {
+        skipWhitespace();
+        if (position >= text.size() || text[position] != '"')
+            return false;
+        position++;
+        out.clear();
+        while (position < text.size() && text[position] != '"')
+        {
+            if (text[position] == '\\' && position + 1 < text.size())
+                position++;
+            out.push_back(text[position++]);
+        }
+        if (position >= text.size())
+            return false;
+        position++;
+        return true;
+    }
+
+    bool readValue(const string& key, map<string, double>& out)
+    {
+        skipWhitespace();
+        if (position >= text.size())
+            return false;
+
+        char c = text[position];
+        if (c == '{')
+        {
+            position++;
+            skipWhitespace();
+            if (position < text.size() && text[position] == '}')
+            {
+                position++;
+                return true;
+            }
+            while (true)
+            {
+                string name;
+                if (!readString(name))
+                    return false;
+                skipWhitespace();
+                if (position >= text.size() || text[position] != ':')
+                    return false;
+                position++;
+                if (!readValue(key.empty() ? name : key + "/" + name, out))
+                    return false;
+                skipWhitespace();
+                if (position < text.size() && text[position] == ',')
+                {
+                    position++;
+                    continue;
+                }
+                if (position < text.size() && text[position] == '}')
+                {
+                    position++;
+                    return true;
+                }
+                return false;
+            }
+        }
+        else if (c == '[')
+        {
+            position++;
+            size_t index = 0;
+            skipWhitespace();
+            if (position < text.size() && text[position] == ']')
+            {
+                position++;
+                return true;
+            }
+            while (true)
+            {
+                if (!readValue(key + "/" + to_string(index++), out))
+                    return false;
+                skipWhitespace();
+                if (position < text.size() && text[position] == ',')
+                {
+                    position++;
+                    continue;
+                }
+                if (position < text.size() && text[position] == ']')
+                {
+                    position++;
+                    return true;
+                }
+                return false;
+            }
+        }
+        else if (c == '"')
+        {
+            string ignored;
+            return readString(ignored);
+        }
+        else if (text.compare(position, 4, "true") == 0 || text.compare(position, 4, "null") == 0)
+        {
+            position += 4;
+            return true;
+        }
+        else if (text.compare(position, 5, "false") == 0)
+        {
+            position += 5;
+            return true;
+        }
+
+        size_t end = position;
+        while (end < text.size() && (isdigit(static_cast<unsigned char>(text[end])) || text[end] == '-' || text[end] == '+' || text[end] == '.' || text[end] == 'e' || text[end] == 'E'))
+            end++;
+        if (end == position)
+            return false;
+        try
+        {
+            out[key] = stod(text.substr(position, end - position));
+        }
+        catch (const exception&)
+        {
+            return false;
+        }
+        position = end;
+        return true;
+    }
+};
+
+bool benchReadReport(const string& path, map<string, double>& metrics)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "unable to open benchmark report '" << path << "'" << endl;
+        return false;
+    }
+    stringstream stream;
+    stream << file.rdbuf();
+    string text = stream.str();
+
+    map<string, double> all;
+    if (!PTBenchJSONReader(text).read(all))
+    {
+        cerr << "malformed benchmark report '" << path << "'" << endl;
+        return false;
+    }
+
+    // only the per-scenario timings are worth comparing
+    metrics.clear();
+    const string prefix = "scenarios/";
+    for (const auto& [key, value] : all)
+    {
+        if (key.compare(0, prefix.size(), prefix) == 0 && !key.ends_with("/frames"))
+            metrics[key.substr(prefix.size())] = value;
+    }
+    return true;
+}
+
+int benchCompare(const map<string, double>& baseline, const map<string, double>& current, float threshold)
+{
+    int regressions = 0;
+    cout << format("{:<40} {:>12} {:>12} {:>9}", "metric", "baseline", "current", "change") << endl;
+    for (const auto& [key, value] : current)
+    {
+        // maxima are a single frame, so they're too noisy to judge anything by
+        if (key.ends_with("/max"))
+            continue;
+
+        auto it = baseline.find(key);
+        if (it == baseline.end())
+        {
+            cout << format("{:<40} {:>12} {:>12.4f} {:>9}", key, "-", value, "new") << endl;
+            continue;
+        }
+
+        double before = it->second;
+        double change = (before > 0.0) ? (value - before) / before : 0.0;
+        bool regressed = (value - before) > NOISE_FLOOR_MS && change > threshold;
+        if (regressed)
+            regressions++;
+        cout << format("{:<40} {:>12.4f} {:>12.4f} {:>+8.1f}%{}", key, before, value, change * 100.0, regressed ? "  REGRESSION" : "") << endl;
+    }
+
+    for (const auto& [key, value] : baseline)
+    {
+        if (!current.contains(key) && !key.ends_with("/max"))
+            cout << format("{:<40} {:>12.4f} {:>12} {:>9}", key, value, "-", "missing") << endl;
+    }
+
+    return regressions;
+}
\ No newline at end of file
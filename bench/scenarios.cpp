@@ -0,0 +1,158 @@
+#include "bench.h"
+
+#include <fstream>
+#include <format>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+// all the scenarios look down -z from the origin, like the demo scene
+static const char* CAMERA_LINE = "CameraNode(position = [0, 0, 0], far_clip = 500.0);\n";
+
+static void writeFile(const string& path, const string& content)
+{
+    ofstream file(path);
+    if (!file.is_open())
+        throw runtime_error("unable to write benchmark file '" + path + "'");
+    file << content;
+}
+
+// lots of separate draws of the same mesh, which is mostly draw queue sorting and per-draw recording cost
+static PTBenchScenario generateManyMeshes(const string& directory)
+{
+    const int side = 64;
+    string scene = "Resource(mesh, \"res/engine/mesh/suzanne.obj\") : monkey;\n\n";
+    scene += CAMERA_LINE;
+    scene += "LightNode(colour = [1, 1, 1], position = [0, 10, -20], directional = 0, brightness = 4.0);\n\n";
+    for (int y = 0; y < side; y++)
+    {
+        for (int x = 0; x < side; x++)
+            scene += format("MeshNode(data = @monkey, position = [{}, {}, {}], scale = [0.4, 0.4, 0.4]);\n", (x - (side / 2)) * 1.2f, (y - (side / 2)) * 1.2f, -40.0f - ((x + y) % 8));
+    }
+
+    string path = directory + "many_meshes.ptscn";
+    writeFile(path, scene);
+    return PTBenchScenario{ "many_meshes", to_string(side * side) + " mesh nodes sharing one mesh", path };
+}
+
+// long parent chains, so every draw has to walk a deep transform hierarchy
+static PTBenchScenario generateDeepHierarchy(const string& directory)
+{
+    const int chains = 16;
+    const int depth = 64;
+    string scene = "Resource(mesh, \"res/engine/mesh/cube.obj\") : cube;\n\n";
+    scene += CAMERA_LINE;
+    scene += "LightNode(colour = [1, 1, 1], position = [0, 10, -20], directional = 0, brightness = 4.0);\n\n";
+    for (int c = 0; c < chains; c++)
+    {
+        scene += format("Node(position = [{}, -8, -30])\n{{\n", (c - (chains / 2)) * 2.0f);
+        for (int d = 0; d < depth; d++)
+        {
+            string indent(d + 1, '\t');
+            scene += indent + "MeshNode(data = @cube, scale = [0.2, 0.2, 0.2]);\n";
+            scene += indent + format("Node(position = [0, 0.25, {}], scale = [0.99, 0.99, 0.99])\n", (d % 2 == 0) ? -0.1f : 0.1f);
+            scene += indent + "{\n";
+        }
+        for (int d = depth; d >= 0; d--)
+            scene += string(d, '\t') + "};\n";
+    }
+
+    string path = directory + "deep_hierarchy.ptscn";
+    writeFile(path, scene);
+    return PTBenchScenario{ "deep_hierarchy", to_string(chains) + " chains of " + to_string(depth) + " nested nodes", path };
+}
+
+// far more lights than the scene uniforms hold, so every frame sorts them all to pick the closest
+static PTBenchScenario generateManyLights(const string& directory)
+{
+    const int lights = 1024;
+    const int meshes = 256;
+    string scene = "Resource(mesh, \"res/engine/mesh/sphere.obj\") : sphere;\n\n";
+    scene += CAMERA_LINE;
+    for (int i = 0; i < lights; i++)
+    {
+        // a cheap repeatable scatter, no rng needed
+        float x = static_cast<float>((i * 37) % 64) - 32.0f;
+        float y = static_cast<float>((i * 11) % 32) - 16.0f;
+        float z = -10.0f - static_cast<float>((i * 23) % 80);
+        scene += format("LightNode(colour = [{}, {}, {}], position = [{}, {}, {}], directional = 0, brightness = 2.0);\n", (i % 3) * 0.5f, ((i + 1) % 3) * 0.5f, ((i + 2) % 3) * 0.5f, x, y, z);
+    }
+    for (int i = 0; i < meshes; i++)
+        scene += format("MeshNode(data = @sphere, position = [{}, {}, {}]);\n", ((i % 16) - 8) * 3.0f, ((i / 16) - 8) * 2.0f, -30.0f);
+
+    string path = directory + "many_lights.ptscn";
+    writeFile(path, scene);
+    return PTBenchScenario{ "many_lights", to_string(lights) + " lights over " + to_string(meshes) + " meshes", path };
+}
+
+// one big mesh, which is mostly obj parsing and upload during load. meshes use 16 bit indices, so the grid is
+// kept just under 65536 vertices
+static PTBenchScenario generateBigOBJ(const string& directory)
+{
+    const int side = 250;
+    string obj = "# generated by the planetarium benchmark\nvn 0 0 1\n";
+    obj.reserve(side * side * 96);
+    for (int y = 0; y < side; y++)
+    {
+        for (int x = 0; x < side; x++)
+        {
+            float u = static_cast<float>(x) / (side - 1);
+            float v = static_cast<float>(y) / (side - 1);
+            obj += format("v {:.5f} {:.5f} {:.5f}\nvt {:.5f} {:.5f}\n", (u - 0.5f) * 20.0f, (v - 0.5f) * 20.0f, ((x * 7 + y * 13) % 17) * 0.02f, u, v);
+        }
+    }
+    for (int y = 0; y < side - 1; y++)
+    {
+        for (int x = 0; x < side - 1; x++)
+        {
+            int a = (y * side) + x + 1;
+            int b = a + 1;
+            int c = a + side;
+            int d = c + 1;
+            obj += format("f {0}/{0}/1 {1}/{1}/1 {3}/{3}/1\nf {0}/{0}/1 {3}/{3}/1 {2}/{2}/1\n", a, b, c, d);
+        }
+    }
+    string obj_path = directory + "big_grid.obj";
+    writeFile(obj_path, obj);
+
+    string scene = "Resource(mesh, \"" + obj_path + "\") : grid;\n\n";
+    scene += CAMERA_LINE;
+    scene += "LightNode(colour = [1, 1, 1], position = [0, 0, -5], directional = 0, brightness = 4.0);\n";
+    scene += "MeshNode(data = @grid, position = [0, 0, -15]);\n";
+
+    string path = directory + "big_obj.ptscn";
+    writeFile(path, scene);
+    return PTBenchScenario{ "big_obj", to_string(side * side) + " vertex obj", path };
+}
+
+// a huge scene file with nothing to draw, so load time is almost all parsing and node creation
+static PTBenchScenario generateBigParse(const string& directory)
+{
+    const int nodes = 16384;
+    string scene = "// generated by the planetarium benchmark\n";
+    scene += CAMERA_LINE;
+    for (int i = 0; i < nodes; i++)
+        scene += format("Node(position = [{}, {}, {}], scale = [1.0, 1.0, 1.0]) : node_{};\n", i % 128, (i / 128) % 128, -(i / 1024), i);
+
+    string path = directory + "big_parse.ptscn";
+    writeFile(path, scene);
+    return PTBenchScenario{ "big_parse", to_string(nodes) + " empty nodes", path };
+}
+
+vector<PTBenchScenario> benchGenerateScenarios(const string& directory)
+{
+    filesystem::create_directories(directory);
+    string dir = directory;
+    if (!dir.empty() && dir.back() != '/')
+        dir.push_back('/');
+
+    return
+    {
+        generateManyMeshes(dir),
+        generateDeepHierarchy(dir),
+        generateManyLights(dir),
+        generateBigOBJ(dir),
+        generateBigParse(dir)
+    };
+}
\ No newline at end of file
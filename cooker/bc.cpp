@@ -0,0 +1,305 @@
+#include "bc.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+// finds the line through the block's texels (in the first n channels) that best fits them, and returns the two
+// ends of the texels' spread along it. this is the usual cheap starting point for picking endpoints
+template <int N>
+static void fitEndpoints(const PTBlockRGBA& block, float (&end_0)[N], float (&end_1)[N])
+{
+    float mean[N] = { };
+    for (int t = 0; t < 16; t++)
+    {
+        for (int c = 0; c < N; c++)
+            mean[c] += block.texels[t][c];
+    }
+    for (int c = 0; c < N; c++)
+        mean[c] /= 16.0f;
+
+    float covariance[N][N] = { };
+    for (int t = 0; t < 16; t++)
+    {
+        float d[N];
+        for (int c = 0; c < N; c++)
+            d[c] = block.texels[t][c] - mean[c];
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+                covariance[i][j] += d[i] * d[j];
+        }
+    }
+
+    // power iteration for the principal axis, starting from the diagonal so flat blocks still get something sane
+    float axis[N];
+    for (int c = 0; c < N; c++)
+        axis[c] = 1.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[N] = { };
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+                next[i] += covariance[i][j] * axis[j];
+        }
+        float length = 0.0f;
+        for (int c = 0; c < N; c++)
+            length += next[c] * next[c];
+        if (length < 1e-8f)
+            break;
+        length = sqrtf(length);
+        for (int c = 0; c < N; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float min_t = 0.0f;
+    float max_t = 0.0f;
+    for (int t = 0; t < 16; t++)
+    {
+        float projection = 0.0f;
+        for (int c = 0; c < N; c++)
+            projection += (block.texels[t][c] - mean[c]) * axis[c];
+        min_t = min(min_t, projection);
+        max_t = max(max_t, projection);
+    }
+
+    for (int c = 0; c < N; c++)
+    {
+        end_0[c] = clamp(mean[c] + (axis[c] * max_t), 0.0f, 255.0f);
+        end_1[c] = clamp(mean[c] + (axis[c] * min_t), 0.0f, 255.0f);
+    }
+}
+
+static uint16_t packRGB565(const float (&colour)[3])
+{
+    uint16_t r = static_cast<uint16_t>((colour[0] * 31.0f / 255.0f) + 0.5f);
+    uint16_t g = static_cast<uint16_t>((colour[1] * 63.0f / 255.0f) + 0.5f);
+    uint16_t b = static_cast<uint16_t>((colour[2] * 31.0f / 255.0f) + 0.5f);
+    return (r << 11) | (g << 5) | b;
+}
+
+static void unpackRGB565(uint16_t packed, int (&colour)[3])
+{
+    int r = (packed >> 11) & 0x1f;
+    int g = (packed >> 5) & 0x3f;
+    int b = packed & 0x1f;
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+void compressBlockBC1(const PTBlockRGBA& block, uint8_t* out)
+{
+    float end_0[3];
+    float end_1[3];
+    fitEndpoints<3>(block, end_0, end_1);
+
+    uint16_t colour_0 = packRGB565(end_0);
+    uint16_t colour_1 = packRGB565(end_1);
+    // colour_0 > colour_1 selects the four colour mode, the other way around is three colours plus transparent
+    if (colour_0 < colour_1)
+        swap(colour_0, colour_1);
+
+    uint32_t indices = 0;
+    if (colour_0 != colour_1)
+    {
+        int palette[4][3];
+        unpackRGB565(colour_0, palette[0]);
+        unpackRGB565(colour_1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = ((2 * palette[0][c]) + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + (2 * palette[1][c])) / 3;
+        }
+
+        for (int t = 0; t < 16; t++)
+        {
+            uint32_t best = 0;
+            int best_error = INT32_MAX;
+            for (uint32_t p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block.texels[t][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            indices |= best << (t * 2);
+        }
+    }
+
+    out[0] = colour_0 & 0xff;
+    out[1] = colour_0 >> 8;
+    out[2] = colour_1 & 0xff;
+    out[3] = colour_1 >> 8;
+    memcpy(out + 4, &indices, 4);
+}
+
+static void compressBlockBC4(const PTBlockRGBA& block, int channel, uint8_t* out)
+{
+    uint8_t value_0 = 0;
+    uint8_t value_1 = 255;
+    for (int t = 0; t < 16; t++)
+    {
+        value_0 = max(value_0, block.texels[t][channel]);
+        value_1 = min(value_1, block.texels[t][channel]);
+    }
+
+    // value_0 > value_1 selects the eight value mode, so both ends come from the block's range
+    uint64_t indices = 0;
+    if (value_0 != value_1)
+    {
+        int palette[8];
+        palette[0] = value_0;
+        palette[1] = value_1;
+        for (int i = 2; i < 8; i++)
+            palette[i] = (((8 - i) * value_0) + ((i - 1) * value_1) + 3) / 7;
+
+        for (int t = 0; t < 16; t++)
+        {
+            uint64_t best = 0;
+            int best_error = INT32_MAX;
+            for (uint64_t p = 0; p < 8; p++)
+            {
+                int error = abs(block.texels[t][channel] - palette[p]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            indices |= best << (t * 3);
+        }
+    }
+
+    out[0] = value_0;
+    out[1] = value_1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+void compressBlockBC3(const PTBlockRGBA& block, uint8_t* out)
+{
+    compressBlockBC4(block, 3, out);
+    compressBlockBC1(block, out + 8);
+}
+
+void compressBlockBC5(const PTBlockRGBA& block, uint8_t* out)
+{
+    compressBlockBC4(block, 0, out);
+    compressBlockBC4(block, 1, out + 8);
+}
+
+// bc7 blocks are one 128 bit stream, written from the least significant bit of the first byte
+struct PTBitWriter
+{
+    uint8_t* out;
+    uint32_t position = 0;
+
+    inline void write(uint32_t value, uint32_t bits)
+    {
+        for (uint32_t b = 0; b < bits; b++, position++)
+            out[position / 8] |= ((value >> b) & 1) << (position % 8);
+    }
+};
+
+static const int BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// mode 6 endpoints are 7 bits per channel plus one shared low bit per endpoint, so try both and keep the closer
+static void quantiseBC7Endpoint(const float (&end)[4], uint32_t (&quantised)[4], uint32_t& p_bit)
+{
+    float best_error = INFINITY;
+    for (uint32_t p = 0; p < 2; p++)
+    {
+        uint32_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = static_cast<uint32_t>(clamp(((end[c] - p) / 2.0f) + 0.5f, 0.0f, 127.0f));
+            float d = static_cast<float>((candidate[c] << 1) | p) - end[c];
+            error += d * d;
+        }
+        if (error < best_error)
+        {
+            best_error = error;
+            p_bit = p;
+            memcpy(quantised, candidate, sizeof(candidate));
+        }
+    }
+}
+
+void compressBlockBC7(const PTBlockRGBA& block, uint8_t* out)
+{
+    float end_0[4];
+    float end_1[4];
+    fitEndpoints<4>(block, end_0, end_1);
+
+    uint32_t quantised[2][4];
+    uint32_t p_bits[2];
+    quantiseBC7Endpoint(end_0, quantised[0], p_bits[0]);
+    quantiseBC7Endpoint(end_1, quantised[1], p_bits[1]);
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int e_0 = static_cast<int>((quantised[0][c] << 1) | p_bits[0]);
+            int e_1 = static_cast<int>((quantised[1][c] << 1) | p_bits[1]);
+            palette[i][c] = (((64 - BC7_WEIGHTS_4[i]) * e_0) + (BC7_WEIGHTS_4[i] * e_1) + 32) >> 6;
+        }
+    }
+
+    uint32_t indices[16];
+    for (int t = 0; t < 16; t++)
+    {
+        int best_error = INT32_MAX;
+        for (uint32_t p = 0; p < 16; p++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int d = block.texels[t][c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[t] = p;
+            }
+        }
+    }
+
+    // the first index only gets 3 bits, its top bit is implied zero, so flip the endpoints if it would be set
+    if (indices[0] & 8)
+    {
+        swap(quantised[0], quantised[1]);
+        swap(p_bits[0], p_bits[1]);
+        for (uint32_t& index : indices)
+            index = 15 - index;
+    }
+
+    memset(out, 0, 16);
+    PTBitWriter writer{ out };
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        writer.write(quantised[0][c], 7);
+        writer.write(quantised[1][c], 7);
+    }
+    writer.write(p_bits[0], 1);
+    writer.write(p_bits[1], 1);
+    writer.write(indices[0], 3);
+    for (int t = 1; t < 16; t++)
+        writer.write(indices[t], 4);
+}
\ No newline at end of file
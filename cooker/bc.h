@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// a 4x4 block of rgba8 texels, row major
+struct PTBlockRGBA
+{
+    uint8_t texels[16][4];
+};
+
+// each of these writes one compressed block (8 bytes for bc1, 16 for the rest)
+void compressBlockBC1(const PTBlockRGBA& block, uint8_t* out);
+// bc3 is a bc4 alpha block followed by a bc1 colour block
+void compressBlockBC3(const PTBlockRGBA& block, uint8_t* out);
+// bc5 is two bc4 blocks, for red and green
+void compressBlockBC5(const PTBlockRGBA& block, uint8_t* out);
+// only ever uses mode 6 (one subset, rgba endpoints, 4 bit indices), which covers most content well enough
+void compressBlockBC7(const PTBlockRGBA& block, uint8_t* out);
\ No newline at end of file
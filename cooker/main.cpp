@@ -0,0 +1,190 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "image_decoder.h"
+#include "mipmap.h"
+#include "texture_file.h"
+#include "bc.h"
+
+using namespace std;
+
+// a row of blocks in one mip level, which is the unit of work handed to each thread
+struct PTCookJob
+{
+    uint32_t level;
+    uint32_t block_row;
+};
+
+// blocks hanging off the edge of the image (or the whole of a mip smaller than 4x4) repeat the last row/column
+static PTBlockRGBA fetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y)
+{
+    PTBlockRGBA block;
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        uint32_t py = min((block_y * 4) + y, height - 1);
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            uint32_t px = min((block_x * 4) + x, width - 1);
+            const uint8_t* texel = pixels + (((static_cast<size_t>(py) * width) + px) * 4);
+            copy(texel, texel + 4, block.texels[(y * 4) + x]);
+        }
+    }
+    return block;
+}
+
+static void compressBlock(PTTextureFormat format, const PTBlockRGBA& block, uint8_t* out)
+{
+    switch (format)
+    {
+    case PTTextureFormat::BC1: compressBlockBC1(block, out); break;
+    case PTTextureFormat::BC3: compressBlockBC3(block, out); break;
+    case PTTextureFormat::BC5: compressBlockBC5(block, out); break;
+    case PTTextureFormat::BC7: compressBlockBC7(block, out); break;
+    default: break;
+    }
+}
+
+static bool parseFormat(const string& name, PTTextureFormat& format)
+{
+    if (name == "rgba8") format = PTTextureFormat::RGBA8;
+    else if (name == "bc1") format = PTTextureFormat::BC1;
+    else if (name == "bc3") format = PTTextureFormat::BC3;
+    else if (name == "bc5") format = PTTextureFormat::BC5;
+    else if (name == "bc7") format = PTTextureFormat::BC7;
+    else return false;
+    return true;
+}
+
+// usage: planetarium_cook input output.pttex [--format rgba8|bc1|bc3|bc5|bc7] [--linear] [--no-mips]
+//                         [--threads n]
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0] << " input output.pttex [--format rgba8|bc1|bc3|bc5|bc7] [--linear] [--no-mips] [--threads n]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string input_path = argv[1];
+    string output_path = argv[2];
+    PTTextureFormat format = PTTextureFormat::BC7;
+    bool srgb = true;
+    bool mipmaps = true;
+    uint32_t thread_count = max(thread::hardware_concurrency(), 1u);
+    for (int i = 3; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--linear")
+            srgb = false;
+        else if (arg == "--no-mips")
+            mipmaps = false;
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            if (!parseFormat(argv[++i], format))
+            {
+                cerr << "unrecognised format '" << argv[i] << "'" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+            thread_count = max(static_cast<uint32_t>(atoi(argv[++i])), 1u);
+        else
+        {
+            cerr << "unrecognised argument '" << arg << "'" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    // bc5 is for normal maps and other two channel data, which is never colour
+    if (format == PTTextureFormat::BC5)
+        srgb = false;
+
+    // level 0 is decoded straight into the start of the mip chain, then the rest is built from it
+    uint32_t width = 0;
+    uint32_t height = 0;
+    vector<uint8_t> pixels;
+    vector<PTMipLevel> mips;
+    PTImageSink sink;
+    sink.begin = [&](const PTImageInfo& info)
+    {
+        if (info.format != PTImagePixelFormat::PIXEL_RGBA8)
+        {
+            cerr << "only 8 bit images can be cooked" << endl;
+            return false;
+        }
+        width = info.width;
+        height = info.height;
+        mips = mipChainLayoutRGBA8(width, height);
+        if (!mipmaps)
+            mips.resize(1);
+        pixels.resize(mipChainSizeRGBA8(mips));
+        return true;
+    };
+    sink.row = [&](uint32_t y) { return pixels.data() + (static_cast<size_t>(y) * width * 4); };
+
+    if (!decodeImage(input_path, sink))
+    {
+        cerr << "unable to read '" << input_path << "'" << endl;
+        return EXIT_FAILURE;
+    }
+    generateMipChainRGBA8(pixels.data(), mips, srgb);
+
+    PTTextureFile texture;
+    texture.format = format;
+    texture.srgb = srgb;
+    texture.width = width;
+    texture.height = height;
+    size_t total_size = 0;
+    for (const PTMipLevel& mip : mips)
+    {
+        size_t level_size = textureLevelSize(format, mip.width, mip.height);
+        texture.levels.push_back(PTTextureFileLevel{ mip.width, mip.height, total_size, level_size });
+        total_size += level_size;
+    }
+    texture.data.resize(total_size);
+
+    if (!textureFormatIsCompressed(format))
+        texture.data = pixels;
+    else
+    {
+        vector<PTCookJob> jobs;
+        for (uint32_t level = 0; level < mips.size(); level++)
+        {
+            for (uint32_t row = 0; row < (mips[level].height + 3) / 4; row++)
+                jobs.push_back(PTCookJob{ level, row });
+        }
+
+        // every block is independent, so threads just take rows until there are none left
+        atomic<size_t> next_job = 0;
+        uint32_t block_bytes = textureFormatBlockBytes(format);
+        auto worker = [&]()
+        {
+            for (size_t j = next_job++; j < jobs.size(); j = next_job++)
+            {
+                const PTMipLevel& mip = mips[jobs[j].level];
+                uint32_t blocks_x = (mip.width + 3) / 4;
+                uint8_t* out = texture.data.data() + texture.levels[jobs[j].level].offset + (static_cast<size_t>(jobs[j].block_row) * blocks_x * block_bytes);
+                for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+                    compressBlock(format, fetchBlock(pixels.data() + mip.offset, mip.width, mip.height, block_x, jobs[j].block_row), out + (block_x * block_bytes));
+            }
+        };
+
+        vector<thread> threads;
+        for (uint32_t t = 0; t < min(thread_count, static_cast<uint32_t>(jobs.size())); t++)
+            threads.emplace_back(worker);
+        for (thread& t : threads)
+            t.join();
+    }
+
+    if (!writeTextureFile(output_path, texture))
+    {
+        cerr << "unable to write '" << output_path << "'" << endl;
+        return EXIT_FAILURE;
+    }
+
+    cout << "cooked " << input_path << " (" << width << "x" << height << ", " << mips.size() << " mips) to " << output_path << ", " << (texture.data.size() / 1024) << "KiB" << endl;
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
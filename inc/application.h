@@ -4,7 +4,10 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 #include <chrono>
+#include <string>
+#include <vector>
 
+#include "constant.h"
 #include "math/ptmath.h"
 
 #ifdef _WIN32
@@ -15,6 +18,30 @@ typedef std::chrono::system_clock clocktype;
 
 class PTScene;
 
+// with no window, the application renders a fixed number of frames offscreen and then stops. time steps by a fixed
+// amount each frame rather than following the clock, so runs are repeatable
+struct PTHeadlessSettings
+{
+    bool enabled = false;
+    uint32_t frame_count = 600;
+    float timestep = 1.0f / 60.0f;
+    // if set, the last frame is saved here as a bitmap
+    std::string capture_path = "";
+    // if set, every frame is saved as <prefix>000000.bmp, <prefix>000001.bmp, ... e.g. for making a video
+    std::string record_prefix = "";
+};
+
+// where the time went in one headless frame, in milliseconds. gpu time lags a couple of frames behind the rest,
+// since it's only read back once the frame slot comes round again
+struct PTFrameStats
+{
+    float update_ms = 0.0f;
+    float record_ms = 0.0f;
+    float submit_ms = 0.0f;
+    float gpu_ms = 0.0f;
+    float frame_ms = 0.0f;
+};
+
 class PTApplication
 {
 public:
@@ -25,6 +52,13 @@ private:
     int height;
 
     GLFWwindow* window = nullptr;
+    PTHeadlessSettings headless;
+    std::string start_scene_path;
+    // simulated time since the start, only used when headless
+    float headless_time = 0.0f;
+    // timings of the headless run, for benchmarking
+    float load_ms = 0.0f;
+    std::vector<PTFrameStats> frame_stats;
 
     clocktype::time_point last_frame_start;
     clocktype::time_point program_start;
@@ -34,7 +68,7 @@ private:
     bool wants_new_scene = false;
     std::string new_scene_path = "";
 public:
-    PTApplication(unsigned int _width, unsigned int _height);
+    PTApplication(unsigned int _width, unsigned int _height, std::string _start_scene_path = DEFAULT_SCENE_PATH, PTHeadlessSettings _headless = { });
 
     PTApplication() = delete;
     PTApplication(PTApplication& other) = delete;
@@ -55,10 +89,16 @@ public:
 	float getTotalTime();
 
     inline void openScene(std::string path) { wants_new_scene = true; new_scene_path = path; }
+    inline bool isHeadless() const { return headless.enabled; }
+    // time taken to load the starting scene, warm-up included
+    inline float getLoadTime() const { return load_ms; }
+    // one entry per frame, only recorded when headless
+    inline const std::vector<PTFrameStats>& getFrameStats() const { return frame_stats; }
 
 private:
     void initWindow();
     void mainLoop();
+    void applySceneRenderGraph();
     void deinitWindow();
 
     static void windowResizeCallback(GLFWwindow* window, int new_width, int new_height);
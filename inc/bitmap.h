@@ -30,7 +30,11 @@ struct PTBitmapInfoHeader
     uint32_t important_colours = 0;
 };
 
-bool writeRGBABitmap(std::string path, char* data, int32_t width, int32_t height);
-bool readRGBABitmap(std::string path, char*& data, int32_t& width, int32_t& height); // TODO: improve the reading and writing of image files
+bool writeRGBABitmap(std::string path, const char* data, int32_t width, int32_t height);
+// for data that's already in the file's channel order, e.g. read back from a bgra image, so it's written as is
+bool writeBGRABitmap(std::string path, const char* data, int32_t width, int32_t height);
+// reads any image the decoder supports into one new[]'d rgba8 buffer, bottom row first. prefer decodeImage to go
+// straight to where the pixels are needed
+bool readRGBABitmap(std::string path, char*& data, int32_t& width, int32_t& height);
 
 #pragma pack(pop)
\ No newline at end of file
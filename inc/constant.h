@@ -2,6 +2,12 @@
 
 #include "math/ptmath.h"
 
+// validation layers and the debug messenger come with debug builds. NDEBUG turns them off along with asserts,
+// PT_NO_VALIDATION turns off just the validation (for optimised builds which keep their asserts)
+#if !defined(NDEBUG) && !defined(PT_NO_VALIDATION)
+#define PT_VALIDATION
+#endif
+
 // this simply prevents us from getting a million 'variable defined but not used' errors
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -13,14 +19,33 @@
 
 const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
-const uint16_t TRANSFORM_UNIFORM_BINDING = 0;
+// bindings 0 and 1 are reserved by the engine, material bindings start after them (UNIFORM_OFFSET in common.glsl).
+// in bindless mode binding 0 of the material set holds the material's indices into the global texture array
+const uint16_t TEXTURE_INDEX_BINDING = 0;
 const uint16_t SCENE_UNIFORM_BINDING = 1;
 
+// descriptor sets, ordered by how often they change: scene data once per frame, the global texture array
+// (bindless mode only, otherwise it's empty) whenever, and material data when the material changes.
+// per-object data is pushed for every draw. must match the sets in common.glsl
+const uint32_t SCENE_DESCRIPTOR_SET = 0;
+const uint32_t TEXTURE_DESCRIPTOR_SET = 1;
+const uint32_t MATERIAL_DESCRIPTOR_SET = 2;
+const uint32_t DESCRIPTOR_SET_COUNT = 3;
+
+// number of texture slots a material can index in bindless mode, must match common.glsl
+const uint16_t MAX_MATERIAL_TEXTURES = 16;
+// upper limit on the size of the global texture array, the device limits may bring it down further
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
 const size_t MAX_LIGHTS = 16;
 
 static const char* DEFAULT_SHADER_PATH = "res/engine/shader/default";
 static const char* DEFAULT_MATERIAL_PATH = "res/engine/material/default.ptmat";
 static const char* DEFAULT_TEXTURE_PATH = "res/engine/texture/blank.bmp";
+static const char* DEFAULT_RENDER_GRAPH_PATH = "res/engine/render_graph/default.ptrg";
+static const char* DEFAULT_SCENE_PATH = "res/demo.ptscn";
+static const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+static const char* SHADER_CACHE_PATH = "shader_cache/";
 
 #ifdef _MSC_VER
 #pragma warning(pop)
@@ -28,11 +53,10 @@ static const char* DEFAULT_TEXTURE_PATH = "res/engine/texture/blank.bmp";
 #pragma GCC diagnostic pop
 #endif
 
-struct TransformUniforms
+// pushed with vkCmdPushConstants for every draw, so keep it small (128 bytes is all that's guaranteed)
+struct TransformConstants
 {
     float model_to_world[16];
-    float world_to_view[16];
-    float view_to_clip[16];
     uint32_t object_id;
 };
 
@@ -48,8 +72,12 @@ struct LightDescription
 
 struct SceneUniforms
 {
+    float world_to_view[16];
+    float view_to_clip[16];
     PTVector2f viewport_size = PTVector2f{ 640, 480 };
     float time = 0.0f;
+    // fraction of their targets camera steps are drawing to, see PTRGGraph::getRenderScale
+    float render_scale = 1.0f;
     LightDescription lights[MAX_LIGHTS];
 };
 
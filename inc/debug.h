@@ -1,9 +1,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <utility>
 #include <stdint.h>
 
-void debugInit();
+// non-interactive skips the terminal ui entirely, and just prints log lines (e.g. for headless runs)
+void debugInit(bool interactive = true);
 void debugDeinit();
 void debugLog(std::string text);
 void debugFrametiming(float delta_time, int frame_number);
@@ -11,5 +14,7 @@ void debugSetSceneProperty(std::string name, std::string content);
 void debugSetObjectProperty(std::string name, std::string content);
 void debugClearSceneProperty(std::string name);
 void debugClearObjectProperty(std::string name);
+// replaces the whole gpu profile view, one row per zone
+void debugSetGPUProfile(const std::vector<std::pair<std::string, std::string>>& rows);
 
 std::string debugRenderToBuffer(uint32_t width, uint32_t height);
\ No newline at end of file
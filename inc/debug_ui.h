@@ -12,6 +12,7 @@ HorizontalBox
             HorizontalBox (children = { Label (text = "frametiming:"), Label : "frame_label" (alignment = 1)}),
             BorderedBox : "scene_box" (name = "scene properties", child = SizeLimiter (max_size = [-1, 12])),
             BorderedBox : "object_box" (name = "object properties", child = SizeLimiter (max_size = [-1, 12])),
+            BorderedBox : "gpu_box" (name = "gpu profile", child = SizeLimiter (max_size = [-1, 12])),
             Label (text = "you can do it!")
         })
     ),
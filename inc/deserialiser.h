@@ -14,6 +14,8 @@ class PTScene;
 class PTMaterial;
 class PTShader;
 class PTImage;
+struct PTRGStep;
+struct PTResolutionSettings;
 
 class PTDeserialiser
 {
@@ -218,6 +220,8 @@ public:
     static void deserialiseScene(PTScene* scene, const std::string& content);
     static std::vector<std::pair<std::string, Argument>> deserialiseStatement(const std::vector<Token>& tokens, size_t& first_token, bool allow_unnamed, bool allow_named, ResourceMap& res_map, const std::string& content);
     static void deserialiseMaterial(const std::string& content, MaterialParams& params, PTShader*& shader, std::vector<UniformParam>& uniforms, std::map<uint16_t, TextureParam>& textures);
+    static void deserialiseRenderGraph(const std::string& content, std::vector<PTRGStep>& steps, int& final_image, PTResolutionSettings& resolution, std::vector<PTResource*>& resources);
+    static std::vector<std::pair<std::string, std::string>> findResourceDescriptors(const std::string& content);
 
 private:
     static inline TokenType getType(const char c);
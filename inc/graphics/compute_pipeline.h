@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <array>
+
+#include "resource.h"
+
+// a compute shader and everything needed to dispatch it, used by render graph compute steps. the layout
+// mirrors PTPipeline's, so the shared scene and texture sets bind the same way, but set 2 holds the step's
+// input and output images rather than a material
+class PTComputePipeline : public PTResource
+{
+    friend class PTResourceManager;
+public:
+    struct BindingInfo
+    {
+        uint16_t bind_point;
+        VkDescriptorType type;
+    };
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+
+    VkShaderModule shader_module = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    std::vector<BindingInfo> descriptor_bindings;
+    // local size declared by the shader. dispatches are sized from this, so the shader is free to pick
+    // whatever tile shape suits its shared memory use
+    std::array<uint32_t, 3> workgroup_size = { 1, 1, 1 };
+
+    std::string origin_path;
+
+    PTComputePipeline(VkDevice _device, VkPipelineCache _pipeline_cache, std::string shader_path_stub);
+
+    void reflectDescriptors(const std::vector<char>& code);
+    void createLayouts();
+
+    ~PTComputePipeline();
+
+public:
+    PTComputePipeline() = delete;
+    PTComputePipeline(const PTComputePipeline& other) = delete;
+    PTComputePipeline(const PTComputePipeline&& other) = delete;
+    PTComputePipeline operator=(const PTComputePipeline& other) = delete;
+    PTComputePipeline operator=(const PTComputePipeline&& other) = delete;
+
+    inline VkPipeline getPipeline() const { return pipeline; }
+    inline VkPipelineLayout getLayout() const { return layout; }
+    inline VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptor_set_layout; }
+    inline std::array<uint32_t, 3> getWorkgroupSize() const { return workgroup_size; }
+    inline std::string getOriginPath() const { return origin_path; }
+    inline size_t getDescriptorCount() const { return descriptor_bindings.size(); }
+    bool hasDescriptorWithBinding(uint16_t binding, VkDescriptorType type) const;
+};
\ No newline at end of file
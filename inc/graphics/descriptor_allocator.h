@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <array>
+
+#include "constant.h"
+
+// number of sets the first pool in a chain can hold. each new pool doubles this, up to the maximum
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 64;
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;
+
+// hands out descriptor sets for everything except the bindless texture table, which needs its own
+// update-after-bind pool. pools are chained, so running out just means making another one. sets are
+// never freed back to their pool; they go on a free list for their layout instead, and get handed out
+// again the next time someone asks for that layout (but not before any frame which might still be using
+// them has finished). transient sets come from per-frame pools which are reset all at once, after that
+// frame's fence has been waited on
+class PTDescriptorAllocator
+{
+private:
+    struct PoolChain
+    {
+        std::vector<VkDescriptorPool> pools;
+        // index of the pool currently being allocated from. everything before it is full
+        size_t current = 0;
+        uint32_t next_pool_sets = DESCRIPTOR_POOL_INITIAL_SETS;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    PoolChain persistent;
+    std::array<PoolChain, MAX_FRAMES_IN_FLIGHT> transient;
+    // recycled persistent sets, keyed by the layout they were allocated with
+    std::map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> free_sets;
+    // sets freed while the frame slot at that index was the last one submitted (or being recorded)
+    std::array<std::vector<std::pair<VkDescriptorSetLayout, VkDescriptorSet>>, MAX_FRAMES_IN_FLIGHT> retired_sets;
+    uint32_t current_frame = 0;
+
+public:
+    PTDescriptorAllocator(VkDevice _device);
+    ~PTDescriptorAllocator();
+
+    PTDescriptorAllocator(const PTDescriptorAllocator& other) = delete;
+    PTDescriptorAllocator(const PTDescriptorAllocator&& other) = delete;
+    PTDescriptorAllocator operator=(const PTDescriptorAllocator& other) = delete;
+    PTDescriptorAllocator operator=(const PTDescriptorAllocator&& other) = delete;
+
+    // recycled sets still contain whatever was last written to them, so callers must always write them
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    void free(VkDescriptorSetLayout layout, VkDescriptorSet descriptor_set);
+    // must be called before a layout is destroyed, since its handle may be reused by a different layout
+    void forgetLayout(VkDescriptorSetLayout layout);
+
+    // only valid until the next time the same frame index comes round
+    VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout, uint32_t frame_index);
+    // reset this frame slot's transient pools and recycle the sets freed during its last go round. only call once
+    // the slot's fence has been waited on
+    void collect(uint32_t frame_index);
+
+private:
+    VkDescriptorPool createPool(uint32_t max_sets);
+    VkDescriptorSet allocateFromChain(PoolChain& chain, VkDescriptorSetLayout layout);
+};
\ No newline at end of file
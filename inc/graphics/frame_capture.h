@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <array>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "constant.h"
+#include "physical_device.h"
+
+class PTBuffer;
+class PTImage;
+
+// reads finished frames back to the cpu and saves them as bitmaps without stalling the render thread. the copy is
+// recorded into the frame's own command buffer, the result is picked up once that frame slot's fence has been
+// waited on anyway, and the file is written on a background thread. readback buffers are kept between captures, so
+// recording every frame (e.g. for a video) only allocates when the output size changes
+class PTFrameCapture
+{
+public:
+    // readback buffers the writer can be working through at once. if it falls further behind than this, the render
+    // thread waits for it rather than dropping frames
+    static const uint32_t MAX_QUEUED_WRITES = 4;
+
+private:
+    struct Readback
+    {
+        PTBuffer* buffer = nullptr;
+        VkExtent2D extent{ 0, 0 };
+    };
+
+    struct Write
+    {
+        Readback* readback = nullptr;
+        std::vector<std::string> paths;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    PTPhysicalDevice physical_device;
+    VkMemoryPropertyFlags readback_memory_flags = 0;
+
+    // bgra, so the pixels can go straight to the file. shared between frame slots, since the copy out of it is
+    // recorded straight after the blit into it
+    PTImage* capture_image = nullptr;
+
+    std::vector<Readback*> readbacks;
+    // recorded into a frame slot's command buffer, waiting for it to finish
+    std::array<Write, MAX_FRAMES_IN_FLIGHT> pending;
+
+    std::string screenshot_path;
+    bool wants_screenshot = false;
+    std::string sequence_prefix;
+    bool recording_sequence = false;
+    uint32_t sequence_frame = 0;
+
+    // everything below is shared with the writer thread
+    std::mutex write_mutex;
+    std::condition_variable write_condition;
+    std::deque<Write> writes;
+    std::vector<Readback*> free_readbacks;
+    uint32_t writes_in_progress = 0;
+    bool stopping = false;
+    std::thread writer;
+
+public:
+    PTFrameCapture(VkDevice _device, PTPhysicalDevice _physical_device);
+    ~PTFrameCapture();
+
+    PTFrameCapture(const PTFrameCapture& other) = delete;
+    PTFrameCapture(const PTFrameCapture&& other) = delete;
+    PTFrameCapture operator=(const PTFrameCapture& other) = delete;
+    PTFrameCapture operator=(const PTFrameCapture&& other) = delete;
+
+    // save the next frame drawn
+    void requestScreenshot(std::string path);
+    // save every frame drawn from now on as <prefix>000000.bmp, <prefix>000001.bmp, ...
+    void beginSequence(std::string prefix);
+    void endSequence();
+    // drop any screenshot or sequence that was asked for, e.g. if the final image can't be captured
+    void cancel();
+    inline bool isRecordingSequence() const { return recording_sequence; }
+    inline bool wantsCapture() const { return wants_screenshot || recording_sequence; }
+
+    /**
+     * @brief record copying the final image of a frame into a readback buffer. the source has to be in
+     * TRANSFER_SRC_OPTIMAL with any writes to it already made visible to transfers, and is left that way.
+     * it's flipped on the way, since bitmaps start at the bottom row
+     *
+     * @param source_extent the part of the source image that was drawn to, which is stretched to fill output_extent
+     */
+    void recordCapture(VkCommandBuffer command_buffer, uint32_t frame_index, VkImage source, VkExtent2D source_extent, VkExtent2D output_extent);
+    // hand the capture recorded into this frame slot (if any) to the writer. only call once the slot's fence has been
+    // waited on
+    void collect(uint32_t frame_index);
+    // collect every frame slot and wait until all the files are written. the device must be idle
+    void flush();
+
+private:
+    Readback* acquireReadback(VkExtent2D extent);
+    void writerLoop();
+};
\ No newline at end of file
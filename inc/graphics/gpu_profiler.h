@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+
+#include "constant.h"
+#include "physical_device.h"
+
+// times sections of a frame on the gpu with timestamp queries, and optionally counts what the pipeline did in them
+// with pipeline statistics queries. each frame in flight gets its own range of queries, and results are picked up
+// the next time that frame slot comes round (so MAX_FRAMES_IN_FLIGHT frames late) rather than waited on
+class PTGPUProfiler
+{
+public:
+    struct Zone
+    {
+        std::string name;
+        // zones inside another zone (e.g. material batches inside a step) are one deeper
+        uint32_t depth = 0;
+        float gpu_ms = 0.0f;
+        // pipeline statistics, only filled in if has_statistics is set
+        bool has_statistics = false;
+        uint64_t vertices = 0;
+        uint64_t primitives = 0;
+        uint64_t fragment_invocations = 0;
+        uint64_t compute_invocations = 0;
+    };
+
+    static const uint32_t MAX_ZONES = 64;
+    static const uint32_t NO_ZONE = UINT32_MAX;
+
+private:
+    struct FrameQueries
+    {
+        std::vector<Zone> zones;
+        // index into this frame's statistics queries for each zone, or -1
+        std::vector<int32_t> statistics_queries;
+        uint32_t statistics_used = 0;
+        bool statistics_open = false;
+        uint32_t depth = 0;
+        uint64_t frame_number = 0;
+        // set once the queries have been written into a submitted command buffer
+        bool pending = false;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool timestamp_pool = VK_NULL_HANDLE;
+    VkQueryPool statistics_pool = VK_NULL_HANDLE;
+    uint64_t timestamp_mask = 0;
+    float timestamp_period = 0.0f;
+
+    std::array<FrameQueries, MAX_FRAMES_IN_FLIGHT> frames;
+    uint32_t recording_frame = 0;
+    uint64_t frame_counter = 0;
+
+    std::vector<Zone> results;
+    float frame_time = 0.0f;
+    uint64_t results_frame = 0;
+
+    std::ofstream csv_log;
+
+public:
+    PTGPUProfiler(VkDevice _device, const PTPhysicalDevice& physical_device, bool enable_statistics);
+    ~PTGPUProfiler();
+
+    PTGPUProfiler(const PTGPUProfiler& other) = delete;
+    PTGPUProfiler(const PTGPUProfiler&& other) = delete;
+    PTGPUProfiler operator=(const PTGPUProfiler& other) = delete;
+    PTGPUProfiler operator=(const PTGPUProfiler&& other) = delete;
+
+    // false if the graphics queue can't write timestamps, in which case everything else does nothing
+    inline bool isAvailable() const { return timestamp_pool != VK_NULL_HANDLE; }
+    inline bool hasStatistics() const { return statistics_pool != VK_NULL_HANDLE; }
+
+    /**
+     * @brief pick up the results from the last time this frame slot was recorded, if they're in. call before
+     * recording the slot again
+     *
+     * @returns true if new results were read
+     */
+    bool collect(uint32_t frame_index);
+    void beginFrame(VkCommandBuffer command_buffer, uint32_t frame_index);
+    void endFrame(VkCommandBuffer command_buffer);
+    /**
+     * @brief start timing a section of the frame. statistics can't be gathered for zones nested inside another
+     * zone with statistics, or for zones inside a render pass which end outside it
+     *
+     * @returns an id to pass to endZone, or NO_ZONE if the frame is out of zones
+     */
+    uint32_t beginZone(VkCommandBuffer command_buffer, const std::string& name, bool with_statistics = false);
+    void endZone(VkCommandBuffer command_buffer, uint32_t zone);
+
+    // per-zone results of the most recently collected frame, in the order the zones were begun
+    inline const std::vector<Zone>& getResults() const { return results; }
+    // gpu time of the most recently collected frame as a whole
+    inline float getFrameTime() const { return frame_time; }
+    inline uint64_t getResultsFrame() const { return results_frame; }
+
+    // write every collected frame's zones to a csv file, one row per zone
+    bool startLog(std::string path);
+    void stopLog();
+    inline bool isLogging() const { return csv_log.is_open(); }
+
+private:
+    inline uint32_t getFirstTimestamp(uint32_t frame_index) const { return frame_index * ((MAX_ZONES + 1) * 2); }
+    inline uint32_t getFirstStatistics(uint32_t frame_index) const { return frame_index * MAX_ZONES; }
+    void writeLog();
+};
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "resource.h"
 #include "physical_device.h"
+#include "texture_file.h"
 
 class PTImage : public PTResource
 {
@@ -19,6 +20,7 @@ private:
     VkImageTiling tiling;
     VkImageUsageFlags usage;
     VkImageLayout layout;
+    uint32_t mip_levels = 1;
 
     std::string origin_path;
 
@@ -36,12 +38,14 @@ public:
     inline VkImageTiling getTiling() const { return tiling; }
     inline VkImageUsageFlags getUsage() const { return usage; }
     inline VkImageLayout getLayout() const { return layout; }
+    inline uint32_t getMipLevels() const { return mip_levels; }
 
     VkImageView createImageView(VkImageAspectFlags aspect_flags);
     void transitionImageLayout(VkImageLayout new_layout, VkCommandBuffer cmd = VK_NULL_HANDLE);
-    void copyBufferToImage(VkBuffer buffer, VkCommandBuffer cmd = VK_NULL_HANDLE);
+    void copyBufferToImage(VkBuffer buffer, VkCommandBuffer cmd = VK_NULL_HANDLE, uint32_t mip_level = 0, VkDeviceSize buffer_offset = 0);
 
-    static void transitionImageLayout(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkCommandBuffer cmd = VK_NULL_HANDLE);
+    static void transitionImageLayout(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkCommandBuffer cmd = VK_NULL_HANDLE, uint32_t mip_levels = 1);
+    static VkFormat getTextureFormat(PTTextureFormat format, bool srgb);
 
 private:
     PTImage(VkDevice _device, PTPhysicalDevice physical_device, VkExtent2D _size, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags properties);
@@ -49,5 +53,12 @@ private:
 
     ~PTImage();
 
-    void createImage(PTPhysicalDevice physical_device, VkExtent2D _size, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags properties);
+    // textures are loaded from either an image file (bmp, png, tga or hdr, mipmapped at load) or a cooked .pttex
+    // (see cooker/)
+    void loadImage(PTPhysicalDevice physical_device, std::string texture_path);
+    void loadCooked(PTPhysicalDevice physical_device, std::string texture_path);
+    void createImage(PTPhysicalDevice physical_device, VkExtent2D _size, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags properties, uint32_t _mip_levels = 1);
+    // fills every mip below level 0 by blitting each level down from the one above, leaving the whole image in
+    // shader read only. expects the whole image in transfer dst with level 0 already uploaded
+    void generateMipmaps(VkCommandBuffer cmd = VK_NULL_HANDLE);
 };
\ No newline at end of file
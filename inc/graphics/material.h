@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <map>
+#include <array>
 
 #include "constant.h"
 #include "resource.h"
@@ -25,10 +26,19 @@ private:
     PTShader* shader = nullptr;
     PTRenderPass* render_pass = nullptr;
     PTPipeline* pipeline = nullptr;
-    VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+    // material sets are shared by everything drawn with this material, so they live here rather than per object
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptor_sets;
     std::map<uint16_t, PTBuffer*> uniform_buffers;
     std::map<uint16_t, std::pair<PTImage*, std::pair<VkImageView, PTSampler*>>> textures;
     bool needs_texture_update = false;
+    // bindless mode only: indices into the global texture array, read by the shader from the material set.
+    // one buffer per frame slot, so changing a texture never touches a buffer a frame in flight is reading.
+    // changes go into texture_indices, and each buffer catches up when its frame slot next draws
+    std::array<PTBuffer*, MAX_FRAMES_IN_FLIGHT> texture_index_buffers{ };
+    std::array<uint32_t, MAX_MATERIAL_TEXTURES> texture_indices{ };
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> texture_indices_stale{ };
+    std::map<uint16_t, uint32_t> texture_slots;
+    uint32_t default_texture_slot = 0;
 
     int priority = 0;
 
@@ -43,15 +53,19 @@ public:
     inline PTShader* getShader() const { return shader; }
     inline PTRenderPass* getRenderPass() const { return render_pass; }
     inline PTPipeline* getPipeline() const { return pipeline; }
+    inline std::string getOriginPath() const { return origin_path; }
     inline PTBuffer* getDescriptorBuffer(uint16_t binding) { return uniform_buffers[binding]; }
-    void applySetWrites(VkDescriptorSet descriptor_set);
+    inline VkDescriptorSet getDescriptorSet(uint32_t frame_index) const { return descriptor_sets[frame_index]; }
+    // copy any texture changes into this frame slot's index buffer. only call once the slot's fence has been waited on
+    void updateTextureIndices(uint32_t frame_index);
+    void applySetWrites();
 
     inline int getPriority() const { return priority; }
     inline void setPriority(int p) { priority = p; }
 
     void setTexture(uint16_t bind_point, PTImage* texture, VkSamplerAddressMode repeat_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT, VkFilter filtering = VK_FILTER_NEAREST, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
     PTImage* getTexture(uint16_t bind_point);
-    inline bool getTextureUpdateFlag() { bool b = needs_texture_update; needs_texture_update = false; return b; }
+    inline bool hasPendingTextureUpdate() const { return needs_texture_update; }
 
     template <typename T>
     inline void setUniform(uint16_t bind_point, T data);
@@ -64,6 +78,14 @@ private:
     ~PTMaterial();
 
     void initialiseMaterial(PTSwapchain* swapchain, VkBool32 depth_write, VkBool32 depth_test, VkCompareOp depth_op, VkCullModeFlags culling, VkPolygonMode polygon_mode);
+    void reconcileBindings();
+    void createDescriptorSets();
+    void releaseDescriptorSets();
+    void createTextureIndexBuffer();
+    inline bool hasTextureIndexBuffer() const { return texture_index_buffers[0] != nullptr; }
+    void setTextureIndex(uint16_t bind_point, uint32_t slot);
+    void releaseTexture(uint16_t bind_point);
+    void applySetWrites(uint32_t frame_index);
 };
 
 #include "buffer.h"
@@ -17,6 +17,9 @@ private:
     VkPhysicalDevice device = VK_NULL_HANDLE;
     VkPhysicalDeviceProperties properties = { };
     VkPhysicalDeviceFeatures features = { };
+    // descriptor indexing (and friends) were promoted in 1.2, these are left zeroed on older devices
+    VkPhysicalDeviceVulkan12Features features_12 = { };
+    VkPhysicalDeviceVulkan12Properties properties_12 = { };
     std::map<QueueFamily, uint32_t> queue_families;
     std::vector<VkExtensionProperties> extensions;
     VkSurfaceCapabilitiesKHR swapchain_capabilities = { };
@@ -31,6 +34,10 @@ public:
     inline VkPhysicalDevice getDevice() const { return device; }
     inline VkPhysicalDeviceProperties getProperties() const { return properties; }
     inline VkPhysicalDeviceFeatures getFeatures() const { return features; }
+    inline VkPhysicalDeviceVulkan12Features getFeatures12() const { return features_12; }
+    inline VkPhysicalDeviceVulkan12Properties getProperties12() const { return properties_12; }
+    bool supportsBindlessTextures() const;
+    bool supportsFormat(VkFormat format, VkFormatFeatureFlags required_features, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL) const;
     inline bool hasQueueFamily(QueueFamily family) const { return queue_families.count(family); }
     inline uint32_t getQueueFamily(QueueFamily family) const { return queue_families.at(family); }
     inline std::map<QueueFamily, uint32_t> getAllQueueFamilies() const { return queue_families; }
@@ -9,6 +9,10 @@ class PTShader;
 class PTRenderPass;
 class PTSwapchain;
 
+// every pipeline layout declares the same push constant range (a TransformConstants), so that they all stay
+// compatible with the shared scene set and it doesn't need rebinding when the pipeline changes
+const VkShaderStageFlags PUSH_CONSTANT_STAGES = VK_SHADER_STAGE_ALL_GRAPHICS;
+
 class PTPipeline : public PTResource
 {
     friend class PTResourceManager;
@@ -17,6 +21,7 @@ private:
 
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
     std::vector<VkDynamicState> dynamic_states;
 
     PTShader* shader = nullptr;
@@ -34,9 +39,11 @@ private:
 
     VkPolygonMode polygon_mode;
 
-    PTPipeline(VkDevice _device, PTShader* _shader, PTRenderPass* _render_pass, PTSwapchain* _swapchain, VkBool32 _depth_write, VkBool32 _depth_test, VkCompareOp _depth_op, VkCullModeFlags _culling, VkFrontFace _winding_order, VkPolygonMode _polygon_mode, std::vector<VkDynamicState> _dynamic_states);
+    PTPipeline(VkDevice _device, VkPipelineCache _pipeline_cache, PTShader* _shader, PTRenderPass* _render_pass, PTSwapchain* _swapchain, VkBool32 _depth_write, VkBool32 _depth_test, VkCompareOp _depth_op, VkCullModeFlags _culling, VkFrontFace _winding_order, VkPolygonMode _polygon_mode, std::vector<VkDynamicState> _dynamic_states, bool defer_creation = false);
 
+    void createLayout();
     void createPipeline();
+    void rebuild();
 
     ~PTPipeline();
 
@@ -62,6 +69,7 @@ public:
     inline VkFrontFace getWindingOrder() const { return winding_order; }
     inline VkPolygonMode getPolygonMode() const { return polygon_mode; }
 
+    // pipelines are shared between every material with identical state, so these affect all of them
     void setDepthParams(VkBool32 write, VkBool32 test, VkCompareOp op);
     void setCulling(VkCullModeFlags cull);
     void setPolygonMode(VkPolygonMode mode);
@@ -12,8 +12,11 @@ public:
     struct Attachment
     {
         VkFormat format = VK_FORMAT_B8G8R8A8_SRGB;
-        VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
-        VkImageLayout final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+        // the render pass doesn't transition anything by default, whoever owns the images does that with barriers
+        VkImageLayout initial_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkImageLayout final_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         VkPipelineColorBlendAttachmentState blend_state = VkPipelineColorBlendAttachmentState
         {
             VK_TRUE,
@@ -32,8 +35,9 @@ private:
 
     VkRenderPass render_pass = VK_NULL_HANDLE;
     std::vector<Attachment> attachments;
+    Attachment depth_attachment;
 
-    PTRenderPass(VkDevice _device, std::vector<Attachment> _attachments = { }, bool transition_to_readable = false);
+    PTRenderPass(VkDevice _device, std::vector<Attachment> _attachments, Attachment _depth_attachment);
 
     ~PTRenderPass();
 
@@ -46,4 +50,8 @@ public:
 
     inline VkRenderPass getRenderPass() const { return render_pass; }
     inline std::vector<Attachment> getAttachments() const { return attachments; }
+    inline Attachment getDepthAttachment() const { return depth_attachment; }
+
+    // depth attachment with the usual format, which stays in the depth attachment layout. blend state is ignored for depth
+    static Attachment defaultDepthAttachment();
 };
\ No newline at end of file
@@ -19,12 +19,15 @@ class PTSwapchain;
 class PTShader;
 class PTRenderPass;
 class PTPipeline;
+class PTComputePipeline;
 class PTBuffer;
 class PTImage;
 class PTMesh;
 class PTTransform;
 class PTMaterial;
 class PTLightNode;
+class PTGPUProfiler;
+class PTFrameCapture;
 
 struct GLFWwindow;
 
@@ -36,8 +39,8 @@ private:
         PTMesh* mesh = nullptr;
         PTTransform* transform = nullptr;
         PTMaterial* material = nullptr;
-        std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptor_sets;
-        std::array<PTBuffer*, MAX_FRAMES_IN_FLIGHT> descriptor_buffers;
+        // pushed alongside the transform for each draw, so shaders can tell objects apart
+        uint32_t object_id = 0;
 
         static bool compare(const DrawRequest& a, const DrawRequest& b);
     };
@@ -46,13 +49,18 @@ public:
 	bool debug_mode = false;
 
 private:
-	bool wants_screenshot = false;
     bool window_resized = false;
+    // true if there's no window, in which case frames go to offscreen images and are never presented
+    bool headless = false;
+    // true if the device supports (and the build asked for) a global bindless texture array
+    bool bindless_textures = false;
+    // true if the device can count vertices and fragments for the gpu profiler
+    bool pipeline_statistics = false;
 
     int state = 0;
 
     VkInstance instance = VK_NULL_HANDLE;
-#ifndef NDEBUG
+#ifdef PT_VALIDATION
     VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
 #endif
     VkSurfaceKHR surface = VK_NULL_HANDLE;
@@ -64,8 +72,6 @@ private:
     VkCommandPool command_pool = VK_NULL_HANDLE;
     std::vector<VkCommandBuffer> command_buffers;
 
-    VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
-
     PTSwapchain* swapchain = nullptr;
     std::vector<VkSemaphore> image_available_semaphores;
     std::vector<VkSemaphore> render_finished_semaphores;
@@ -73,7 +79,20 @@ private:
 
     PTRGGraph* render_graph = nullptr;
 
+    // times each render graph step on the gpu, which also feeds dynamic resolution
+    PTGPUProfiler* gpu_profiler = nullptr;
+    // true to also time each material batch within camera steps. it's a lot of queries, so it's off by default
+    bool profile_material_batches = false;
+    // screenshots and frame sequences, read back and written out without waiting for the gpu
+    PTFrameCapture* frame_capture = nullptr;
+    PTResolutionScaler resolution_scaler;
+    // cpu time spent on the last frame, in milliseconds. recording covers sorting the draw queue and building the
+    // command buffer, submitting covers handing it to the queue, presenting, and waiting for the gpu to finish
+    float last_record_ms = 0.0f;
+    float last_submit_ms = 0.0f;
+
     std::array<PTBuffer*, MAX_FRAMES_IN_FLIGHT> scene_uniform_buffers;
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> scene_descriptor_sets;
     
     std::multimap<PTNode*, DrawRequest> draw_queue;
     std::set<PTLightNode*> light_set;
@@ -96,7 +115,7 @@ public:
     static void deinit();
     static PTRenderServer* get();
 
-	inline void setWantsScreenshot() { wants_screenshot = true; }
+	void setWantsScreenshot(std::string path = "screenshot.bmp");
 	inline void setWindowResized() { window_resized = true; }
 
     VkCommandBuffer beginTransientCommands();
@@ -108,7 +127,16 @@ public:
     void removeLight(PTLightNode* light);
 
     inline PTSwapchain* getSwapchain() const { return swapchain; }
+    inline bool isHeadless() const { return headless; }
+    inline float getLastRecordTime() const { return last_record_ms; }
+    inline float getLastSubmitTime() const { return last_submit_ms; }
     inline PTRenderPass* getRenderPass() const { return render_graph->getRenderPass(); }
+    inline PTGPUProfiler* getGPUProfiler() const { return gpu_profiler; }
+    inline PTFrameCapture* getFrameCapture() const { return frame_capture; }
+    inline bool getProfileMaterialBatches() const { return profile_material_batches; }
+    inline void setProfileMaterialBatches(bool enabled) { profile_material_batches = enabled; }
+    // switch to a different render graph file, if it isn't the one in use already
+    void setRenderGraph(std::string graph_path);
 
     void beginEditLock();
     void endEditLock();
@@ -127,21 +155,28 @@ private:
     void initVulkanInstance(std::vector<const char*>& layers, std::vector<const char*> extensions);
 	void initDevice(const std::vector<const char*>& layers);
     void createCommandPoolAndBuffers();
-    void createDescriptorPoolAndSets();
+    void createSceneDescriptorSets();
     void createFramebufferAndSyncResources();
 	void destroyFramebufferAndSyncResources();
 	VkResult createDebugUtilsMessenger(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, VkDebugUtilsMessengerEXT* pDebugMessenger);
     void destroyDebugUtilsMessenger(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger);
 
-    void updateSceneAndTransformUniforms(uint32_t frame_index);
+    void applyShaderReloads();
+    void applyRenderGraphReload();
+
+    void updateSceneUniforms(uint32_t frame_index);
     void updateTextureBindings();
+    void updateRenderScale();
+    void updateGPUProfileView();
     void drawFrame(uint32_t frame_index);
     void generateCameraRenderStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, std::vector<DrawRequest>& sorted_queue);
-    void generatePostProcessRenderStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, std::pair<PTMaterial*, VkDescriptorSet> material);
+    void bindSharedDescriptorSets(VkCommandBuffer command_buffer, VkPipelineLayout layout, VkDescriptorSet scene_set, VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS);
+    void generatePostProcessRenderStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, PTMaterial* material);
+    void generateComputeStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, PTComputePipeline* pipeline);
     void generateImageLayoutTransitionCommands(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage);
+    void generateBarrierCommands(VkCommandBuffer command_buffer, const PTRGBarrierBatch& barriers);
 
     void resizeSwapchain();
-    void takeScreenshot(uint32_t frame_index);
 
     PTPhysicalDevice selectPhysicalDevice();
     int evaluatePhysicalDevice(PTPhysicalDevice d);
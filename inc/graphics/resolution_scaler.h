@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// bounds for dynamic resolution, set per render graph (see DynamicResolution in .ptrg files)
+struct PTResolutionSettings
+{
+    bool enabled = false;
+    float target_ms = 1000.0f / 60.0f;  // gpu time per frame to aim for
+    float min_scale = 0.5f;             // smallest fraction of each camera target's width and height to render
+    float max_scale = 1.0f;             // largest, at most 1 since targets are allocated at full size
+};
+
+// picks a render scale for camera steps from measured gpu frame times. gpu cost goes roughly with pixel
+// count, so the scale moves with the square root of how far off target the frame time is. it drops quickly
+// when over budget, creeps back up when there's headroom, and holds still in between so it doesn't hunt
+class PTResolutionScaler
+{
+private:
+    float smoothed_ms = 0.0f;
+    uint32_t frames_since_change = 0;
+
+public:
+    /**
+     * @brief feed in the gpu time of a finished frame
+     * 
+     * @param gpu_ms how long the gpu spent on the frame
+     * @param current_scale render scale the frame was drawn at
+     * @param settings bounds to keep the scale within
+     * @returns the scale to draw at from now on
+     */
+    float update(float gpu_ms, float current_scale, const PTResolutionSettings& settings);
+    // forget the measurements so far, e.g. after the render graph changes
+    void reset();
+};
\ No newline at end of file
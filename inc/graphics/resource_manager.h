@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <string>
 #include <stdexcept>
 
@@ -17,23 +18,49 @@ class PTBuffer;
 class PTImage;
 class PTMesh;
 class PTPipeline;
+class PTComputePipeline;
 class PTRenderPass;
 class PTShader;
 class PTSwapchain;
 class PTMaterial;
 class PTSampler;
 class PTRGGraph;
+class PTShaderWatcher;
+class PTTextureTable;
+class PTDescriptorAllocator;
 
 class PTResourceManager
 {
 private:
     VkDevice device = VK_NULL_HANDLE;
     PTPhysicalDevice& physical_device;
+    // driver-side cache of compiled pipeline state, persisted to disk between runs
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+    // layout for the scene descriptor set, which is identical for every shader so one set can be
+    // bound across pipeline changes. material sets use the shader's own layout
+    VkDescriptorSetLayout scene_set_layout = VK_NULL_HANDLE;
+    // set 1 is the global texture array in bindless mode, and an empty layout otherwise, so that
+    // material sets always sit at the same index
+    VkDescriptorSetLayout empty_set_layout = VK_NULL_HANDLE;
+    // global texture array, only present in bindless mode
+    PTTextureTable* texture_table = nullptr;
+    // every other descriptor set comes out of here
+    PTDescriptorAllocator* descriptor_allocator = nullptr;
+
+    // set during warm-up, so pipeline compilation can be batched onto worker threads
+    bool deferring_pipelines = false;
+    std::vector<PTPipeline*> deferred_pipelines;
+    // references held on behalf of the warm-up, until whatever needed them has picked them up
+    std::vector<PTResource*> warm_resources;
+    // recompiles raw shaders in the background when their sources change
+    PTShaderWatcher* shader_watcher = nullptr;
+    // materials whose textures changed since their descriptor sets were last written
+    std::set<PTMaterial*> pending_texture_updates;
 
     std::multimap<std::string, PTResource*> resources;
 
 public:
-    static void init(VkDevice _device, PTPhysicalDevice& _physical_device);
+    static void init(VkDevice _device, PTPhysicalDevice& _physical_device, bool bindless_textures = false);
     static void deinit();
     static PTResourceManager* get();
 
@@ -42,8 +69,9 @@ public:
     PTImage* createImage(std::string texture_file, bool force_duplicate = false);
     PTMesh* createMesh(std::string file_name, bool force_duplicate = false);
     PTMesh* createMesh(std::vector<PTVertex> vertices, std::vector<uint16_t> indices);
-    PTPipeline* createPipeline(PTShader* shader, PTRenderPass* render_pass, PTSwapchain* swapchain, VkBool32 depth_write, VkBool32 depth_test, VkCompareOp depth_op, VkCullModeFlags culling, VkFrontFace winding_order, VkPolygonMode polygon_mode, std::vector<VkDynamicState> dynamic_states);
-    PTRenderPass* createRenderPass(std::vector<PTRenderPass::Attachment> attachments, bool transition_to_readable = false);
+    PTPipeline* createPipeline(PTShader* shader, PTRenderPass* render_pass, PTSwapchain* swapchain, VkBool32 depth_write, VkBool32 depth_test, VkCompareOp depth_op, VkCullModeFlags culling, VkFrontFace winding_order, VkPolygonMode polygon_mode, std::vector<VkDynamicState> dynamic_states, bool force_duplicate = false);
+    PTComputePipeline* createComputePipeline(std::string shader_path_stub, bool force_duplicate = false);
+    PTRenderPass* createRenderPass(std::vector<PTRenderPass::Attachment> attachments, PTRenderPass::Attachment depth_attachment = PTRenderPass::defaultDepthAttachment());
     PTShader* createShader(std::string shader_path_stub, bool is_precompiled, bool has_geometry_shader = false, bool force_duplicate = false);
     PTSwapchain* createSwapchain(VkSurfaceKHR surface, int window_x, int window_y);
     PTMaterial* createMaterial(std::string material_path, PTSwapchain* swapchain = nullptr, PTRenderPass* render_pass = nullptr, bool force_duplicate = false);
@@ -60,8 +88,31 @@ public:
     template<typename T>
     void releaseResource(T* resource);
 
+    void warmUp(std::vector<std::string> material_paths);
+    void warmUpScene(std::string scene_path);
+    void releaseWarmUp();
+
+    bool hasPendingShaderReloads() const;
+    std::set<PTShader*> applyShaderReloads();
+
+    void queueTextureUpdate(PTMaterial* material);
+    void cancelTextureUpdate(PTMaterial* material);
+    size_t applyTextureUpdates();
+
+    inline VkPipelineCache getPipelineCache() const { return pipeline_cache; }
+    inline VkDescriptorSetLayout getSceneSetLayout() const { return scene_set_layout; }
+    VkDescriptorSetLayout getTextureSetLayout() const;
+    inline bool usesBindlessTextures() const { return texture_table != nullptr; }
+    inline PTTextureTable* getTextureTable() const { return texture_table; }
+    inline PTDescriptorAllocator* getDescriptorAllocator() const { return descriptor_allocator; }
+
 private:
-    inline PTResourceManager(VkDevice _device, PTPhysicalDevice& _physical_device) : device(_device), physical_device(_physical_device) { };
+    PTResourceManager(VkDevice _device, PTPhysicalDevice& _physical_device, bool bindless_textures);
+
+    void loadPipelineCache();
+    void savePipelineCache();
+    void createCommonSetLayouts(bool bindless_textures);
+    VkDescriptorSetLayout createUniformSetLayout(uint16_t binding);
 
     template<typename T>
     T* tryGetExistingResource(std::string identifier);
@@ -15,7 +15,8 @@ private:
     VkFilter min_filter;
     VkFilter mag_filter;
     uint32_t max_anisotropy;
-    // TODO: mipmaps
+    // follows min_filter, so nearest samplers don't blend between mips either
+    VkSamplerMipmapMode mipmap_mode;
 
 public:
     PTSampler() = delete;
@@ -29,6 +30,7 @@ public:
     inline VkFilter getMinFilter() const { return min_filter; }
     inline VkFilter getMaxFilter() const { return mag_filter; }
     inline uint32_t getMaxAnisotropy() const { return max_anisotropy; }
+    inline VkSamplerMipmapMode getMipmapMode() const { return mipmap_mode; }
 
 private:
     PTSampler(VkDevice _device, VkSamplerAddressMode _address_mode, VkFilter _min_filter, VkFilter _mag_filter, uint32_t _max_anisotropy);
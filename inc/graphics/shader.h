@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 
 #include "resource.h"
 
@@ -16,6 +17,7 @@ public:
         uint16_t bind_point;
         uint32_t size;
         VkDescriptorType type;
+        VkShaderStageFlags stages = 0;
     };
 
     friend class PTResourceManager;
@@ -46,14 +48,24 @@ public:
     BindingInfo getDescriptorBinding(size_t index) const;
     bool hasDescriptorWithBinding(uint16_t binding, BindingInfo& out, size_t& index);
 
+    // compiling doesn't touch any shader state, so it's safe to do from any thread
+    static bool readRawAndCompile(std::string shader_path_stub, bool has_geometry_shader, std::vector<char>& vertex_code, std::vector<char>& fragment_code, std::vector<char>& geometry_code);
+    static std::set<std::string> getSourceFiles(std::string shader_path_stub, bool has_geometry_shader);
+    // compiles a single stage through the shader cache. also used for compute shaders, which aren't PTShaders
+    static bool compileStage(std::string source_path, std::string stage, std::vector<char>& code);
+
 private:
     PTShader(VkDevice _device, std::string shader_path_stub, bool is_precompiled, bool has_geometry_shader);
 
     ~PTShader();
 
-    bool readRawAndCompile(std::string shader_path_stub, std::vector<char>& vertex_code, std::vector<char>& fragment_code, std::vector<char>& geometry_code);
+    // swaps in the new code, or logs why it couldn't and leaves the shader untouched
+    bool reload(bool has_geometry_shader, const std::vector<char>& vertex_code, const std::vector<char>& fragment_code, std::vector<char>& geometry_code);
+
     bool readPrecompiled(std::string shader_path_stub, std::vector<char>& vertex_code, std::vector<char>& fragment_code, std::vector<char>& geometry_code);
+    static bool collectShaderSource(const std::string& path, std::string& out, std::set<std::string>& visited, size_t depth);
     void createShaderModules(const std::vector<char>& vertex_code, const std::vector<char>& fragment_code, std::vector<char>& geometry_code);
+    void reflectDescriptors(const std::vector<char>& code, VkShaderStageFlagBits stage, std::string stage_name);
     void createDescriptorSetLayout();
     void insertDescriptor(BindingInfo descriptor);
 };
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+
+// watches the source files (including headers) of raw shaders, and recompiles them on a background thread
+// when they change. the resulting code is collected by the resource manager and swapped in between frames
+class PTShaderWatcher
+{
+public:
+    struct Result
+    {
+        std::string shader_path_stub;
+        bool has_geometry_shader = false;
+        std::vector<char> vertex_code;
+        std::vector<char> fragment_code;
+        std::vector<char> geometry_code;
+    };
+
+private:
+    struct WatchedShader
+    {
+        bool has_geometry_shader = false;
+        std::set<std::string> source_files;
+    };
+
+    std::mutex watch_mutex;
+    std::map<std::string, WatchedShader> watched_shaders;
+
+    std::mutex result_mutex;
+    std::vector<Result> results;
+
+    std::atomic<bool> should_stop = false;
+    std::thread watch_thread;
+
+#ifdef __linux__
+    int inotify_fd = -1;
+    std::map<int, std::string> watched_directories;
+#else
+    std::map<std::string, std::filesystem::file_time_type> last_write_times;
+#endif
+
+public:
+    PTShaderWatcher();
+    ~PTShaderWatcher();
+
+    PTShaderWatcher(const PTShaderWatcher& other) = delete;
+    PTShaderWatcher(const PTShaderWatcher&& other) = delete;
+    PTShaderWatcher operator=(const PTShaderWatcher& other) = delete;
+    PTShaderWatcher operator=(const PTShaderWatcher&& other) = delete;
+
+    void watch(std::string shader_path_stub, bool has_geometry_shader);
+    bool hasResults();
+    std::vector<Result> takeResults();
+
+private:
+    void watchLoop();
+    std::set<std::string> waitForChanges();
+    void recompile(const std::set<std::string>& changed_files);
+    void watchFiles(const std::set<std::string>& files);
+};
\ No newline at end of file
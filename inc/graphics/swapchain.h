@@ -6,6 +6,10 @@
 #include "resource.h"
 #include "physical_device.h"
 
+class PTImage;
+
+// the images the render graph's output ends up in. normally a real swapchain, but created without a surface
+// (headless) it's just a few plain images of the same format, which are copied into and never presented
 class PTSwapchain : public PTResource
 {
     friend class PTResourceManager;
@@ -23,6 +27,8 @@ private:
     VkSurfaceTransformFlagBitsKHR transform;
     std::vector<VkImage> images;
     std::vector<VkImageView> image_views;
+    // only used when offscreen, these own the images above
+    std::vector<PTImage*> offscreen_images;
 
     PTSwapchain(VkDevice _device, PTPhysicalDevice& physical_device, VkSurfaceKHR surface, int window_x, int window_y);
 
@@ -42,10 +48,16 @@ public:
     inline VkExtent2D getExtent() const { return extent; }
     inline VkImage getImage(uint32_t index) const { return images[index]; }
     inline VkImageView getImageView(uint32_t index) const { return image_views[index]; }
+    inline bool isOffscreen() const { return swapchain == VK_NULL_HANDLE; }
+    // the layout images are left in once a frame has been copied to them
+    inline VkImageLayout getPresentLayout() const { return isOffscreen() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
 
     void resize(VkSurfaceKHR surface, int size_x, int size_y);
    
 private:
     void createSwapchain(VkSurfaceKHR surface);
     void collectImages();
+    void createOffscreenImages();
+    void createImageViews();
+    void destroyImages();
 };
\ No newline at end of file
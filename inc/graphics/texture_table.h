@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <array>
+
+#include "constant.h"
+
+class PTImage;
+class PTSampler;
+
+// the global texture array used in bindless mode. every texture/sampler pair in use gets a slot in one big
+// descriptor array, and materials just store slot indices in their uniform data. the set is created with
+// update-after-bind, so slots can be written without rebinding it or rebuilding anyone else's descriptors.
+// slots which stop being used are retired rather than freed, and only handed out again once every frame which
+// might still be reading them has finished
+class PTTextureTable
+{
+private:
+    struct Slot
+    {
+        PTImage* image = nullptr;
+        PTSampler* sampler = nullptr;
+        VkImageAspectFlags aspect = 0;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t users = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t capacity = 0;
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    // released while the frame slot at that index was the last one submitted (or being recorded)
+    std::array<std::vector<uint32_t>, MAX_FRAMES_IN_FLIGHT> retired_slots;
+    uint32_t current_frame = 0;
+    // so materials sharing a texture share a slot too
+    std::map<std::tuple<PTImage*, PTSampler*, VkImageAspectFlags>, uint32_t> slot_lookup;
+
+public:
+    PTTextureTable(VkDevice _device, uint32_t _capacity);
+    ~PTTextureTable();
+
+    PTTextureTable(const PTTextureTable& other) = delete;
+    PTTextureTable(const PTTextureTable&& other) = delete;
+    PTTextureTable operator=(const PTTextureTable& other) = delete;
+    PTTextureTable operator=(const PTTextureTable&& other) = delete;
+
+    inline VkDescriptorSetLayout getLayout() const { return layout; }
+    inline VkDescriptorSet getDescriptorSet() const { return descriptor_set; }
+    inline uint32_t getCapacity() const { return capacity; }
+
+    uint32_t acquire(PTImage* image, PTSampler* sampler, VkImageAspectFlags aspect);
+    void release(uint32_t index);
+    // free everything retired during this frame slot's last go round. only call once the slot's fence has been
+    // waited on
+    void collect(uint32_t frame_index);
+
+private:
+    void freeSlot(uint32_t index);
+};
\ No newline at end of file
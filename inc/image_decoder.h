@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <functional>
+
+enum PTImagePixelFormat
+{
+    PIXEL_RGBA8,
+    // what hdr images decode to, half floats with alpha always 1
+    PIXEL_RGBA16F
+};
+
+struct PTImageInfo
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PTImagePixelFormat format = PTImagePixelFormat::PIXEL_RGBA8;
+};
+
+// where decoded pixels go. rows are handed out one at a time, so they can go straight into their final home (e.g. a
+// mapped staging buffer) without the whole image being held anywhere else first
+struct PTImageSink
+{
+    // called once the header has been read and before any rows, return false to give up on the image
+    std::function<bool(const PTImageInfo& info)> begin;
+    // where row y should be written, width * bytes per pixel. row 0 is the bottom of the image, whatever order the
+    // file stores them in, since that's what the engine's uvs expect
+    std::function<uint8_t*(uint32_t y)> row;
+};
+
+uint32_t imagePixelSize(PTImagePixelFormat format);
+
+/**
+ * @brief decode a bmp, png, tga or radiance hdr image into a sink. the format is worked out from the file's contents
+ * (or its extension, for tga which has no signature)
+ *
+ * @returns false if the file couldn't be read, isn't a supported format, or the sink gave up
+ */
+bool decodeImage(const std::string& path, const PTImageSink& sink);
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief decompress a zlib stream (header, deflate blocks and trailer), as found in png files. the adler32 checksum
+ * isn't verified, a corrupt stream is only caught if it stops making sense as deflate data
+ *
+ * @param out decompressed bytes are appended here. reserving the expected size first avoids reallocating as it grows
+ * @param max_out the most out is allowed to hold, so a stream can't expand into more memory than the caller expects
+ *
+ * @returns false if the stream is malformed, truncated or would go over max_out
+ */
+bool zlibInflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t max_out = SIZE_MAX);
\ No newline at end of file
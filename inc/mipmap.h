@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// one level of a mip chain packed into a single buffer, tightly packed rgba8
+struct PTMipLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t offset = 0;
+};
+
+// full chain down to 1x1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+// where each level of a full rgba8 chain goes if they're packed one after another, level 0 first
+std::vector<PTMipLevel> mipChainLayoutRGBA8(uint32_t width, uint32_t height);
+size_t mipChainSizeRGBA8(const std::vector<PTMipLevel>& levels);
+
+/**
+ * @brief build a mip chain on the cpu with a 2x2 box filter. srgb data is averaged in linear space, alpha never is.
+ * this is the fallback for formats the gpu can't blit with filtering, and for cooking textures offline
+ *
+ * @param chain laid out as levels describes, with level 0 already filled in. everything after it is overwritten
+ */
+void generateMipChainRGBA8(uint8_t* chain, const std::vector<PTMipLevel>& levels, bool srgb);
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+// cpu profiling. put PT_PROFILE_ZONE("name") at the top of a scope and the time spent in it is recorded when the
+// scope ends, into a ring buffer belonging to the calling thread, so recording never takes a lock. profileDumpTrace
+// writes whatever is still in the buffers out as a chrome trace, which opens in perfetto or chrome://tracing.
+// zones are compiled out of release (NDEBUG) builds unless PT_PROFILE is defined too
+#if !defined(NDEBUG) || defined(PT_PROFILE)
+#define PT_PROFILING_ENABLED
+#endif
+
+#define PT_PROFILE_CONCAT_INNER(a, b) a##b
+#define PT_PROFILE_CONCAT(a, b) PT_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PT_PROFILING_ENABLED
+// the name is kept as a pointer, so it has to be a string literal (or otherwise live forever)
+#define PT_PROFILE_ZONE(name) PTProfileZone PT_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PT_PROFILE_ZONE(name)
+#endif
+
+uint64_t profileNow();
+void profileRecord(const char* name, uint64_t start_ns, uint64_t end_ns);
+// name the calling thread in traces, otherwise it shows up numbered
+void profileSetThreadName(std::string name);
+bool profileDumpTrace(std::string path);
+
+class PTProfileZone
+{
+private:
+    const char* name;
+    uint64_t start;
+
+public:
+    inline PTProfileZone(const char* _name) : name(_name), start(profileNow()) { }
+    inline ~PTProfileZone() { profileRecord(name, start, profileNow()); }
+
+    PTProfileZone(const PTProfileZone& other) = delete;
+    PTProfileZone(const PTProfileZone&& other) = delete;
+    PTProfileZone operator=(const PTProfileZone& other) = delete;
+    PTProfileZone operator=(const PTProfileZone&& other) = delete;
+};
\ No newline at end of file
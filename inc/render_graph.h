@@ -2,10 +2,15 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <cstdint>
+#include <chrono>
+#include <filesystem>
 #include <vulkan/vulkan.h>
 
 #include "resource.h"
 #include "resource_manager.h"
+#include "resolution_scaler.h"
 
 // the render graph consists of a timeline of instructions - either cameras to draw, or post process steps to run
 // each command will have inputs and outputs which read from and write to buffers
@@ -13,6 +18,10 @@
 // one buffer is the framebuffer, and can only be written to once
 // cameras will output colour, depth, and extra buffers, and you can choose which you want to keep in buffers
 // then any of those can be bound to inputs on post process steps, which can also have multiple outputs
+// post process steps either draw a fullscreen quad with a material, or dispatch a compute shader which writes
+// straight into storage images, skipping the render pass entirely (better for pure image-space filters)
+// steps whose outputs never make it to the final image are culled, and the rest may run in a different order
+// as long as every step still sees the same buffer contents it would have in the listed order
 
 /*
      buf a          buf b        framebuffer
@@ -24,18 +33,58 @@
                                  buf a   buf b
 */
 
+// graphs are normally loaded from .ptrg files (see res/demo.ptrg), which look something like this:
+//     Resource(material, "res/pp_demo.ptmat") : pp;
+//     CameraStep(camera = 0, colour = 0, depth = 1, size = [ 640, 360 ], clear_colour = [ 0, 0, 0, 1 ]);
+//     ProcessStep(material = @pp, colour = 2) { Input(buffer = 0, binding = 2); };
+//     Final(buffer = 2);
+// compute steps name a compute shader instead, and list their outputs as storage image bindings:
+//     Resource(compute, "res/pp_blur") : blur;
+//     ComputeStep(shader = @blur) { Input(buffer = 0, binding = 2); Output(buffer = 2, binding = 3); };
+// outputs which aren't given go to the spare images and are thrown away, and scenes can pick a graph
+// with RenderGraph("path.ptrg");
+// graphs can also turn on dynamic resolution, which shrinks camera steps to keep the gpu frame time on target:
+//     DynamicResolution(target_ms = 16.6, min_scale = 0.5, max_scale = 1);
+// camera targets are still allocated at full size, only the top left corner is rendered to, so changing the
+// scale never re-creates anything. steps reading camera outputs should scale their uvs by scene.render_scale
+
 const VkImageUsageFlags IMAGE_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 const VkFormat EXTRA_FORMAT = VK_FORMAT_R16G16B16A16_SNORM;
 const VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+// format of images written by compute steps. storage support for this one is mandatory, unlike the swapchain format
+const VkFormat COMPUTE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
 
 class PTRenderPass;
 class PTImage;
 class PTMaterial;
 class PTSwapchain;
+class PTSampler;
+class PTComputePipeline;
 
 // TODO: right now multi camera support is impossible. we would need extra uniform buffers (and descriptor sets, ugh) to support it
 // TODO: simple copy step
 
+/**
+ * @brief a set of image barriers to be recorded together in a single `vkCmdPipelineBarrier`
+ */
+struct PTRGBarrierBatch
+{
+    std::vector<VkImageMemoryBarrier> image_barriers;   // one for each image which needs a layout change or a hazard resolving
+    VkPipelineStageFlags src_stages = 0;                // stages which last accessed the images
+    VkPipelineStageFlags dst_stages = 0;                // stages which are about to access them
+};
+
+/**
+ * @brief one image a compute step reads or writes, worked out when the graph is configured
+ */
+struct PTRGComputeBinding
+{
+    int image_index = 0;                                            // image buffer to bind
+    uint16_t binding = 0;                                           // binding in the compute shader's set
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+};
+
 /**
  * @brief describes a step in the render graph
  */
@@ -43,10 +92,15 @@ struct PTRGStep
 {
     friend class PTRGGraph;
 private:
-    // descriptor sets to be used, assigned by the graph class, do not touch
-    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptor_sets;
     // framebuffer to be used, assigned by the graph class, do not touch
     VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    // render pass with load/store ops worked out for this step, assigned by the graph class
+    PTRenderPass* step_render_pass = nullptr;
+    // barriers to record before this step, assigned by the graph class
+    PTRGBarrierBatch barriers;
+    // a compute step's input and output images, assigned by the graph class. they're written into a fresh
+    // transient set every frame, so images can be re-created without touching a set a frame in flight is using
+    std::vector<PTRGComputeBinding> compute_bindings;
 
 public:
     int colour_buffer_binding = 0;  // image index to send colour output to
@@ -70,8 +124,14 @@ public:
 
     // material to use for rendering, if post-processing
     PTMaterial* process_material = nullptr;
-    // mappings between image buffer indices to material texture slots
+    // mappings between image buffer indices to material texture slots (or compute shader sampler bindings)
     std::vector<std::pair<int, uint16_t>> process_inputs;
+
+    bool is_compute_step = false;   // true if this post-process step dispatches a compute shader instead of drawing (is_camera_step must be false)
+    // compute shader to dispatch, if computing. the attachment bindings above are ignored
+    PTComputePipeline* compute_pipeline = nullptr;
+    // mappings between image buffer indices and the storage image bindings a compute step writes to
+    std::vector<std::pair<int, uint16_t>> compute_outputs;
 };
 
 /**
@@ -83,6 +143,8 @@ struct PTRGStepInfo
     VkFramebuffer framebuffer = VK_NULL_HANDLE; // framebuffer to be used when rendering (combines assigned image buffers)
     VkExtent2D extent;                          // size of the target buffers (should be used for scissor and viewport)
     std::array<VkClearValue, 4> clear_values;   // clear values to use when starting render pass
+    const PTRGBarrierBatch* barriers = nullptr; // barriers to record before starting render pass
+    VkDescriptorSet compute_descriptor_set = VK_NULL_HANDLE; // input and output images, for compute steps only. transient
 };
 
 /**
@@ -96,21 +158,39 @@ class PTRGGraph : public PTResource
 private:
     VkDevice device = VK_NULL_HANDLE;           // vulkan device reference
     PTSwapchain* swapchain = nullptr;           // swapchain reference
-    // descriptor pool used to allocate for post-process timeline steps
-    VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
-
-    // the sequence of render steps to execute
+    // the sequence of render steps, as configured
     std::vector<PTRGStep> timeline_steps;
-    // transform uniform buffer shared by all post-process timeline steps
-    PTBuffer* shared_transform_uniforms;
+    // indices into the timeline of the steps which actually run, in the order they run. steps nothing depends on
+    // are left out. compiled by `configure` and `resize`, and everything else goes through this
+    std::vector<size_t> schedule;
     // array of scene uniform buffers shared by all post-process timeline steps
     std::array<PTBuffer*, MAX_FRAMES_IN_FLIGHT> shared_scene_uniforms;
-    // array of image buffers which can be used as post process inputs or render targets
+    // scene descriptor sets pointing at the shared scene uniform buffers
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> scene_descriptor_sets;
+    // array of image buffers which can be used as post process inputs or render targets. buffers which are
+    // never in use at the same time may point at the same image, and unused indices are left null
     std::vector<std::pair<PTImage*, VkImageView>> image_buffers;
+    // the images actually backing the image buffers, each only once
+    std::vector<std::pair<PTImage*, VkImageView>> physical_images;
     // index in the image buffer array of the image to be shown to the screen (or -1 to use the spare colour buffer)
     int final_image_index = -1;
-    // render pass used by all timeline steps
+    // render pass which pipelines are built against. every step's own render pass is compatible with it
     PTRenderPass* render_pass;
+    // render passes differing only in load/store ops, keyed by the ops for each attachment (depth last)
+    std::map<std::vector<std::pair<VkAttachmentLoadOp, VkAttachmentStoreOp>>, PTRenderPass*> render_pass_variants;
+    // barriers to record after the last step, which get the final image ready to be copied from
+    PTRGBarrierBatch final_barriers;
+    // dynamic resolution bounds, and the fraction of their full extent camera steps currently render at
+    PTResolutionSettings resolution_settings;
+    float render_scale = 1.0f;
+    // true if the final image is last written by a camera step, so only part of it is filled at lower scales
+    bool final_image_scaled = false;
+    // sampler used for compute step inputs
+    PTSampler* compute_sampler = nullptr;
+    // .ptrg file the graph was last configured from (if any), and when it was written, for hot reloading
+    std::string source_path;
+    std::filesystem::file_time_type source_write_time;
+    std::chrono::steady_clock::time_point last_source_check;
 
     // images and image views for use when attachments are not going to be used as inputs
 
@@ -123,7 +203,17 @@ private:
     PTImage* spare_extra_image = nullptr;
     VkImageView spare_extra_image_view = VK_NULL_HANDLE;
 
-    PTRGGraph(VkDevice _device, PTSwapchain* _swapchain, std::string timeline_path);
+    // what an image buffer needs to be, and when in the timeline it's in use
+    struct BufferUsage
+    {
+        bool declared = false;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent = VkExtent2D{ 0, 0 };
+        size_t first_write = SIZE_MAX;  // schedule position of the first step which writes to it
+        size_t last_use = 0;            // schedule position of the last step which reads or writes it (step count for the final image)
+        bool pinned = false;            // read before it's written, so its contents have to last into the next frame
+    };
+
     PTRGGraph(VkDevice _device, PTSwapchain* _swapchain);
     ~PTRGGraph();
 
@@ -136,30 +226,90 @@ private:
      * @brief create the render pass and the uniform buffers
      */
     void generateRenderPassAndUniformBuffers();
+    /**
+     * @brief compile the timeline into a dependency graph using the process inputs and output bindings, cull steps
+     * which don't contribute to the final image, and order the rest into the schedule
+     */
+    void compileSchedule();
+    /**
+     * @brief get a step by its position in the schedule
+     */
+    inline PTRGStep& getScheduledStep(size_t position) { return timeline_steps[schedule[position]]; }
+    inline const PTRGStep& getScheduledStep(size_t position) const { return timeline_steps[schedule[position]]; }
     /**
      * @brief generate an image and imageview appropriate for a specified format
      * 
      * @param target image pointer to initialise
      * @param format format to use for the image. determines some other flags for image and view creation
      * @param extent extent to use for image creation
+     * @param transient true if the image is never read outside of a render pass, so it can use lazily allocated memory
      * @returns generated image view, appropriate for the format given
      */
-    VkImageView prepareImage(PTImage*& target, VkFormat format, VkExtent2D extent);
+    VkImageView prepareImage(PTImage*& target, VkFormat format, VkExtent2D extent, bool transient = false);
+    /**
+     * @brief get the extent a step renders at (for camera steps, before scaling)
+     */
+    VkExtent2D getStepExtent(const PTRGStep& step) const;
+    /**
+     * @brief shrink an extent by the current render scale, keeping at least one pixel
+     */
+    VkExtent2D getScaledExtent(VkExtent2D extent) const;
+    /**
+     * @brief record that a step writes to an image buffer, checking it agrees with any earlier use
+     * 
+     * @param binding index into image array. set to -1 (the spare image) if it conflicts with an earlier use
+     * @param format format of the attachment being bound
+     * @param extent size of the attachment being bound
+     * @param step_index schedule position of the step writing to the buffer
+     * @param usages usage information for each image buffer, grown as needed
+     */
+    void declareImageBuffer(int& binding, VkFormat format, VkExtent2D extent, size_t step_index, std::vector<BufferUsage>& usages);
     /**
-     * @brief configure the image for a binding, either by creating a new image in the array or
-     * by initialising the spare image
+     * @brief initialise a spare image if a binding needs it
      * 
-     * @param binding index into image array, or -1 to use the spare image
-     * @param spare_image spare image pointer to initialise if binding is -1 and spare image is nullptr
+     * @param binding index into image array, the spare image is only needed if this is -1
+     * @param spare_image spare image pointer to initialise if it's nullptr
      * @param spare_image_view image view to pair with the spare image
      * @param format format of the image to generate, passed into `prepareImage`
-     * @param _extent size of the image to generate
+     * @param extent size of the image to generate
+     * @param transient true if the spare image is never read, passed into `prepareImage`
      */
-    void createImageBufferForBinding(int& binding, PTImage*& spare_image, VkImageView& spare_image_view, VkFormat format, VkExtent2D _extent);
+    void prepareSpareImage(int binding, PTImage*& spare_image, VkImageView& spare_image_view, VkFormat format, VkExtent2D extent, bool transient);
     /**
-     * @brief construct the images needed for all the timeline steps and combine them into framebuffers
+     * @brief construct the images needed for all the timeline steps and combine them into framebuffers.
+     * image buffers with non-overlapping lifetimes share images where they can
      */
     void generateImagesAndFramebuffers();
+    /**
+     * @brief get the index used to track the image bound to an attachment. spare images are
+     * tracked at indices past the end of the image buffer array, in attachment order
+     * 
+     * @param binding image index bound to the attachment, or -1 for the spare image
+     * @param attachment attachment index (colour, normal, extra, depth)
+     * @returns tracking index for the image
+     */
+    size_t getTrackedIndex(int binding, size_t attachment) const;
+    /**
+     * @brief get the image at a tracking index (see `getTrackedIndex`)
+     */
+    PTImage* getTrackedImage(size_t index) const;
+    /**
+     * @brief check whether an input binding of a step will actually be linked to its material (or compute set)
+     */
+    bool isValidInput(const PTRGStep& step, int binding) const;
+    /**
+     * @brief follow every image through the timeline to work out which barriers each step needs, and which
+     * attachments actually need loading and storing. also moves the freshly created images into the layouts
+     * they're expected to be in at the start of a frame
+     */
+    void generateBarriersAndRenderPasses();
+    /**
+     * @brief find or create a render pass with specific load/store ops
+     * 
+     * @param ops load and store op for each colour attachment, followed by the depth attachment
+     * @returns render pass compatible with the main render pass
+     */
+    PTRenderPass* getRenderPassVariant(const std::vector<std::pair<VkAttachmentLoadOp, VkAttachmentStoreOp>>& ops);
     /**
      * @brief apply textures to a post-process step's material
      * 
@@ -167,9 +317,23 @@ private:
      */
     void linkTexturesToMaterial(const PTRGStep& step);
     /**
-     * @brief configure descriptor sets for each post-process timeline step and apply texture bindings
+     * @brief work out which images each compute step binds, reporting anything the shader doesn't have a binding for
+     */
+    void resolveComputeBindings();
+    /**
+     * @brief allocate a transient descriptor set for a compute step and write its images into it
+     *
+     * @param frame_index frame slot the set will be used by. it's reset once that slot comes round again
+     */
+    VkDescriptorSet writeComputeDescriptorSet(const PTRGStep& step, uint32_t frame_index) const;
+    /**
+     * @brief allocate the scene descriptor sets shared by all post-process timeline steps
      */
-    void createMaterialDescriptorSets();
+    void createSharedDescriptorSets();
+    /**
+     * @brief apply texture bindings for each post-process timeline step and update the material descriptor sets
+     */
+    void linkAllTexturesToMaterials();
     /**
      * @brief destroy all resources associated with the render graph
      */
@@ -182,17 +346,42 @@ private:
 public:
     inline PTRenderPass* getRenderPass() const { return render_pass; }
     inline PTImage* getFinalImage() const { return final_image_index < 0 ? spare_colour_image : image_buffers[final_image_index].first; }
-    inline size_t getStepCount() const { return timeline_steps.size(); }
-    inline bool getStepIsCamera(size_t step_index) const { return timeline_steps[step_index].is_camera_step; }
-    inline size_t getStepCameraSlot(size_t step_index) const { return timeline_steps[step_index].camera_slot; }
-    inline std::pair<PTMaterial*, VkDescriptorSet> getStepMaterial(size_t step_index, uint32_t frame_index) const
-    {
-        return std::pair<PTMaterial*, VkDescriptorSet>(timeline_steps[step_index].process_material, timeline_steps[step_index].descriptor_sets[frame_index]);
-    }
-    PTRGStepInfo getStepInfo(size_t step_index) const;
+    // steps are indexed by their position in the compiled schedule, not the order they were configured in
+    inline size_t getStepCount() const { return schedule.size(); }
+    inline bool getStepIsCamera(size_t step_index) const { return getScheduledStep(step_index).is_camera_step; }
+    inline size_t getStepCameraSlot(size_t step_index) const { return getScheduledStep(step_index).camera_slot; }
+    inline PTMaterial* getStepMaterial(size_t step_index) const { return getScheduledStep(step_index).process_material; }
+    inline bool getStepIsCompute(size_t step_index) const { return getScheduledStep(step_index).is_compute_step; }
+    inline PTComputePipeline* getStepComputePipeline(size_t step_index) const { return getScheduledStep(step_index).compute_pipeline; }
+    inline VkDescriptorSet getSceneDescriptorSet(uint32_t frame_index) const { return scene_descriptor_sets[frame_index]; }
+    inline const PTRGBarrierBatch& getFinalBarriers() const { return final_barriers; }
+    inline const std::string& getSourcePath() const { return source_path; }
+    inline const PTResolutionSettings& getResolutionSettings() const { return resolution_settings; }
+    inline float getRenderScale() const { return render_scale; }
+    // takes effect from the next frame recorded. nothing is re-created, so this is fine to call every frame
+    inline void setRenderScale(float scale) { render_scale = scale; }
+    // the part of the final image which holds the frame
+    VkExtent2D getFinalExtent() const;
+    /**
+     * @brief get everything needed to record a step. compute steps get a transient descriptor set, which is only
+     * valid for the frame slot it's recorded into
+     */
+    PTRGStepInfo getStepInfo(size_t step_index, uint32_t frame_index) const;
 
     void resize();
-    void updateUniforms(const SceneUniforms& scene_uniforms, const TransformUniforms& transform_uniforms, uint32_t frame_index);
+    void updateUniforms(const SceneUniforms& scene_uniforms, uint32_t frame_index);
 
-    void configure(const std::vector<PTRGStep>& steps, int final_image);
+    void configure(const std::vector<PTRGStep>& steps, int final_image, const PTResolutionSettings& resolution = PTResolutionSettings{ });
+    /**
+     * @brief configure the render graph from a .ptrg file. the graph holds onto the materials and compute shaders its steps use
+     * 
+     * @param graph_path path to the render graph file
+     * @returns true if the file was loaded. otherwise the current configuration is kept
+     */
+    bool configure(const std::string& graph_path);
+    /**
+     * @brief check whether the file the graph was configured from has been written since. the file is
+     * only actually looked at a few times a second, so this is fine to call every frame
+     */
+    bool hasSourceChanged();
 };
\ No newline at end of file
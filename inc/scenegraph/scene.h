@@ -2,6 +2,7 @@
 
 #include <map>
 #include <vector>
+#include <string>
 
 #include "node.h"
 #include "camera_node.h"
@@ -15,6 +16,8 @@ private:
     std::multimap<std::string, PTNode*> all_nodes;
     PTNode* root = nullptr;
     PTCameraNode* camera = nullptr;
+    // render graph the scene asked to be drawn with, empty for the default one
+    std::string render_graph_path;
 
 public:
     PTScene(PTScene& other) = delete;
@@ -37,6 +40,8 @@ public:
     void update(float delta_time);
 
     inline PTCameraNode* getCamera() const { return camera; }
+    inline const std::string& getRenderGraphPath() const { return render_graph_path; }
+    inline void setRenderGraphPath(const std::string& path) { render_graph_path = path; }
     void getCameraMatrix(float aspect_ratio, PTMatrix4f& world_to_view, PTMatrix4f& view_to_clip);
 
 private:
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// pixel format conversion kernels. each has an avx2 or ssse3 version (whichever the build targets, see MARCH in the
+// makefile) with an sse2 or scalar fallback, and all of them are fine to run with src == dst
+
+// swaps the first and third channel of every pixel, so rgba <-> bgra
+void swizzleRGBAToBGRA(const uint8_t* src, uint8_t* dst, size_t pixels);
+// bgr (like 24 bit bmps and tgas) to rgba with alpha 255. can't be in place, dst is bigger than src
+void expandBGRToRGBA(const uint8_t* src, uint8_t* dst, size_t pixels);
+
+// which version of the kernels got compiled in, for the benchmark
+const char* swizzleKernelName();
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// pixel formats a cooked texture can be stored in. the bc formats are stored exactly as the gpu wants them, so
+// loading one is just a copy
+enum PTTextureFormat : uint32_t
+{
+    RGBA8 = 0,
+    BC1 = 1,    // rgb, 4 bits per texel
+    BC3 = 2,    // rgba, 8 bits per texel
+    BC5 = 3,    // two channel (normal maps), 8 bits per texel, never srgb
+    BC7 = 4     // rgba, 8 bits per texel, best quality
+};
+
+#pragma pack(push)
+#pragma pack(1)
+struct PTTextureFileHeader
+{
+    uint8_t magic[4] = { 'P', 'T', 'T', 'X' };
+    uint32_t version = 1;
+    uint32_t format = PTTextureFormat::RGBA8;
+    uint32_t srgb = 1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mip_count = 0;
+};
+
+// one of these per mip follows the header, then the data for all of them
+struct PTTextureFileLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+#pragma pack(pop)
+
+struct PTTextureFile
+{
+    PTTextureFormat format = PTTextureFormat::RGBA8;
+    bool srgb = true;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // offsets are into data
+    std::vector<PTTextureFileLevel> levels;
+    std::vector<uint8_t> data;
+};
+
+// bytes per 4x4 block for bc formats, or per texel for rgba8
+uint32_t textureFormatBlockBytes(PTTextureFormat format);
+bool textureFormatIsCompressed(PTTextureFormat format);
+size_t textureLevelSize(PTTextureFormat format, uint32_t width, uint32_t height);
+
+bool writeTextureFile(std::string path, const PTTextureFile& texture);
+bool readTextureFile(std::string path, PTTextureFile& texture);
\ No newline at end of file
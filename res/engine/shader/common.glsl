@@ -1,14 +1,20 @@
+#ifdef BINDLESS_TEXTURES
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 #define VERTEX_INPUTS layout(location = 0) in vec3 vert_position; \
 layout(location = 1) in vec3 vert_colour; \
 layout(location = 2) in vec3 vert_normal; \
 layout(location = 3) in vec3 vert_tangent; \
 layout(location = 4) in vec2 vert_uv;
 
-#define UNIFORM_TRANSFORM layout(binding = 0) uniform TransformUniforms \
+#define SCENE_SET 0
+#define TEXTURE_SET 1
+#define MATERIAL_SET 2
+
+#define UNIFORM_TRANSFORM layout(push_constant) uniform TransformConstants \
 { \
     mat4 model_to_world; \
-    mat4 world_to_view; \
-    mat4 view_to_clip; \
     uint object_id; \
 } transform;
 
@@ -22,15 +28,37 @@ struct LightDescription
     float cos_half_ang_radians;
 };
 
-#define UNIFORM_SCENE layout(binding = 1) uniform SceneUniforms \
+#define UNIFORM_SCENE layout(set = SCENE_SET, binding = 1) uniform SceneUniforms \
 { \
+    mat4 world_to_view; \
+    mat4 view_to_clip; \
 	vec2 viewport_size; \
     float time; \
+    float render_scale; \
     LightDescription[16] lights; \
 } scene;
 
 #define UNIFORM_OFFSET 2
 
+// declare material textures with MATERIAL_TEXTURE(n, name) and sample them through MATERIAL_SAMPLER(name), so
+// the same shader works in both modes. in bindless mode the textures live in one global array, and the material
+// only holds indices into it (binding 0 of the material set)
+#define MAX_MATERIAL_TEXTURES 16
+
+#ifdef BINDLESS_TEXTURES
+layout(set = TEXTURE_SET, binding = 0) uniform sampler2D bindless_textures[];
+layout(set = MATERIAL_SET, binding = 0) uniform MaterialTextureIndices
+{
+    uvec4 indices[MAX_MATERIAL_TEXTURES / 4];
+} material_textures;
+
+#define MATERIAL_TEXTURE(n, name) const uint name = UNIFORM_OFFSET + n;
+#define MATERIAL_SAMPLER(name) bindless_textures[material_textures.indices[name / 4][name % 4]]
+#else
+#define MATERIAL_TEXTURE(n, name) layout(set = MATERIAL_SET, binding = UNIFORM_OFFSET + n) uniform sampler2D name;
+#define MATERIAL_SAMPLER(name) name
+#endif
+
 #define VARYING_COMMON(io) layout(location = 0) io CommonVaryings \
 { \
     vec3 position; \
@@ -53,7 +81,7 @@ varyings.bitangent = cross(varyings.normal, varyings.tangent); \
 varyings.uv = vert_uv; \
 varyings.world_position = (transform.model_to_world * vec4(varyings.position, 1.0)).xyz; \
 varyings.world_normal = (normalize(transform.model_to_world * vec4(varyings.normal, 0.0))).xyz; \
-gl_Position = transform.view_to_clip * transform.world_to_view * vec4(varyings.world_position, 1.0f);
+gl_Position = scene.view_to_clip * scene.world_to_view * vec4(varyings.world_position, 1.0f);
 
 #define FRAGMENT_OUTPUTS layout(location = 0) out vec4 frag_colour; \
 layout(location = 1) out vec4 frag_normal; \
@@ -6,7 +6,7 @@
 UNIFORM_TRANSFORM
 UNIFORM_SCENE
 
-layout(binding = UNIFORM_OFFSET + 0) uniform MaterialProperties
+layout(set = MATERIAL_SET, binding = UNIFORM_OFFSET + 0) uniform MaterialProperties
 {
     vec3 colour;
 } properties;
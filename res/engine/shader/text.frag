@@ -6,7 +6,7 @@
 UNIFORM_TRANSFORM
 UNIFORM_SCENE
 
-layout(binding = UNIFORM_OFFSET + 0) uniform TextBuffer
+layout(set = MATERIAL_SET, binding = UNIFORM_OFFSET + 0) uniform TextBuffer
 {
     vec2 fontmap_glyph_size;
     float aspect_ratio;
@@ -17,7 +17,7 @@ layout(binding = UNIFORM_OFFSET + 0) uniform TextBuffer
 } text_buffer;
 
 // font texture should be 16x16 characters
-layout(binding = UNIFORM_OFFSET + 1) uniform sampler2D font_texture;
+MATERIAL_TEXTURE(1, font_texture)
 
 VARYING_COMMON(in)
 
@@ -31,7 +31,7 @@ vec2 flipUV(vec2 uv)
 
 void main()
 {
-    vec2 fontmap_size_chars = textureSize(font_texture, 0) / text_buffer.fontmap_glyph_size;
+    vec2 fontmap_size_chars = textureSize(MATERIAL_SAMPLER(font_texture), 0) / text_buffer.fontmap_glyph_size;
     float font_aspect_ratio = text_buffer.fontmap_glyph_size.y / text_buffer.fontmap_glyph_size.x;
 
     float tb_width_chars = float(text_buffer.characters_per_line);
@@ -50,7 +50,7 @@ void main()
     float font_y = floor(char / fontmap_size_chars.x) / fontmap_size_chars.y;
     vec2 font_uv = (fract(tile_uv) / fontmap_size_chars) + vec2(font_x, font_y);
 
-    float tex_val = texture(font_texture, flipUV(font_uv)).g;
+    float tex_val = texture(MATERIAL_SAMPLER(font_texture), flipUV(font_uv)).g;
     vec4 colour = (tex_val > 0.3f) ? text_buffer.text_colour : text_buffer.background_colour;
     if (colour.a <= 0.3f)
         discard;
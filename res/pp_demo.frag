@@ -6,10 +6,10 @@
 UNIFORM_TRANSFORM
 UNIFORM_SCENE
 
-layout(binding = UNIFORM_OFFSET + 0) uniform sampler2D albedo_texture;
-layout(binding = UNIFORM_OFFSET + 1) uniform sampler2D depth_texture;
-layout(binding = UNIFORM_OFFSET + 2) uniform sampler2D normal_texture;
-layout(binding = UNIFORM_OFFSET + 3) uniform sampler2D extra_texture;
+MATERIAL_TEXTURE(0, albedo_texture)
+MATERIAL_TEXTURE(1, depth_texture)
+MATERIAL_TEXTURE(2, normal_texture)
+MATERIAL_TEXTURE(3, extra_texture)
 
 VARYING_COMMON(in)
 FRAGMENT_OUTPUTS
@@ -17,21 +17,23 @@ FRAGMENT_OUTPUTS
 void main()
 {
     vec2 inv_size = 2.0f / scene.viewport_size;
+    // the camera step only fills the corner of its targets when dynamic resolution has scaled it down
+    vec2 uv = varyings.uv * scene.render_scale;
 
-    vec3 c_up = texture(albedo_texture, varyings.uv + (inv_size * vec2(0, -1))).rgb;
-    vec3 c_down = texture(albedo_texture, varyings.uv + (inv_size * vec2(0, 1))).rgb;
-    vec3 c_left = texture(albedo_texture, varyings.uv + (inv_size * vec2(-1, 0))).rgb;
-    vec3 c_right = texture(albedo_texture, varyings.uv + (inv_size * vec2(1, 0))).rgb;
-    vec3 c_center = texture(albedo_texture, varyings.uv).rgb;
+    vec3 c_up = texture(MATERIAL_SAMPLER(albedo_texture), uv + (inv_size * vec2(0, -1))).rgb;
+    vec3 c_down = texture(MATERIAL_SAMPLER(albedo_texture), uv + (inv_size * vec2(0, 1))).rgb;
+    vec3 c_left = texture(MATERIAL_SAMPLER(albedo_texture), uv + (inv_size * vec2(-1, 0))).rgb;
+    vec3 c_right = texture(MATERIAL_SAMPLER(albedo_texture), uv + (inv_size * vec2(1, 0))).rgb;
+    vec3 c_center = texture(MATERIAL_SAMPLER(albedo_texture), uv).rgb;
     vec3 c_sharp = (5.0f * c_center) - ((c_up + c_down + c_left + c_right));
 
     float blend = floor((varyings.uv.x * 4.0f) + (varyings.uv.y * 0.5f) - 0.5f);
     if (blend < 1.0f)
-        frag_colour = vec4(texture(albedo_texture, varyings.uv).rgb, 1.0f);
+        frag_colour = vec4(texture(MATERIAL_SAMPLER(albedo_texture), uv).rgb, 1.0f);
     else if (blend < 2.0f)
-        frag_colour = vec4(vec3(pow(texture(depth_texture, varyings.uv).r, 3.0f)), 1.0f);
+        frag_colour = vec4(vec3(pow(texture(MATERIAL_SAMPLER(depth_texture), uv).r, 3.0f)), 1.0f);
     else if (blend < 3.0f)
-        frag_colour = vec4(texture(normal_texture, varyings.uv).rgb, 1.0f);
+        frag_colour = vec4(texture(MATERIAL_SAMPLER(normal_texture), uv).rgb, 1.0f);
     else
-        frag_colour = vec4(texture(extra_texture, varyings.uv).rgb, 1.0f);
+        frag_colour = vec4(texture(MATERIAL_SAMPLER(extra_texture), uv).rgb, 1.0f);
 }
\ No newline at end of file
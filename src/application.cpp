@@ -4,43 +4,68 @@
 
 #include "input.h"
 #include "debug.h"
+#include "profiler.h"
 #include "render_server.h"
 #include "scene.h"
 #include "text_node.h"
+#include "gpu_profiler.h"
+#include "frame_capture.h"
 
 using namespace std;
 
 static PTApplication* application = nullptr;
 
-PTApplication::PTApplication(unsigned int _width, unsigned int _height)
+PTApplication::PTApplication(unsigned int _width, unsigned int _height, string _start_scene_path, PTHeadlessSettings _headless)
 {
     width = _width;
     height = _height;
+    start_scene_path = _start_scene_path;
+    headless = _headless;
 }
 
 void PTApplication::start()
 {
     application = this;
+    profileSetThreadName("main");
     program_start = chrono::high_resolution_clock::now();
 
-    initWindow();
-    PTInput::init(window);
-
-	uint32_t glfw_extension_count = 0;
-    const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    // headless leaves glfw alone entirely, the render server draws offscreen and input reads as idle
+    vector<const char*> extensions;
+    if (!headless.enabled)
+    {
+        initWindow();
 
-    vector<const char*> extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
+        uint32_t glfw_extension_count = 0;
+        const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+        extensions = vector<const char*>(glfw_extensions, glfw_extensions + glfw_extension_count);
+    }
+    PTInput::init(window);
 	PTRenderServer::init(window, extensions);
 
-    current_scene = PTResourceManager::get()->createScene("res/demo.ptscn");
+    // build shaders, materials and pipelines up front so the first frames don't hitch
+    uint64_t load_start = profileNow();
+    PTResourceManager::get()->warmUpScene(start_scene_path);
+    current_scene = PTResourceManager::get()->createScene(start_scene_path);
+    PTResourceManager::get()->releaseWarmUp();
+    applySceneRenderGraph();
+    load_ms = (profileNow() - load_start) / 1000000.0f;
+
+    if (headless.enabled && !headless.record_prefix.empty())
+        PTRenderServer::get()->getFrameCapture()->beginSequence(headless.record_prefix);
 
     mainLoop();
 
+#ifdef PT_PROFILING_ENABLED
+    // whatever's left in the buffers at exit is always worth having
+    profileDumpTrace("trace.json");
+#endif
+
     current_scene->removeReferencer();
 
 	PTRenderServer::deinit();
 	PTInput::deinit();
-    deinitWindow();
+    if (!headless.enabled)
+        deinitWindow();
 
     if (!should_stop)
         debugDeinit();
@@ -69,13 +94,29 @@ void PTApplication::initWindow()
 void PTApplication::mainLoop()
 {
     int frame_total_number = 0;
+    if (headless.enabled)
+        frame_stats.reserve(headless.frame_count);
     last_frame_start = chrono::high_resolution_clock::now();
-    while (!glfwWindowShouldClose(window) && !should_stop)
+    while (!should_stop)
     {
-        glfwPollEvents();
+        PT_PROFILE_ZONE("frame");
+        uint64_t frame_start = profileNow();
+        if (headless.enabled)
+        {
+            if (frame_total_number >= static_cast<int>(headless.frame_count))
+                break;
+        }
+        else
+        {
+            if (glfwWindowShouldClose(window))
+                break;
+            glfwPollEvents();
+        }
 
         auto now = chrono::high_resolution_clock::now();
         chrono::duration<float> frame_time = now - last_frame_start;
+        // the scene only sees the fixed step when headless, so it plays out the same no matter how slow the device is
+        float delta_time = headless.enabled ? headless.timestep : frame_time.count();
 
         frame_time_running_mean_us = static_cast<uint32_t>((frame_time_running_mean_us * 0.8f) + (chrono::duration_cast<chrono::microseconds>(frame_time).count() * 0.2f));
 
@@ -89,6 +130,7 @@ void PTApplication::mainLoop()
             {
                 current_scene->removeReferencer();
                 current_scene = nullptr;
+                applySceneRenderGraph();
             }
         }
         else if (PTInput::get()->isKeyDown('L'))
@@ -96,27 +138,86 @@ void PTApplication::mainLoop()
             debugLog("loading scene!");
             if (current_scene == nullptr)
             {
-                current_scene = PTResourceManager::get()->createScene("res/demo.ptscn");
+                current_scene = PTResourceManager::get()->createScene(start_scene_path);
+                applySceneRenderGraph();
             }
         }
 
+        // G toggles logging the gpu profile to a csv file, B toggles timing material batches in it
+        if (PTInput::get()->wasKeyPressed('G'))
+        {
+            PTGPUProfiler* profiler = PTRenderServer::get()->getGPUProfiler();
+            if (profiler->isLogging())
+            {
+                profiler->stopLog();
+                debugLog("stopped gpu profile log");
+            }
+            else
+                profiler->startLog("gpu_profile.csv");
+        }
+        if (PTInput::get()->wasKeyPressed('B'))
+            PTRenderServer::get()->setProfileMaterialBatches(!PTRenderServer::get()->getProfileMaterialBatches());
+#ifdef PT_PROFILING_ENABLED
+        // T dumps the cpu profile so far
+        if (PTInput::get()->wasKeyPressed('T'))
+            profileDumpTrace("trace.json");
+#endif
+        // V starts and stops recording every frame to disk
+        if (PTInput::get()->wasKeyPressed('V'))
+        {
+            PTFrameCapture* capture = PTRenderServer::get()->getFrameCapture();
+            if (capture->isRecordingSequence())
+                capture->endSequence();
+            else
+                capture->beginSequence("capture_");
+        }
+
         if (wants_new_scene)
         {
             wants_new_scene = false;
             debugLog("loading new scene: " + new_scene_path);
             current_scene->removeReferencer();
+            PTResourceManager::get()->warmUpScene(new_scene_path);
             current_scene = PTResourceManager::get()->createScene(new_scene_path);
+            PTResourceManager::get()->releaseWarmUp();
+            applySceneRenderGraph();
         }
 
+        uint64_t update_start = profileNow();
         if (current_scene != nullptr)
-            current_scene->update(frame_time.count());
+            current_scene->update(delta_time);
+        float update_ms = (profileNow() - update_start) / 1000000.0f;
+
+        // the screenshot is taken once the frame is drawn, so asking now captures the last one
+        if (headless.enabled && !headless.capture_path.empty() && frame_total_number == static_cast<int>(headless.frame_count) - 1)
+            PTRenderServer::get()->setWantsScreenshot(headless.capture_path);
 
         PTRenderServer::get()->update();
 
+        if (headless.enabled)
+        {
+            headless_time += headless.timestep;
+            PTRenderServer* render_server = PTRenderServer::get();
+            frame_stats.push_back(PTFrameStats
+            {
+                update_ms,
+                render_server->getLastRecordTime(),
+                render_server->getLastSubmitTime(),
+                render_server->getGPUProfiler()->getFrameTime(),
+                (profileNow() - frame_start) / 1000000.0f
+            });
+        }
         frame_total_number++;
     }
 }
 
+void PTApplication::applySceneRenderGraph()
+{
+    // scenes can ask for their own render graph, otherwise the default one is used
+    string graph_path = (current_scene != nullptr) ? current_scene->getRenderGraphPath() : "";
+    PTRenderServer::get()->setRenderGraph(graph_path.empty() ? DEFAULT_RENDER_GRAPH_PATH : graph_path);
+}
+
 void PTApplication::deinitWindow()
 {
     glfwDestroyWindow(window);
@@ -138,6 +239,8 @@ float PTApplication::getAspectRatio() const
 
 PTVector2u PTApplication::getFramebufferSize()
 {
+    if (headless.enabled)
+        return PTVector2u{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 	glfwGetFramebufferSize(window, &width, &height);
 	return PTVector2u{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 }
@@ -162,6 +265,8 @@ PTVector3f PTApplication::getCameraPosition() const
 
 float PTApplication::getTotalTime()
 {
+    if (headless.enabled)
+        return headless_time;
 	chrono::duration<float> since = chrono::high_resolution_clock::now() - program_start;
 	return since.count();
 }
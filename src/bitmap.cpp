@@ -1,10 +1,17 @@
 #include "bitmap.h"
+#include "image_decoder.h"
+#include "swizzle.h"
 
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
-bool writeRGBABitmap(string path, char* data, int32_t width, int32_t height)
+// pixels are swizzled into this much memory at a time on their way to the file
+static const size_t WRITE_CHUNK_PIXELS = 16384;
+
+static bool writeBitmap(string path, const char* data, int32_t width, int32_t height, bool swizzle)
 {
     // if the image params are nonsense, don't do anything
     if (width <= 0 || height <= 0 || data == nullptr)
@@ -32,112 +39,58 @@ bool writeRGBABitmap(string path, char* data, int32_t width, int32_t height)
     file.write((char*)&header, sizeof(PTBitmapHeader));
     file.write((char*)&info_header, sizeof(PTBitmapInfoHeader));
 
-    // reorganise data RGBA -> BGRA
-    char* other_buf = new char[width * height * 4];
-    size_t length = width * height;
-    for (size_t i = 0; i < length; i++)
+    size_t length = static_cast<size_t>(width) * height;
+    if (!swizzle)
+        file.write(data, length * 4);
+    else
     {
-        other_buf[(i * 4) + 0] = data[(i * 4) + 2];
-        other_buf[(i * 4) + 1] = data[(i * 4) + 1];
-        other_buf[(i * 4) + 2] = data[(i * 4) + 0];
-        other_buf[(i * 4) + 3] = data[(i * 4) + 3];
+        // reorganise data RGBA -> BGRA a chunk at a time, rather than making a whole second copy of the image
+        vector<uint8_t> chunk(min(length, WRITE_CHUNK_PIXELS) * 4);
+        for (size_t i = 0; i < length; i += WRITE_CHUNK_PIXELS)
+        {
+            size_t count = min(length - i, WRITE_CHUNK_PIXELS);
+            swizzleRGBAToBGRA(reinterpret_cast<const uint8_t*>(data) + (i * 4), chunk.data(), count);
+            file.write((char*)chunk.data(), count * 4);
+        }
     }
 
-    file.write((char*)other_buf, info_header.data_length);
-    delete[] other_buf;
-
     file.close();
 
-    return true;
+    return !file.fail();
 }
 
-bool readRGBABitmap(string path, char*& data, int32_t& width, int32_t& height)
+bool writeRGBABitmap(string path, const char* data, int32_t width, int32_t height)
 {
-    // if we can't open the file, don't do anything
-    ifstream file(path, ios::binary | ios::ate);
-    if (!file.is_open())
-        return false;
-
-    // grab the file size
-    size_t size = file.tellg();
-    file.seekg(0);
-
-    if (size < sizeof(PTBitmapHeader) + sizeof(PTBitmapInfoHeader))
-    {
-        file.close();
-        return false;
-    }
-
-    // grab the bitmap header
-    PTBitmapHeader header;
-    file.read((char*)(&header), sizeof(PTBitmapHeader));
-
-    // check the validity of the header
-    PTBitmapHeader sample;
-    if (header.sig_0 != sample.sig_0 || header.sig_1 != sample.sig_1)
-    {
-        file.close();
-        return false;
-    }
-
-    if (size < header.size_bytes || header.data_offset < (sizeof(PTBitmapHeader) + sizeof(PTBitmapInfoHeader)))
-    {
-        file.close();
-        return false;
-    }
-
-    // grab the bitmap info header
-    PTBitmapInfoHeader info_header;
-    file.read((char*)(&info_header), sizeof(PTBitmapInfoHeader));
+    return writeBitmap(path, data, width, height, true);
+}
 
-    // check the validity of the info header
-    PTBitmapInfoHeader info_sample;
-    if (info_header.header_size != info_sample.header_size)
-    {
-        file.close();
-        return false;
-    }
+bool writeBGRABitmap(string path, const char* data, int32_t width, int32_t height)
+{
+    return writeBitmap(path, data, width, height, false);
+}
 
-    if (size < info_header.data_length + header.data_offset)
+bool readRGBABitmap(string path, char*& data, int32_t& width, int32_t& height)
+{
+    // the image decoder handles every variant of bitmap (and other formats), this just gives the old interface
+    char* buffer = nullptr;
+    PTImageSink sink;
+    sink.begin = [&](const PTImageInfo& info)
     {
-        file.close();
-        return false;
-    }
+        if (info.format != PTImagePixelFormat::PIXEL_RGBA8)
+            return false;
+        width = static_cast<int32_t>(info.width);
+        height = static_cast<int32_t>(info.height);
+        buffer = new char[static_cast<size_t>(info.width) * info.height * 4];
+        return true;
+    };
+    sink.row = [&](uint32_t y) { return reinterpret_cast<uint8_t*>(buffer) + (static_cast<size_t>(y) * width * 4); };
 
-    if (info_header.compresion != 0)
+    if (!decodeImage(path, sink))
     {
-        file.close();
+        delete[] buffer;
         return false;
     }
 
-    char* buffer = new char[info_header.data_length];
-    file.read(buffer, info_header.data_length);
-
-    file.close();
-
-    width = info_header.bitmap_width;
-    height = info_header.bitmap_height;
-    if (info_header.bits_per_pixel == 32)
-    {
-        data = buffer;
-        return true;
-    }
-    else if (info_header.bits_per_pixel == 24)
-    {
-        char* other_buf = new char[width * height * 4];
-        size_t length = width * height;
-        for (size_t i = 0; i < length; i++)
-        {
-            other_buf[(i * 4) + 0] = buffer[(i * 3) + 2];
-            other_buf[(i * 4) + 1] = buffer[(i * 3) + 1];
-            other_buf[(i * 4) + 2] = buffer[(i * 3) + 0];
-            other_buf[(i * 4) + 3] = 255;
-        }
-
-        data = other_buf;
-        delete[] buffer;
-
-        return true;
-    }
-    else return false;
-}
+    data = buffer;
+    return true;
+}
\ No newline at end of file
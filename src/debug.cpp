@@ -7,9 +7,12 @@
 #include <format>
 #include <chrono>
 #include <fstream>
+#include <mutex>
+#include <iostream>
 
 #include "debug_ui.h"
 #include "application.h"
+#include "profiler.h"
 
 using namespace stui;
 using namespace std;
@@ -94,6 +97,12 @@ private:
     Label* frame_label = nullptr;
     PropertyView* scene_props_box = nullptr;
     PropertyView* object_props_box = nullptr;
+    PropertyView* gpu_profile_box = nullptr;
+    // the profile is replaced wholesale every frame, so it's handed over here and swapped in by the render thread
+    // rather than edited while it's being drawn
+    vector<pair<string, string>> pending_gpu_profile;
+    bool has_pending_gpu_profile = false;
+    mutex gpu_profile_mutex;
 
     bool should_halt = false;
     thread render_thread;
@@ -112,9 +121,11 @@ public:
         main_page->get<BorderedBox>("scene_box")->child = scene_props_box;
         object_props_box = new PropertyView();
         main_page->get<BorderedBox>("object_box")->child = object_props_box;
+        gpu_profile_box = new PropertyView();
+        main_page->get<BorderedBox>("gpu_box")->child = gpu_profile_box;
         main_page->ensureIntegrity();
 
-        main_page->focusable_component_sequence = { console, scene_props_box, object_props_box };
+        main_page->focusable_component_sequence = { console, scene_props_box, object_props_box, gpu_profile_box };
 
         main_page->shortcuts.push_back(Input::Shortcut{ Input::Key{ 'q', Input::ControlKeys::NONE }, quitShortcutPressed });
 
@@ -127,6 +138,7 @@ public:
 
     void appendToLog(string s);
     void setFrametime(float delta, int number);
+    void setGPUProfile(const vector<pair<string, string>>& rows);
     void showExitButton();
     static void exitButtonCallback();
     static void quitShortcutPressed();
@@ -160,9 +172,22 @@ private:
 };
 
 static PTDebugManager* mgr = nullptr;
+// logging can happen from worker threads (e.g. during warm-up)
+static mutex log_mutex;
+// used instead of the manager when not interactive, everything other than logging is dropped
+static bool plain_output = false;
+static ofstream plain_log;
 
-void debugInit()
+void debugInit(bool interactive)
 {
+    if (!interactive)
+    {
+        plain_output = true;
+        if (!plain_log.is_open())
+            plain_log.open("planetarium.log");
+        return;
+    }
+
     if (mgr == nullptr)
         mgr = new PTDebugManager();
     else
@@ -174,6 +199,12 @@ void debugInit()
 
 void debugDeinit()
 {
+    if (plain_output)
+    {
+        plain_output = false;
+        plain_log.close();
+    }
+
     if (mgr != nullptr)
     {
         mgr->showExitButton();
@@ -184,13 +215,21 @@ void debugDeinit()
 
 void debugLog(string text)
 {
-    if (mgr == nullptr) return;
+    if (mgr == nullptr && !plain_output) return;
     auto now = chrono::system_clock::now().time_since_epoch();
 	auto hours = chrono::duration_cast<chrono::hours>(now);
 	auto minutes = chrono::duration_cast<chrono::minutes>(now - hours);
 	auto seconds = chrono::duration_cast<chrono::seconds>(now - hours - minutes);
 	auto millis = chrono::duration_cast<chrono::milliseconds>(now - hours - minutes - seconds);
     string str = format("[{:2}:{:2}:{:2}.{:3}]: {}", (int)(hours.count() % 24), (int)minutes.count(), (int)seconds.count(), (int)millis.count(), text);
+    lock_guard<mutex> lock(log_mutex);
+    if (plain_output)
+    {
+        cout << str << endl;
+        if (plain_log.is_open())
+            plain_log << str << '\n';
+        return;
+    }
     mgr->appendToLog(str);
 }
 
@@ -224,6 +263,12 @@ void debugClearObjectProperty(std::string name)
     mgr->clearObjectProp(name);
 }
 
+void debugSetGPUProfile(const std::vector<std::pair<std::string, std::string>>& rows)
+{
+    if (mgr == nullptr) return;
+    mgr->setGPUProfile(rows);
+}
+
 std::string debugRenderToBuffer(uint32_t width, uint32_t height)
 {
     Tixel* buf = nullptr;
@@ -256,22 +301,43 @@ void PTDebugManager::setFrametime(float delta, int number)
     frame_label->text = format("{:.2f}fps | {:.2f}ms ({})", 1000.0f / delta, delta, number);
 }
 
+void PTDebugManager::setGPUProfile(const vector<pair<string, string>>& rows)
+{
+    lock_guard<mutex> lock(gpu_profile_mutex);
+    pending_gpu_profile = rows;
+    has_pending_gpu_profile = true;
+}
+
 void PTDebugManager::showExitButton()
 {
     VerticalBox* vb = (VerticalBox*)((main_page->getRoot()->getAllChildren())[0]->getAllChildren()[0]);
-    //Label* l = (Label*)(vb->children[3]);
-    vb->children[3] = new Button("press enter to exit", exitButtonCallback);
-    main_page->focusable_component_sequence.push_back(vb->children[3]);
+    //Label* l = (Label*)(vb->children[4]);
+    vb->children[4] = new Button("press enter to exit", exitButtonCallback);
+    main_page->focusable_component_sequence.push_back(vb->children[4]);
     main_page->setFocusIndex(main_page->focusable_component_sequence.size() - 1);
     main_page->ensureIntegrity();
 }
 
 void PTDebugManager::renderLoop()
 {
+    profileSetThreadName("debug ui");
     while (!should_halt)
     {
+        PT_PROFILE_ZONE("PTDebugManager::render");
         main_page->checkInput();
 
+        {
+            // property views are sorted by name, so rows are numbered to keep them in the order they came in
+            lock_guard<mutex> lock(gpu_profile_mutex);
+            if (has_pending_gpu_profile)
+            {
+                gpu_profile_box->elements.clear();
+                for (size_t i = 0; i < pending_gpu_profile.size(); i++)
+                    gpu_profile_box->elements[format("{:02} {}", i, pending_gpu_profile[i].first)] = pending_gpu_profile[i].second;
+                has_pending_gpu_profile = false;
+            }
+        }
+
         main_page->render();
 
         main_page->framerate(24);
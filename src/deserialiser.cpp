@@ -1,9 +1,14 @@
 #include "deserialiser.h"
 
+#include <algorithm>
+
 #include "debug.h"
 #include "resource_manager.h"
 #include "image.h"
 #include "scene.h"
+#include "material.h"
+#include "render_graph.h"
+#include "compute_pipeline.h"
 
 using namespace std;
 
@@ -431,6 +436,18 @@ void PTDeserialiser::deserialiseScene(PTScene* scene, const std::string& content
                 res.second->removeReferencer();
             }
         }
+        else if (tokens[statement_first].s_value == "RenderGraph")
+        {
+            // the render graph to draw this scene with, instead of the default one
+            auto args = deserialiseStatement(tokens, ++statement_first, true, false, res_map, content);
+            for (auto arg : args)
+            {
+                if (arg.second.type == ArgType::STRING_ARG)
+                    scene->setRenderGraphPath(arg.second.s_val);
+            }
+            if (statement_first >= tokens.size() || tokens[statement_first].type != TokenType::SEMICOLON)
+                reportError("expected semicolon", tokens[statement_first - 1].start_offset, content);
+        }
         else
         {
             deserialiseObject(tokens, statement_first, scene, res_map, content);
@@ -693,6 +710,191 @@ void PTDeserialiser::deserialiseMaterial(const std::string& content, MaterialPar
     }
 }
 
+void PTDeserialiser::deserialiseRenderGraph(const std::string& content, std::vector<PTRGStep>& steps, int& final_image, PTResolutionSettings& resolution, std::vector<PTResource*>& resources)
+{
+    vector<Token> tokens = prune(tokenise(content));
+    
+    if (tokens.size() == 0) return;
+
+    if (tokens.size() < 4)
+        reportError("not enough tokens provided", 0, content);
+
+    if (tokens[0].type != TokenType::TEXT)
+        reportError("invalid first token", tokens[0].start_offset, content);
+
+    auto expectSemicolon = [&tokens, &content](size_t index)
+    {
+        if (index >= tokens.size())
+            reportError("expected semicolon", tokens[tokens.size() - 1].start_offset, content);
+        else if (tokens[index].type != TokenType::SEMICOLON)
+            reportError("expected semicolon", tokens[index].start_offset, content);
+    };
+
+    // arguments shared by both kinds of step. outputs which aren't mentioned go to the spare images, so they're never kept
+    auto applyStepArgument = [](PTRGStep& step, const pair<string, Argument>& arg)
+    {
+        if (arg.first == "colour" && arg.second.type == ArgType::INT_ARG)
+            step.colour_buffer_binding = arg.second.i_val;
+        else if (arg.first == "depth" && arg.second.type == ArgType::INT_ARG)
+            step.depth_buffer_binding = arg.second.i_val;
+        else if (arg.first == "normal" && arg.second.type == ArgType::INT_ARG)
+            step.normal_buffer_binding = arg.second.i_val;
+        else if (arg.first == "extra" && arg.second.type == ArgType::INT_ARG)
+            step.extra_buffer_binding = arg.second.i_val;
+        else if (arg.first == "clear_colour" && arg.second.type == ArgType::VECTOR4_ARG)
+            step.colour_clear_value = arg.second.v4_val;
+        else if (arg.first == "clear_normal" && arg.second.type == ArgType::VECTOR4_ARG)
+            step.normal_clear_value = arg.second.v4_val;
+        else if (arg.first == "clear_extra" && arg.second.type == ArgType::VECTOR4_ARG)
+            step.extra_clear_value = arg.second.v4_val;
+        else if (arg.first == "clear_depth" && arg.second.type == ArgType::FLOAT_ARG)
+            step.depth_clear_value = arg.second.f_val;
+        else if (arg.first == "clear_depth" && arg.second.type == ArgType::INT_ARG)
+            step.depth_clear_value = (float)arg.second.i_val;
+        else if (arg.first == "size" && arg.second.type == ArgType::VECTOR2_ARG)
+            step.custom_extent = VkExtent2D{ (uint32_t)arg.second.v2_val.x, (uint32_t)arg.second.v2_val.y };
+    };
+
+    ResourceMap res_map;
+    size_t statement_first = 0;
+    while (statement_first < tokens.size() - 1)
+    {
+        if (tokens[statement_first].type != TokenType::TEXT)
+            reportError("invalid token", tokens[statement_first].start_offset, content);
+        
+        if (tokens[statement_first].s_value == "Resource")
+        {
+            size_t tmp_first = statement_first;
+            auto res = deserialiseResourceDescriptor(tokens, statement_first, res_map, content);
+            if (res.second == nullptr)
+                reportError("resource '" + res.first + "' could not be loaded", tokens[tmp_first].start_offset, content);
+            res_map[res.first] = res.second;
+            resources.push_back(res.second);
+        }
+        else if (tokens[statement_first].s_value == "Final")
+        {
+            auto args = deserialiseStatement(tokens, ++statement_first, false, true, res_map, content);
+            for (auto arg : args)
+            {
+                if (arg.first == "buffer" && arg.second.type == ArgType::INT_ARG)
+                    final_image = arg.second.i_val;
+            }
+            expectSemicolon(statement_first);
+        }
+        else if (tokens[statement_first].s_value == "DynamicResolution")
+        {
+            resolution.enabled = true;
+            auto args = deserialiseStatement(tokens, ++statement_first, false, true, res_map, content);
+            for (auto arg : args)
+            {
+                float value;
+                if (arg.second.type == ArgType::FLOAT_ARG)
+                    value = arg.second.f_val;
+                else if (arg.second.type == ArgType::INT_ARG)
+                    value = (float)arg.second.i_val;
+                else
+                    continue;
+
+                if (arg.first == "target_ms")
+                    resolution.target_ms = value;
+                else if (arg.first == "min_scale")
+                    resolution.min_scale = value;
+                else if (arg.first == "max_scale")
+                    resolution.max_scale = value;
+            }
+            // keep the bounds sane, a zero scale would mean zero-sized render areas
+            resolution.max_scale = clamp(resolution.max_scale, 0.05f, 1.0f);
+            resolution.min_scale = clamp(resolution.min_scale, 0.05f, resolution.max_scale);
+            if (resolution.target_ms <= 0.0f)
+                reportError("dynamic resolution target must be positive", tokens[statement_first].start_offset, content);
+            expectSemicolon(statement_first);
+        }
+        else if (tokens[statement_first].s_value == "CameraStep")
+        {
+            PTRGStep step{ };
+            step.is_camera_step = true;
+            step.colour_buffer_binding = -1;
+            auto args = deserialiseStatement(tokens, ++statement_first, false, true, res_map, content);
+            for (auto arg : args)
+            {
+                if (arg.first == "camera" && arg.second.type == ArgType::INT_ARG)
+                    step.camera_slot = arg.second.i_val;
+                else
+                    applyStepArgument(step, arg);
+            }
+            expectSemicolon(statement_first);
+            steps.push_back(step);
+        }
+        else if (tokens[statement_first].s_value == "ProcessStep" || tokens[statement_first].s_value == "ComputeStep")
+        {
+            size_t step_first = statement_first;
+            bool is_compute = tokens[statement_first].s_value == "ComputeStep";
+            PTRGStep step{ };
+            step.is_camera_step = false;
+            step.is_compute_step = is_compute;
+            step.colour_buffer_binding = -1;
+            auto args = deserialiseStatement(tokens, ++statement_first, false, true, res_map, content);
+            for (auto arg : args)
+            {
+                if (!is_compute && arg.first == "material" && arg.second.type == ArgType::RESOURCE_ARG)
+                    step.process_material = dynamic_cast<PTMaterial*>(arg.second.r_val);
+                else if (is_compute && arg.first == "shader" && arg.second.type == ArgType::RESOURCE_ARG)
+                    step.compute_pipeline = dynamic_cast<PTComputePipeline*>(arg.second.r_val);
+                else
+                    applyStepArgument(step, arg);
+            }
+            if (!is_compute && step.process_material == nullptr)
+                reportError("process step requires a material resource", tokens[step_first].start_offset, content);
+            if (is_compute && step.compute_pipeline == nullptr)
+                reportError("compute step requires a compute shader resource", tokens[step_first].start_offset, content);
+
+            // inputs go in a block after the step, each one binding an image buffer to one of the material's texture slots.
+            // compute steps list their outputs in there too, since they write to storage images rather than attachments
+            if (statement_first < tokens.size() && tokens[statement_first].type == TokenType::OPEN_CURLY)
+            {
+                size_t close_brace = findClosingBracket(tokens, statement_first, true, content);
+                statement_first++;
+                while (statement_first < close_brace)
+                {
+                    bool is_input = tokens[statement_first].type == TokenType::TEXT && tokens[statement_first].s_value == "Input";
+                    bool is_output = is_compute && tokens[statement_first].type == TokenType::TEXT && tokens[statement_first].s_value == "Output";
+                    if (!is_input && !is_output)
+                        reportError(is_compute ? "expected input or output statement" : "expected input statement", tokens[statement_first].start_offset, content);
+
+                    size_t input_first = statement_first;
+                    int buffer = -1;
+                    int binding = -1;
+                    auto input_args = deserialiseStatement(tokens, ++statement_first, false, true, res_map, content);
+                    for (auto arg : input_args)
+                    {
+                        if (arg.first == "buffer" && arg.second.type == ArgType::INT_ARG)
+                            buffer = arg.second.i_val;
+                        else if (arg.first == "binding" && arg.second.type == ArgType::INT_ARG)
+                            binding = arg.second.i_val;
+                    }
+                    if (buffer < 0 || binding < 0)
+                        reportError(string(is_input ? "input" : "output") + " requires a buffer and a binding", tokens[input_first].start_offset, content);
+                    if (is_input)
+                        step.process_inputs.push_back({ buffer, (uint16_t)binding });
+                    else
+                        step.compute_outputs.push_back({ buffer, (uint16_t)binding });
+
+                    expectSemicolon(statement_first);
+                    statement_first++;
+                }
+                statement_first = close_brace + 1;
+            }
+            expectSemicolon(statement_first);
+            steps.push_back(step);
+        }
+        else
+        {
+            reportError("invalid statement", tokens[statement_first].start_offset, content);
+        }
+        statement_first++;
+    }
+}
+
 inline PTDeserialiser::TokenType PTDeserialiser::getType(const char c)
 {
     if (isAlphabetic(c) || c == '_') return TokenType::TEXT;
@@ -738,6 +940,28 @@ inline bool PTDeserialiser::isSeparator(TokenType t)
     }
 }
 
+vector<pair<string, string>> PTDeserialiser::findResourceDescriptors(const string& content)
+{
+    // lists the (type, path) of every Resource statement without actually loading anything
+    vector<Token> tokens = prune(tokenise(content));
+    vector<pair<string, string>> descriptors;
+
+    for (size_t i = 0; i + 4 < tokens.size(); i++)
+    {
+        if (tokens[i].type != TokenType::TEXT || tokens[i].s_value != "Resource")
+            continue;
+        if (tokens[i + 1].type != TokenType::OPEN_ROUND
+         || tokens[i + 2].type != TokenType::TEXT
+         || tokens[i + 3].type != TokenType::COMMA
+         || tokens[i + 4].type != TokenType::STRING)
+            continue;
+
+        descriptors.push_back({ tokens[i + 2].s_value, tokens[i + 4].s_value });
+    }
+
+    return descriptors;
+}
+
 void PTDeserialiser::reportError(const string err, size_t off, const string& str)
 {
     int32_t extract_start = max(0, (int32_t)off - 16);
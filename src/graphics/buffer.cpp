@@ -89,6 +89,17 @@ uint32_t PTBuffer::findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags prop
     throw runtime_error("unable to find suitable memory type");
 }
 
+bool PTBuffer::hasMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties, PTPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device.getDevice(), &memory_properties);
+
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+        if ((type_bits & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) return true;
+
+    return false;
+}
+
 PTBuffer::~PTBuffer()
 {
     // make sure we're unmapped
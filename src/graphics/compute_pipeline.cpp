@@ -0,0 +1,147 @@
+#include "compute_pipeline.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#include "constant.h"
+#include "debug.h"
+#include "shader.h"
+#include "spirv_reflect.h"
+#include "resource_manager.h"
+#include "descriptor_allocator.h"
+
+using namespace std;
+
+PTComputePipeline::PTComputePipeline(VkDevice _device, VkPipelineCache _pipeline_cache, string shader_path_stub)
+{
+    device = _device;
+    pipeline_cache = _pipeline_cache;
+    origin_path = shader_path_stub;
+
+    // there's no sensible default to fall back on here (unlike PTShader), so failing to compile is fatal
+    vector<char> code;
+    if (!PTShader::compileStage(shader_path_stub + ".comp", "comp", code))
+        throw runtime_error("failed to compile compute shader " + shader_path_stub);
+
+    reflectDescriptors(code);
+    createLayouts();
+
+    VkShaderModuleCreateInfo module_create_info{ };
+    module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    module_create_info.codeSize = code.size();
+    module_create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    if (vkCreateShaderModule(device, &module_create_info, nullptr, &shader_module) != VK_SUCCESS)
+        throw runtime_error("unable to create compute shader module");
+
+    VkComputePipelineCreateInfo pipeline_create_info{ };
+    pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_create_info.stage.module = shader_module;
+    pipeline_create_info.stage.pName = "main";
+    pipeline_create_info.layout = layout;
+
+    if (vkCreateComputePipelines(device, pipeline_cache, 1, &pipeline_create_info, nullptr, &pipeline) != VK_SUCCESS)
+        throw runtime_error("unable to create compute pipeline");
+
+    debugLog("compute pipeline " + origin_path + " created with " + to_string(descriptor_bindings.size()) + " bindings, workgroup size " + to_string(workgroup_size[0]) + "x" + to_string(workgroup_size[1]) + "x" + to_string(workgroup_size[2]));
+}
+
+PTComputePipeline::~PTComputePipeline()
+{
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyPipelineLayout(device, layout, nullptr);
+    if (PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator())
+        allocator->forgetLayout(descriptor_set_layout);
+    vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+    vkDestroyShaderModule(device, shader_module, nullptr);
+}
+
+bool PTComputePipeline::hasDescriptorWithBinding(uint16_t binding, VkDescriptorType type) const
+{
+    for (const BindingInfo& descriptor : descriptor_bindings)
+    {
+        if (descriptor.bind_point == binding)
+            return descriptor.type == type;
+    }
+    return false;
+}
+
+void PTComputePipeline::reflectDescriptors(const vector<char>& code)
+{
+    SpvReflectShaderModule reflect;
+    spvReflectCreateShaderModule(code.size(), code.data(), &reflect);
+    for (size_t i = 0; i < reflect.descriptor_binding_count; i++)
+    {
+        SpvReflectDescriptorBinding binding = reflect.descriptor_bindings[i];
+
+        // same rules as PTShader: the scene and texture sets are shared, set 2 is ours
+        if (binding.set != MATERIAL_DESCRIPTOR_SET)
+        {
+            bool is_scene = (binding.set == SCENE_DESCRIPTOR_SET && binding.binding == SCENE_UNIFORM_BINDING);
+            bool is_texture_array = (binding.set == TEXTURE_DESCRIPTOR_SET && binding.binding == 0 && PTResourceManager::get()->usesBindlessTextures());
+            if (!is_scene && !is_texture_array)
+                debugLog("ERROR: compute shader '" + origin_path + "' has a descriptor in set " + to_string(binding.set) + ", binding " + to_string(binding.binding) + ", which is reserved by the engine. it will be ignored");
+            continue;
+        }
+
+        // inputs are sampled, outputs are storage images. nothing else has a source in the render graph
+        BindingInfo descriptor{ static_cast<uint16_t>(binding.binding) };
+        if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            descriptor.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        else if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+            descriptor.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        else
+        {
+            debugLog("ERROR: compute shader '" + origin_path + "' contains unsupported descriptor of type " + to_string(binding.descriptor_type));
+            continue;
+        }
+        descriptor_bindings.push_back(descriptor);
+    }
+
+    if (reflect.entry_point_count > 0)
+    {
+        workgroup_size[0] = max(reflect.entry_points[0].local_size.x, 1u);
+        workgroup_size[1] = max(reflect.entry_points[0].local_size.y, 1u);
+        workgroup_size[2] = max(reflect.entry_points[0].local_size.z, 1u);
+    }
+    spvReflectDestroyShaderModule(&reflect);
+}
+
+void PTComputePipeline::createLayouts()
+{
+    vector<VkDescriptorSetLayoutBinding> bindings = { };
+    for (const BindingInfo& descriptor : descriptor_bindings)
+    {
+        VkDescriptorSetLayoutBinding binding{ };
+        binding.binding = descriptor.bind_point;
+        binding.descriptorType = descriptor.type;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        bindings.push_back(binding);
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{ };
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    layout_create_info.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &descriptor_set_layout) != VK_SUCCESS)
+        throw runtime_error("unable to create compute descriptor set layout");
+
+    // no push constants, since there's no object to transform
+    array<VkDescriptorSetLayout, DESCRIPTOR_SET_COUNT> set_layouts;
+    set_layouts[SCENE_DESCRIPTOR_SET] = PTResourceManager::get()->getSceneSetLayout();
+    set_layouts[TEXTURE_DESCRIPTOR_SET] = PTResourceManager::get()->getTextureSetLayout();
+    set_layouts[MATERIAL_DESCRIPTOR_SET] = descriptor_set_layout;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{ };
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+    pipeline_layout_create_info.pSetLayouts = set_layouts.data();
+
+    if (vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &layout) != VK_SUCCESS)
+        throw runtime_error("unable to create compute pipeline layout");
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "descriptor_allocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+
+#include "debug.h"
+
+using namespace std;
+
+// descriptors of each type per set, used to size new pools. material sets are mostly a uniform
+// buffer and a handful of textures, and the scene set is a single uniform buffer
+static constexpr array<pair<VkDescriptorType, uint32_t>, 4> POOL_RATIOS =
+{
+    make_pair(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2u),
+    make_pair(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4u),
+    make_pair(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1u),
+    make_pair(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1u)
+};
+
+PTDescriptorAllocator::PTDescriptorAllocator(VkDevice _device)
+{
+    device = _device;
+}
+
+PTDescriptorAllocator::~PTDescriptorAllocator()
+{
+    // destroying the pools takes every set allocated from them along too
+    for (VkDescriptorPool pool : persistent.pools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    for (PoolChain& chain : transient)
+    {
+        for (VkDescriptorPool pool : chain.pools)
+            vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+}
+
+VkDescriptorSet PTDescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    auto it = free_sets.find(layout);
+    if (it != free_sets.end() && !it->second.empty())
+    {
+        VkDescriptorSet descriptor_set = it->second.back();
+        it->second.pop_back();
+        return descriptor_set;
+    }
+
+    return allocateFromChain(persistent, layout);
+}
+
+void PTDescriptorAllocator::free(VkDescriptorSetLayout layout, VkDescriptorSet descriptor_set)
+{
+    if (descriptor_set == VK_NULL_HANDLE)
+        return;
+    // frames already submitted may still have the set bound, so it can't be handed out (and rewritten) yet
+    retired_sets[current_frame].push_back({ layout, descriptor_set });
+}
+
+void PTDescriptorAllocator::forgetLayout(VkDescriptorSetLayout layout)
+{
+    // the sets themselves stay allocated in their pool until shutdown, but nothing can hand them out again
+    free_sets.erase(layout);
+    for (auto& retired : retired_sets)
+        erase_if(retired, [layout](const pair<VkDescriptorSetLayout, VkDescriptorSet>& entry) { return entry.first == layout; });
+}
+
+VkDescriptorSet PTDescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, uint32_t frame_index)
+{
+    return allocateFromChain(transient[frame_index], layout);
+}
+
+void PTDescriptorAllocator::collect(uint32_t frame_index)
+{
+    // the pools stick around, so after the first few frames this never allocates anything
+    PoolChain& chain = transient[frame_index];
+    for (size_t i = 0; i < chain.pools.size() && i <= chain.current; i++)
+        vkResetDescriptorPool(device, chain.pools[i], 0);
+    chain.current = 0;
+
+    // everything retired here was freed before this slot's last submission finished recording, which is done now.
+    // anything submitted before that had already been waited on, and anything recorded since doesn't use it
+    for (auto& entry : retired_sets[frame_index])
+        free_sets[entry.first].push_back(entry.second);
+    retired_sets[frame_index].clear();
+
+    // anything freed from here on could end up in this frame slot's next submission
+    current_frame = frame_index;
+}
+
+VkDescriptorPool PTDescriptorAllocator::createPool(uint32_t max_sets)
+{
+    array<VkDescriptorPoolSize, POOL_RATIOS.size()> pool_sizes;
+    for (size_t i = 0; i < POOL_RATIOS.size(); i++)
+        pool_sizes[i] = VkDescriptorPoolSize{ POOL_RATIOS[i].first, POOL_RATIOS[i].second * max_sets };
+
+    // no FREE_DESCRIPTOR_SET bit, since sets are recycled through the free lists instead
+    VkDescriptorPoolCreateInfo pool_create_info{ };
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.maxSets = max_sets;
+    pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+    pool_create_info.pPoolSizes = pool_sizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &pool_create_info, nullptr, &pool) != VK_SUCCESS)
+        throw runtime_error("unable to create descriptor pool");
+
+    return pool;
+}
+
+VkDescriptorSet PTDescriptorAllocator::allocateFromChain(PoolChain& chain, VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo set_allocation_info{ };
+    set_allocation_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_allocation_info.descriptorSetCount = 1;
+    set_allocation_info.pSetLayouts = &layout;
+
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    while (true)
+    {
+        bool fresh_pool = chain.current == chain.pools.size();
+        if (fresh_pool)
+        {
+            chain.pools.push_back(createPool(chain.next_pool_sets));
+            debugLog("created descriptor pool with " + to_string(chain.next_pool_sets) + " sets (" + to_string(chain.pools.size()) + " in chain)");
+            chain.next_pool_sets = min(chain.next_pool_sets * 2, DESCRIPTOR_POOL_MAX_SETS);
+        }
+
+        set_allocation_info.descriptorPool = chain.pools[chain.current];
+        VkResult result = vkAllocateDescriptorSets(device, &set_allocation_info, &descriptor_set);
+        if (result == VK_SUCCESS)
+            return descriptor_set;
+
+        // if even a brand new pool can't fit the set, another one won't help
+        if (fresh_pool || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+            throw runtime_error("unable to allocate descriptor set");
+
+        // this pool is full, move on to the next one (or make it)
+        chain.current++;
+    }
+}
\ No newline at end of file
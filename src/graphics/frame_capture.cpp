@@ -0,0 +1,268 @@
+#include "frame_capture.h"
+
+#include <format>
+
+#include "buffer.h"
+#include "image.h"
+#include "resource_manager.h"
+#include "bitmap.h"
+#include "debug.h"
+#include "profiler.h"
+
+using namespace std;
+
+// like PTImage::transitionImageLayout, but waiting on the given stage rather than nothing, since the capture image is
+// reused by frames which may still be copying out of it
+static void captureImageBarrier(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access)
+{
+    VkImageMemoryBarrier image_barrier{ };
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.image = image;
+    image_barrier.oldLayout = old_layout;
+    image_barrier.newLayout = new_layout;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.baseMipLevel = 0;
+    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.baseArrayLayer = 0;
+    image_barrier.subresourceRange.layerCount = 1;
+    image_barrier.srcAccessMask = src_access;
+    image_barrier.dstAccessMask = dst_access;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+}
+
+PTFrameCapture::PTFrameCapture(VkDevice _device, PTPhysicalDevice _physical_device)
+{
+    device = _device;
+    physical_device = _physical_device;
+
+    // the cpu reads every byte of these, which is painfully slow from uncached (write combined) memory
+    readback_memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (PTBuffer::hasMemoryType(~0u, readback_memory_flags | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, physical_device))
+        readback_memory_flags |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+    writer = thread(&PTFrameCapture::writerLoop, this);
+}
+
+PTFrameCapture::~PTFrameCapture()
+{
+    flush();
+
+    {
+        lock_guard<mutex> lock(write_mutex);
+        stopping = true;
+    }
+    write_condition.notify_all();
+    writer.join();
+
+    for (Readback* readback : readbacks)
+    {
+        if (readback->buffer != nullptr)
+            readback->buffer->removeReferencer();
+        delete readback;
+    }
+    if (capture_image != nullptr)
+        capture_image->removeReferencer();
+}
+
+void PTFrameCapture::requestScreenshot(string path)
+{
+    wants_screenshot = true;
+    screenshot_path = path;
+}
+
+void PTFrameCapture::beginSequence(string prefix)
+{
+    sequence_prefix = prefix;
+    sequence_frame = 0;
+    recording_sequence = true;
+    debugLog("recording frames to " + prefix + "*.bmp");
+}
+
+void PTFrameCapture::endSequence()
+{
+    if (!recording_sequence)
+        return;
+    recording_sequence = false;
+    debugLog("recorded " + to_string(sequence_frame) + " frames");
+}
+
+void PTFrameCapture::cancel()
+{
+    wants_screenshot = false;
+    recording_sequence = false;
+}
+
+void PTFrameCapture::recordCapture(VkCommandBuffer command_buffer, uint32_t frame_index, VkImage source, VkExtent2D source_extent, VkExtent2D output_extent)
+{
+    if (!wantsCapture())
+        return;
+
+    // one readback can go to both a screenshot and the sequence, if they land on the same frame
+    Write write;
+    if (wants_screenshot)
+        write.paths.push_back(screenshot_path);
+    if (recording_sequence)
+        write.paths.push_back(format("{}{:06}.bmp", sequence_prefix, sequence_frame++));
+    wants_screenshot = false;
+
+    // the output size only changes with the swapchain, which waits for the device to go idle first
+    if (capture_image == nullptr || capture_image->getSize().width != output_extent.width || capture_image->getSize().height != output_extent.height)
+    {
+        if (capture_image != nullptr)
+            capture_image->removeReferencer();
+        capture_image = PTResourceManager::get()->createImage(output_extent,
+                                                             VK_FORMAT_B8G8R8A8_SRGB,
+                                                             VK_IMAGE_TILING_OPTIMAL,
+                                                             VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    write.readback = acquireReadback(output_extent);
+
+    // blit into bgra, which is what bitmaps store, so the pixels can go straight to the file without swizzling.
+    // the old contents don't matter, but the last frame's copy out of it has to have finished
+    captureImageBarrier(command_buffer, capture_image->getImage(),
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_ACCESS_NONE_KHR, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    VkImageSubresourceLayers layers{ };
+    layers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    layers.baseArrayLayer = 0;
+    layers.layerCount = 1;
+    layers.mipLevel = 0;
+
+    VkImageBlit blit_region{ };
+    blit_region.srcOffsets[0] = VkOffset3D{ 0, 0, 0 };
+    blit_region.srcOffsets[1] = VkOffset3D{ static_cast<int32_t>(source_extent.width), static_cast<int32_t>(source_extent.height), 1 };
+    blit_region.dstOffsets[0] = VkOffset3D{ 0, static_cast<int32_t>(output_extent.height), 0 };
+    blit_region.dstOffsets[1] = VkOffset3D{ static_cast<int32_t>(output_extent.width), 0, 1 };
+    blit_region.srcSubresource = layers;
+    blit_region.dstSubresource = layers;
+
+    bool same_size = source_extent.width == output_extent.width && source_extent.height == output_extent.height;
+    vkCmdBlitImage(command_buffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, capture_image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit_region, same_size ? VK_FILTER_NEAREST : VK_FILTER_LINEAR);
+
+    captureImageBarrier(command_buffer, capture_image->getImage(),
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkBufferImageCopy copy_region{ };
+    copy_region.imageOffset = VkOffset3D{ 0, 0, 0 };
+    copy_region.imageExtent = VkExtent3D{ output_extent.width, output_extent.height, 1 };
+    copy_region.imageSubresource = layers;
+    copy_region.bufferOffset = 0;
+    copy_region.bufferRowLength = 0;
+    copy_region.bufferImageHeight = 0;
+
+    vkCmdCopyImageToBuffer(command_buffer, capture_image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, write.readback->buffer->getBuffer(), 1, &copy_region);
+
+    // make the copy visible to the cpu once the frame's fence has signalled
+    VkBufferMemoryBarrier buffer_barrier{ };
+    buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.buffer = write.readback->buffer->getBuffer();
+    buffer_barrier.offset = 0;
+    buffer_barrier.size = VK_WHOLE_SIZE;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+    pending[frame_index] = move(write);
+}
+
+void PTFrameCapture::collect(uint32_t frame_index)
+{
+    if (pending[frame_index].readback == nullptr)
+        return;
+
+    {
+        lock_guard<mutex> lock(write_mutex);
+        writes.push_back(move(pending[frame_index]));
+    }
+    write_condition.notify_all();
+    pending[frame_index] = Write{ };
+}
+
+void PTFrameCapture::flush()
+{
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        collect(i);
+
+    unique_lock<mutex> lock(write_mutex);
+    write_condition.wait(lock, [this]() { return writes.empty() && writes_in_progress == 0; });
+}
+
+PTFrameCapture::Readback* PTFrameCapture::acquireReadback(VkExtent2D extent)
+{
+    // every readback not waiting on a frame slot is either free or with the writer, so if there's none to spare,
+    // the writer will hand one back eventually
+    Readback* readback = nullptr;
+    {
+        unique_lock<mutex> lock(write_mutex);
+        if (free_readbacks.empty() && readbacks.size() >= MAX_QUEUED_WRITES + MAX_FRAMES_IN_FLIGHT)
+        {
+            PT_PROFILE_ZONE("wait for capture writer");
+            write_condition.wait(lock, [this]() { return !free_readbacks.empty(); });
+        }
+
+        if (!free_readbacks.empty())
+        {
+            readback = free_readbacks.back();
+            free_readbacks.pop_back();
+        }
+        else
+        {
+            readback = new Readback();
+            readbacks.push_back(readback);
+        }
+    }
+
+    // nothing else is touching a readback that's just been taken, so it can be resized outside the lock
+    if (readback->buffer == nullptr || readback->extent.width != extent.width || readback->extent.height != extent.height)
+    {
+        if (readback->buffer != nullptr)
+            readback->buffer->removeReferencer();
+        readback->buffer = PTResourceManager::get()->createBuffer(static_cast<VkDeviceSize>(extent.width) * extent.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readback_memory_flags);
+        readback->buffer->map();
+        readback->extent = extent;
+    }
+
+    return readback;
+}
+
+void PTFrameCapture::writerLoop()
+{
+    profileSetThreadName("capture writer");
+
+    unique_lock<mutex> lock(write_mutex);
+    while (true)
+    {
+        write_condition.wait(lock, [this]() { return stopping || !writes.empty(); });
+        if (writes.empty())
+            return;
+
+        Write write = move(writes.front());
+        writes.pop_front();
+        writes_in_progress++;
+        lock.unlock();
+
+        {
+            PT_PROFILE_ZONE("write capture");
+            const char* pixels = static_cast<const char*>(write.readback->buffer->getMappedMemory());
+            for (const string& path : write.paths)
+            {
+                if (!writeBGRABitmap(path, pixels, write.readback->extent.width, write.readback->extent.height))
+                    debugLog("WARNING: unable to write capture to '" + path + "'");
+            }
+        }
+
+        lock.lock();
+        free_readbacks.push_back(write.readback);
+        writes_in_progress--;
+        write_condition.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "gpu_profiler.h"
+
+#include <stdexcept>
+
+#include "debug.h"
+
+using namespace std;
+
+// counters gathered for zones with statistics. results come back in bit order, which is the order of the Zone fields
+static const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+static const uint32_t STATISTICS_COUNT = 4;
+
+PTGPUProfiler::PTGPUProfiler(VkDevice _device, const PTPhysicalDevice& physical_device, bool enable_statistics)
+{
+    device = _device;
+
+    // not every queue can write timestamps, in which case there's nothing to measure with
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device.getDevice(), &family_count, nullptr);
+    vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device.getDevice(), &family_count, families.data());
+
+    uint32_t valid_bits = families[physical_device.getQueueFamily(PTPhysicalDevice::QueueFamily::GRAPHICS)].timestampValidBits;
+    if (valid_bits == 0)
+    {
+        debugLog("WARNING: graphics queue doesn't support timestamps, gpu profiling will be unavailable");
+        return;
+    }
+    timestamp_mask = (valid_bits >= 64) ? ~0ull : ((1ull << valid_bits) - 1);
+    timestamp_period = physical_device.getProperties().limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo pool_create_info{ };
+    pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_create_info.queryCount = getFirstTimestamp(MAX_FRAMES_IN_FLIGHT);
+
+    if (vkCreateQueryPool(device, &pool_create_info, nullptr, &timestamp_pool) != VK_SUCCESS)
+        throw runtime_error("unable to create timestamp query pool");
+
+    if (!enable_statistics)
+        return;
+
+    pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    pool_create_info.queryCount = getFirstStatistics(MAX_FRAMES_IN_FLIGHT);
+    pool_create_info.pipelineStatistics = STATISTICS_FLAGS;
+
+    if (vkCreateQueryPool(device, &pool_create_info, nullptr, &statistics_pool) != VK_SUCCESS)
+        throw runtime_error("unable to create pipeline statistics query pool");
+}
+
+PTGPUProfiler::~PTGPUProfiler()
+{
+    stopLog();
+    if (statistics_pool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, statistics_pool, nullptr);
+    if (timestamp_pool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, timestamp_pool, nullptr);
+}
+
+bool PTGPUProfiler::collect(uint32_t frame_index)
+{
+    FrameQueries& frame = frames[frame_index];
+    if (!isAvailable() || !frame.pending)
+        return false;
+
+    // no wait flag, so this never stalls. if the frame isn't done yet its results are just skipped
+    vector<uint64_t> timestamps(2 + (frame.zones.size() * 2));
+    if (vkGetQueryPoolResults(device, timestamp_pool, getFirstTimestamp(frame_index), static_cast<uint32_t>(timestamps.size()), timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return false;
+
+    vector<uint64_t> statistics(frame.statistics_used * STATISTICS_COUNT);
+    if (frame.statistics_used > 0)
+    {
+        if (vkGetQueryPoolResults(device, statistics_pool, getFirstStatistics(frame_index), frame.statistics_used, statistics.size() * sizeof(uint64_t), statistics.data(), STATISTICS_COUNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+            return false;
+    }
+    frame.pending = false;
+
+    // counters wrap at timestampValidBits, so the difference has to be masked too
+    auto toMilliseconds = [this](uint64_t start, uint64_t end)
+    {
+        return static_cast<float>((static_cast<double>((end - start) & timestamp_mask) * timestamp_period) / 1000000.0);
+    };
+
+    frame_time = toMilliseconds(timestamps[0], timestamps[1]);
+    results = frame.zones;
+    results_frame = frame.frame_number;
+    for (size_t z = 0; z < results.size(); z++)
+    {
+        Zone& zone = results[z];
+        zone.gpu_ms = toMilliseconds(timestamps[2 + (z * 2)], timestamps[3 + (z * 2)]);
+        int32_t query = frame.statistics_queries[z];
+        zone.has_statistics = query >= 0;
+        if (!zone.has_statistics)
+            continue;
+        const uint64_t* values = statistics.data() + (query * STATISTICS_COUNT);
+        zone.vertices = values[0];
+        zone.primitives = values[1];
+        zone.fragment_invocations = values[2];
+        zone.compute_invocations = values[3];
+    }
+
+    if (csv_log.is_open())
+        writeLog();
+
+    return true;
+}
+
+void PTGPUProfiler::beginFrame(VkCommandBuffer command_buffer, uint32_t frame_index)
+{
+    if (!isAvailable())
+        return;
+
+    // anything not collected by now is lost, since the queries are about to be reused
+    recording_frame = frame_index;
+    FrameQueries& frame = frames[frame_index];
+    frame.zones.clear();
+    frame.statistics_queries.clear();
+    frame.statistics_used = 0;
+    frame.depth = 0;
+    frame.statistics_open = false;
+    frame.frame_number = frame_counter++;
+    frame.pending = false;
+
+    vkCmdResetQueryPool(command_buffer, timestamp_pool, getFirstTimestamp(frame_index), getFirstTimestamp(1));
+    if (hasStatistics())
+        vkCmdResetQueryPool(command_buffer, statistics_pool, getFirstStatistics(frame_index), MAX_ZONES);
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamp_pool, getFirstTimestamp(frame_index));
+}
+
+void PTGPUProfiler::endFrame(VkCommandBuffer command_buffer)
+{
+    if (!isAvailable())
+        return;
+
+    FrameQueries& frame = frames[recording_frame];
+    if (frame.depth != 0)
+        debugLog("WARNING: gpu profiler frame ended with " + to_string(frame.depth) + " zones still open");
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamp_pool, getFirstTimestamp(recording_frame) + 1);
+    frame.pending = true;
+}
+
+uint32_t PTGPUProfiler::beginZone(VkCommandBuffer command_buffer, const string& name, bool with_statistics)
+{
+    if (!isAvailable())
+        return NO_ZONE;
+
+    FrameQueries& frame = frames[recording_frame];
+    if (frame.zones.size() >= MAX_ZONES)
+        return NO_ZONE;
+
+    uint32_t zone = static_cast<uint32_t>(frame.zones.size());
+    frame.zones.push_back(Zone{ name, frame.depth });
+
+    // only one statistics query can be active at a time, so zones inside one just get timestamps
+    int32_t query = -1;
+    if (with_statistics && hasStatistics() && !frame.statistics_open)
+    {
+        query = static_cast<int32_t>(frame.statistics_used++);
+        vkCmdBeginQuery(command_buffer, statistics_pool, getFirstStatistics(recording_frame) + query, 0);
+        frame.statistics_open = true;
+    }
+    frame.statistics_queries.push_back(query);
+    frame.depth++;
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamp_pool, getFirstTimestamp(recording_frame) + 2 + (zone * 2));
+    return zone;
+}
+
+void PTGPUProfiler::endZone(VkCommandBuffer command_buffer, uint32_t zone)
+{
+    FrameQueries& frame = frames[recording_frame];
+    if (!isAvailable() || zone >= frame.zones.size())
+        return;
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamp_pool, getFirstTimestamp(recording_frame) + 3 + (zone * 2));
+
+    int32_t query = frame.statistics_queries[zone];
+    if (query >= 0)
+    {
+        vkCmdEndQuery(command_buffer, statistics_pool, getFirstStatistics(recording_frame) + query);
+        frame.statistics_open = false;
+    }
+    frame.depth--;
+}
+
+bool PTGPUProfiler::startLog(string path)
+{
+    stopLog();
+    csv_log.open(path);
+    if (!csv_log.is_open())
+    {
+        debugLog("WARNING: unable to open gpu profile log '" + path + "'");
+        return false;
+    }
+    csv_log << "frame,zone,depth,gpu_ms,vertices,primitives,fragment_invocations,compute_invocations\n";
+    debugLog("logging gpu profile to '" + path + "'");
+    return true;
+}
+
+void PTGPUProfiler::stopLog()
+{
+    if (csv_log.is_open())
+        csv_log.close();
+}
+
+void PTGPUProfiler::writeLog()
+{
+    // the whole frame gets a row too
+    csv_log << results_frame << ",frame," << 0 << "," << frame_time << ",,,,\n";
+    for (const Zone& zone : results)
+    {
+        csv_log << results_frame << ",\"" << zone.name << "\"," << zone.depth << "," << zone.gpu_ms << ",";
+        if (zone.has_statistics)
+            csv_log << zone.vertices << "," << zone.primitives << "," << zone.fragment_invocations << "," << zone.compute_invocations;
+        else
+            csv_log << ",,,";
+        csv_log << '\n';
+    }
+}
\ No newline at end of file
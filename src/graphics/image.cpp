@@ -2,11 +2,15 @@
 
 #include <stdexcept>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 #include "buffer.h"
 #include "render_server.h"
 #include "resource_manager.h"
-#include "bitmap.h"
+#include "image_decoder.h"
+#include "mipmap.h"
+#include "texture_file.h"
 
 using namespace std;
 
@@ -22,27 +26,10 @@ PTImage::PTImage(VkDevice _device, string texture_path, PTPhysicalDevice physica
     device = _device;
     origin_path = texture_path;
 
-    char* data;
-    int32_t _width;
-    int32_t _height;
-    if (!readRGBABitmap(texture_path, data, _width, _height))
-        throw runtime_error("unable to read texture file '" + texture_path + "'");
-    VkDeviceSize image_size = _width * _height * 4;
-
-    PTBuffer* staging_buffer = PTResourceManager::get()->createBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void* mapped_buffer = staging_buffer->map();
-    memcpy(mapped_buffer, data, static_cast<size_t>(image_size));
-    staging_buffer->unmap();
-    delete[] data;
-
-    createImage(physical_device, VkExtent2D{ static_cast<uint32_t>(_width), static_cast<uint32_t>(_height) }, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(staging_buffer->getBuffer());
-    transitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    staging_buffer->removeReferencer();
+    if (texture_path.ends_with(".pttex"))
+        loadCooked(physical_device, texture_path);
+    else
+        loadImage(physical_device, texture_path);
 }
 
 VkImageView PTImage::createImageView(VkImageAspectFlags aspect_flags)
@@ -54,7 +41,7 @@ VkImageView PTImage::createImageView(VkImageAspectFlags aspect_flags)
     view_create_info.format = format;
     view_create_info.subresourceRange.aspectMask = aspect_flags;
     view_create_info.subresourceRange.baseMipLevel = 0;
-    view_create_info.subresourceRange.levelCount = 1;
+    view_create_info.subresourceRange.levelCount = mip_levels;
     view_create_info.subresourceRange.baseArrayLayer = 0;
     view_create_info.subresourceRange.layerCount = 1;
 
@@ -67,12 +54,12 @@ VkImageView PTImage::createImageView(VkImageAspectFlags aspect_flags)
 
 void PTImage::transitionImageLayout(VkImageLayout new_layout, VkCommandBuffer cmd)
 {
-    transitionImageLayout(image, layout, new_layout, cmd);
+    transitionImageLayout(image, layout, new_layout, cmd, mip_levels);
 
     layout = new_layout;
 }
 
-void PTImage::copyBufferToImage(VkBuffer buffer, VkCommandBuffer cmd)
+void PTImage::copyBufferToImage(VkBuffer buffer, VkCommandBuffer cmd, uint32_t mip_level, VkDeviceSize buffer_offset)
 {
     VkCommandBuffer command_buffer;
     if (cmd == VK_NULL_HANDLE)
@@ -81,20 +68,20 @@ void PTImage::copyBufferToImage(VkBuffer buffer, VkCommandBuffer cmd)
         command_buffer = cmd;
 
     VkBufferImageCopy copy_region{ };
-    copy_region.bufferOffset = 0;
+    copy_region.bufferOffset = buffer_offset;
     copy_region.bufferRowLength = 0;
     copy_region.bufferImageHeight = 0;
 
     copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    copy_region.imageSubresource.mipLevel = 0;
+    copy_region.imageSubresource.mipLevel = mip_level;
     copy_region.imageSubresource.baseArrayLayer = 0;
     copy_region.imageSubresource.layerCount = 1;
 
     copy_region.imageOffset = VkOffset3D{0, 0, 0};
     copy_region.imageExtent =
     {
-        size.width,
-        size.height,
+        max(size.width >> mip_level, 1u),
+        max(size.height >> mip_level, 1u),
         1
     };
 
@@ -104,7 +91,7 @@ void PTImage::copyBufferToImage(VkBuffer buffer, VkCommandBuffer cmd)
         PTRenderServer::get()->endTransientCommands(command_buffer);
 }
 
-void PTImage::transitionImageLayout(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkCommandBuffer cmd)
+void PTImage::transitionImageLayout(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkCommandBuffer cmd, uint32_t mip_levels)
 {
     if (old_layout == new_layout) return;
     
@@ -123,7 +110,7 @@ void PTImage::transitionImageLayout(VkImage image, VkImageLayout old_layout, VkI
     image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     image_barrier.subresourceRange.baseMipLevel = 0;
-    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.levelCount = mip_levels;
     image_barrier.subresourceRange.baseArrayLayer = 0;
     image_barrier.subresourceRange.layerCount = 1;
     
@@ -177,9 +164,10 @@ PTImage::~PTImage()
     vkFreeMemory(device, image_memory, nullptr);
 }
 
-void PTImage::createImage(PTPhysicalDevice physical_device, VkExtent2D _size, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags properties)
+void PTImage::createImage(PTPhysicalDevice physical_device, VkExtent2D _size, VkFormat _format, VkImageTiling _tiling, VkImageUsageFlags _usage, VkMemoryPropertyFlags properties, uint32_t _mip_levels)
 {
     size = _size;
+    mip_levels = _mip_levels;
     format = _format;
     tiling = _tiling;
     usage = _usage;
@@ -192,7 +180,7 @@ void PTImage::createImage(PTPhysicalDevice physical_device, VkExtent2D _size, Vk
     image_create_info.extent.width = size.width;
     image_create_info.extent.height = size.height;
     image_create_info.extent.depth = 1;
-    image_create_info.mipLevels = 1;
+    image_create_info.mipLevels = mip_levels;
     image_create_info.arrayLayers = 1;
     image_create_info.format = format;
     image_create_info.tiling = tiling;
@@ -208,13 +196,210 @@ void PTImage::createImage(PTPhysicalDevice physical_device, VkExtent2D _size, Vk
     VkMemoryRequirements memory_requirements{ };
     vkGetImageMemoryRequirements(device, image, &memory_requirements);
 
+    // lazily allocated memory only exists on tiled gpus, everywhere else just use normal memory
+    VkMemoryPropertyFlags memory_flags = properties;
+    if ((memory_flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !PTBuffer::hasMemoryType(memory_requirements.memoryTypeBits, memory_flags, physical_device))
+        memory_flags &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
     VkMemoryAllocateInfo allocate_info{ };
     allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocate_info.allocationSize = memory_requirements.size;
-    allocate_info.memoryTypeIndex = PTBuffer::findMemoryType(memory_requirements.memoryTypeBits, properties, physical_device);
+    allocate_info.memoryTypeIndex = PTBuffer::findMemoryType(memory_requirements.memoryTypeBits, memory_flags, physical_device);
 
     if (vkAllocateMemory(device, &allocate_info, nullptr, &image_memory) != VK_SUCCESS)
         throw runtime_error("unable to allocate image memory");
 
     vkBindImageMemory(device, image, image_memory, 0);
 }
+
+
+void PTImage::generateMipmaps(VkCommandBuffer cmd)
+{
+    VkCommandBuffer command_buffer;
+    if (cmd == VK_NULL_HANDLE)
+        command_buffer = PTRenderServer::get()->beginTransientCommands();
+    else
+        command_buffer = cmd;
+
+    VkImageMemoryBarrier image_barrier{ };
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.image = image;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.baseArrayLayer = 0;
+    image_barrier.subresourceRange.layerCount = 1;
+
+    int32_t mip_width = static_cast<int32_t>(size.width);
+    int32_t mip_height = static_cast<int32_t>(size.height);
+    for (uint32_t level = 1; level < mip_levels; level++)
+    {
+        // the level above has just been written, so make it readable before blitting out of it
+        image_barrier.subresourceRange.baseMipLevel = level - 1;
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+        int32_t next_width = max(mip_width / 2, 1);
+        int32_t next_height = max(mip_height / 2, 1);
+
+        VkImageBlit blit{ };
+        blit.srcOffsets[0] = VkOffset3D{ 0, 0, 0 };
+        blit.srcOffsets[1] = VkOffset3D{ mip_width, mip_height, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = VkOffset3D{ 0, 0, 0 };
+        blit.dstOffsets[1] = VkOffset3D{ next_width, next_height, 1 };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        vkCmdBlitImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        // and once it's been read from it's done with
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+        mip_width = next_width;
+        mip_height = next_height;
+    }
+
+    // the last level was only ever written to
+    image_barrier.subresourceRange.baseMipLevel = mip_levels - 1;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+    layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    if (cmd == VK_NULL_HANDLE)
+        PTRenderServer::get()->endTransientCommands(command_buffer);
+}
+
+void PTImage::loadImage(PTPhysicalDevice physical_device, string texture_path)
+{
+    // all of this gets decided once the decoder has read the header
+    VkExtent2D extent{ };
+    VkFormat texture_format = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t pixel_size = 4;
+    bool gpu_mipmaps = false;
+    vector<PTMipLevel> mips;
+    PTBuffer* staging_buffer = nullptr;
+    uint8_t* staging_pixels = nullptr;
+    // pixels are decoded straight into the staging buffer, unless the mips have to be built on the cpu. then they
+    // go into level 0 of the chain here instead, since reading back out of mapped memory can be very slow
+    vector<uint8_t> cpu_chain;
+
+    PTImageSink sink;
+    sink.begin = [&](const PTImageInfo& info)
+    {
+        extent = VkExtent2D{ info.width, info.height };
+        pixel_size = imagePixelSize(info.format);
+        texture_format = (info.format == PTImagePixelFormat::PIXEL_RGBA16F) ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R8G8B8A8_SRGB;
+
+        // blitting down the chain needs blit and linear filtering support for the format, otherwise build the chain
+        // on the cpu and upload all of it. that only handles rgba8, so anything else goes without mips
+        gpu_mipmaps = physical_device.supportsFormat(texture_format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+        if (gpu_mipmaps || info.format != PTImagePixelFormat::PIXEL_RGBA8)
+        {
+            mips.push_back(PTMipLevel{ extent.width, extent.height, 0 });
+            staging_buffer = PTResourceManager::get()->createBuffer(static_cast<VkDeviceSize>(extent.width) * extent.height * pixel_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            staging_pixels = static_cast<uint8_t*>(staging_buffer->map());
+        }
+        else
+        {
+            mips = mipChainLayoutRGBA8(extent.width, extent.height);
+            cpu_chain.resize(mipChainSizeRGBA8(mips));
+        }
+        return true;
+    };
+    sink.row = [&](uint32_t y)
+    {
+        uint8_t* pixels = staging_pixels ? staging_pixels : cpu_chain.data();
+        return pixels + (static_cast<size_t>(y) * extent.width * pixel_size);
+    };
+
+    if (!decodeImage(texture_path, sink))
+    {
+        if (staging_buffer)
+        {
+            staging_buffer->unmap();
+            staging_buffer->removeReferencer();
+        }
+        throw runtime_error("unable to read texture file '" + texture_path + "'");
+    }
+
+    if (!cpu_chain.empty())
+    {
+        generateMipChainRGBA8(cpu_chain.data(), mips, true);
+        staging_buffer = PTResourceManager::get()->createBuffer(cpu_chain.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        memcpy(staging_buffer->map(), cpu_chain.data(), cpu_chain.size());
+    }
+    staging_buffer->unmap();
+
+    uint32_t levels = gpu_mipmaps ? mipLevelCount(extent.width, extent.height) : static_cast<uint32_t>(mips.size());
+    createImage(physical_device, extent, texture_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, levels);
+
+    VkCommandBuffer cmd = PTRenderServer::get()->beginTransientCommands();
+    transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd);
+    for (uint32_t level = 0; level < mips.size(); level++)
+        copyBufferToImage(staging_buffer->getBuffer(), cmd, level, mips[level].offset);
+    if (gpu_mipmaps)
+        generateMipmaps(cmd);
+    else
+        transitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmd);
+    PTRenderServer::get()->endTransientCommands(cmd);
+
+    staging_buffer->removeReferencer();
+}
+
+// cooked textures already have their whole mip chain, so they just get copied in as they are
+void PTImage::loadCooked(PTPhysicalDevice physical_device, string texture_path)
+{
+    PTTextureFile texture;
+    if (!readTextureFile(texture_path, texture))
+        throw runtime_error("unable to read cooked texture file '" + texture_path + "'");
+
+    VkFormat texture_format = getTextureFormat(texture.format, texture.srgb);
+    if (!physical_device.supportsFormat(texture_format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        throw runtime_error("cooked texture '" + texture_path + "' uses a format this device can't sample");
+
+    PTBuffer* staging_buffer = PTResourceManager::get()->createBuffer(texture.data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void* mapped_buffer = staging_buffer->map();
+    memcpy(mapped_buffer, texture.data.data(), texture.data.size());
+    staging_buffer->unmap();
+
+    createImage(physical_device, VkExtent2D{ texture.width, texture.height }, texture_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, static_cast<uint32_t>(texture.levels.size()));
+
+    VkCommandBuffer cmd = PTRenderServer::get()->beginTransientCommands();
+    transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd);
+    for (uint32_t level = 0; level < texture.levels.size(); level++)
+        copyBufferToImage(staging_buffer->getBuffer(), cmd, level, texture.levels[level].offset);
+    transitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmd);
+    PTRenderServer::get()->endTransientCommands(cmd);
+
+    staging_buffer->removeReferencer();
+}
+
+VkFormat PTImage::getTextureFormat(PTTextureFormat format, bool srgb)
+{
+    switch (format)
+    {
+    case PTTextureFormat::BC1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case PTTextureFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case PTTextureFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case PTTextureFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
\ No newline at end of file
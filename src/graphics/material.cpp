@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <fstream>
 #include <cstring>
+#include <set>
+#include <algorithm>
 
 #include "resource_manager.h"
 #include "shader.h"
@@ -12,6 +14,8 @@
 #include "swapchain.h"
 #include "deserialiser.h"
 #include "sampler.h"
+#include "texture_table.h"
+#include "descriptor_allocator.h"
 
 using namespace std;
 
@@ -101,7 +105,7 @@ PTMaterial::PTMaterial(VkDevice _device, string material_path, PTRenderPass* _re
 
     for (PTDeserialiser::UniformParam variable : uniforms)
     {
-        if (variable.binding == TRANSFORM_UNIFORM_BINDING
+        if (variable.binding == TEXTURE_INDEX_BINDING
          || variable.binding == SCENE_UNIFORM_BINDING)
             continue;
         
@@ -152,19 +156,34 @@ PTMaterial::~PTMaterial()
     }
 
     for (auto pair : textures)
+        releaseTexture(pair.first);
+
+    if (hasTextureIndexBuffer())
     {
-        vkDestroyImageView(device, pair.second.second.first, nullptr);
-        removeDependency(pair.second.first);
-        removeDependency(pair.second.second.second);
+        if (PTTextureTable* table = PTResourceManager::get()->getTextureTable())
+            table->release(default_texture_slot);
+        for (PTBuffer* buffer : texture_index_buffers)
+            removeDependency(buffer);
     }
 
+    releaseDescriptorSets();
+    PTResourceManager::get()->cancelTextureUpdate(this);
+
     removeDependency(render_pass);
     removeDependency(shader);
     removeDependency(pipeline);
 }
 
-void PTMaterial::applySetWrites(VkDescriptorSet descriptor_set)
+void PTMaterial::applySetWrites()
+{
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        applySetWrites(i);
+    needs_texture_update = false;
+}
+
+void PTMaterial::applySetWrites(uint32_t frame_index)
 {
+    VkDescriptorSet descriptor_set = descriptor_sets[frame_index];
     vector<VkWriteDescriptorSet> set_writes;
     size_t descriptors = getShader()->getDescriptorCount();
     vector< VkDescriptorBufferInfo> buffer_infos;
@@ -173,17 +192,19 @@ void PTMaterial::applySetWrites(VkDescriptorSet descriptor_set)
     {
         // get the binding and check if it's one of the engine bindings
         auto binding_info = getShader()->getDescriptorBinding(b);
-        if (binding_info.bind_point == TRANSFORM_UNIFORM_BINDING
-		 || binding_info.bind_point == SCENE_UNIFORM_BINDING)
+        if (binding_info.bind_point == SCENE_UNIFORM_BINDING)
 			continue;
 
         // only create a write if it's a uniform buffer
         if (binding_info.type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
             continue;
 
-        // configure a write operation which hooks the material uniform buffer up to the descriptor set
+        // configure a write operation which hooks the material uniform buffer (or the texture indices) up to the descriptor set
+        PTBuffer* buffer = (binding_info.bind_point == TEXTURE_INDEX_BINDING) ? texture_index_buffers[frame_index] : uniform_buffers[binding_info.bind_point];
+        if (buffer == nullptr)
+            continue;
         VkDescriptorBufferInfo buffer_info{ };
-        buffer_info.buffer = uniform_buffers[binding_info.bind_point]->getBuffer();
+        buffer_info.buffer = buffer->getBuffer();
         buffer_info.offset = 0;
         buffer_info.range = binding_info.size;
         buffer_infos.push_back(buffer_info);
@@ -203,6 +224,10 @@ void PTMaterial::applySetWrites(VkDescriptorSet descriptor_set)
     image_infos.reserve(textures.size());
     for (auto pair : textures)
     {
+        // bindless textures live in the global array, not in this set
+        if (texture_slots.contains(pair.first) || pair.second.first == nullptr)
+            continue;
+
         // configure a write operation which hooks the material texture up to the descriptor set
         VkDescriptorImageInfo image_info{ };
         image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -228,12 +253,19 @@ void PTMaterial::setTexture(uint16_t bind_point, PTImage* texture, VkSamplerAddr
 {
     PTShader::BindingInfo binding;
     size_t _;
+    bool is_bindless = false;
     if (!getShader()->hasDescriptorWithBinding(bind_point, binding, _))
     {
-        debugLog("WARNING: attempt to write to nonexistent texture binding on material '" + origin_path + "', ignoring");
-        return;
+        // in bindless mode, texture slots aren't descriptors at all, just entries in the texture index block
+        is_bindless = hasTextureIndexBuffer() && bind_point < MAX_MATERIAL_TEXTURES
+            && bind_point != TEXTURE_INDEX_BINDING && bind_point != SCENE_UNIFORM_BINDING;
+        if (!is_bindless)
+        {
+            debugLog("WARNING: attempt to write to nonexistent texture binding on material '" + origin_path + "', ignoring");
+            return;
+        }
     }
-    if (binding.type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+    else if (binding.type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
     {
         debugLog("WARNING: attempt to write to non-texture descriptor binding on material '" + origin_path + "', ignoring");
         return;
@@ -244,15 +276,20 @@ void PTMaterial::setTexture(uint16_t bind_point, PTImage* texture, VkSamplerAddr
         return;
 
     // if a texture is already bound, destroy it
-    auto it = textures.find(bind_point);
-    if (it != textures.end() && it->second.first != nullptr)
+    releaseTexture(bind_point);
+
+    if (texture != nullptr && is_bindless)
     {
-        vkDestroyImageView(device, it->second.second.first, nullptr);
-        removeDependency(it->second.first);
-        removeDependency(it->second.second.second);
+        // a single write into the global array (if nobody else is using this texture already), and an index update
+        addDependency(texture);
+        PTSampler* sampler = PTResourceManager::get()->createSampler(repeat_mode, filtering, filtering, 2);
+        textures[bind_point] = { texture, { VK_NULL_HANDLE, sampler } };
+        addDependency(sampler, false);
+        uint32_t slot = PTResourceManager::get()->getTextureTable()->acquire(texture, sampler, aspect);
+        texture_slots[bind_point] = slot;
+        setTextureIndex(bind_point, slot);
     }
-
-    if (texture != nullptr)
+    else if (texture != nullptr)
     {
         addDependency(texture);
         textures[bind_point] = { texture, 
@@ -269,7 +306,35 @@ void PTMaterial::setTexture(uint16_t bind_point, PTImage* texture, VkSamplerAddr
         setTexture(bind_point, img);
         img->removeReferencer();
     }
-    needs_texture_update = true;
+
+    // bindless textures are already live, there's no set to rewrite. otherwise queue the material up
+    // to be rewritten before the next frame, once, however many textures change in the meantime
+    if (!is_bindless && !needs_texture_update)
+    {
+        needs_texture_update = true;
+        PTResourceManager::get()->queueTextureUpdate(this);
+    }
+}
+
+void PTMaterial::releaseTexture(uint16_t bind_point)
+{
+    auto it = textures.find(bind_point);
+    if (it == textures.end() || it->second.first == nullptr)
+        return;
+
+    // bindless textures don't have a view of their own, they give their slot back to the table instead
+    vkDestroyImageView(device, it->second.second.first, nullptr);
+    auto slot = texture_slots.find(bind_point);
+    if (slot != texture_slots.end())
+    {
+        if (PTTextureTable* table = PTResourceManager::get()->getTextureTable())
+            table->release(slot->second);
+        setTextureIndex(bind_point, default_texture_slot);
+        texture_slots.erase(slot);
+    }
+    removeDependency(it->second.first);
+    removeDependency(it->second.second.second);
+    it->second = { nullptr, { VK_NULL_HANDLE, nullptr } };
 }
 
 PTImage* PTMaterial::getTexture(uint16_t bind_point)
@@ -287,7 +352,7 @@ void PTMaterial::initialiseMaterial(PTSwapchain* swapchain, VkBool32 depth_write
     {
         // get the binding and check if it's one of the engine bindings
         auto binding_info = getShader()->getDescriptorBinding(b);
-        if (binding_info.bind_point == TRANSFORM_UNIFORM_BINDING
+        if (binding_info.bind_point == TEXTURE_INDEX_BINDING
             || binding_info.bind_point == SCENE_UNIFORM_BINDING)
             continue;
 
@@ -304,7 +369,146 @@ void PTMaterial::initialiseMaterial(PTSwapchain* swapchain, VkBool32 depth_write
         }
     }
 
+    createTextureIndexBuffer();
+    createDescriptorSets();
+
     addDependency(shader, true);
     addDependency(render_pass, true);
     addDependency(pipeline, false);
 }
+
+void PTMaterial::createTextureIndexBuffer()
+{
+    // only bindless shaders have the index block, everything else binds textures the old way
+    PTShader::BindingInfo binding;
+    size_t _;
+    if (!PTResourceManager::get()->usesBindlessTextures() || !getShader()->hasDescriptorWithBinding(TEXTURE_INDEX_BINDING, binding, _))
+        return;
+
+    for (PTBuffer*& buffer : texture_index_buffers)
+    {
+        buffer = PTResourceManager::get()->createBuffer(binding.size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        addDependency(buffer, false);
+    }
+
+    // we can't tell which slots the shader actually samples, so point all of them at the blank texture
+    // rather than at whatever happens to live in slot 0
+    PTImage* img = PTResourceManager::get()->createImage(DEFAULT_TEXTURE_PATH);
+    PTSampler* sampler = PTResourceManager::get()->createSampler(VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_FILTER_NEAREST, VK_FILTER_NEAREST, 2);
+    default_texture_slot = PTResourceManager::get()->getTextureTable()->acquire(img, sampler, VK_IMAGE_ASPECT_COLOR_BIT);
+    img->removeReferencer();
+    sampler->removeReferencer();
+
+    // nothing is drawing with the buffers yet, so they can be filled in straight away
+    texture_indices.fill(default_texture_slot);
+    texture_indices_stale.fill(true);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        updateTextureIndices(i);
+}
+
+void PTMaterial::setTextureIndex(uint16_t bind_point, uint32_t slot)
+{
+    texture_indices[bind_point] = slot;
+    texture_indices_stale.fill(true);
+}
+
+void PTMaterial::updateTextureIndices(uint32_t frame_index)
+{
+    if (!texture_indices_stale[frame_index])
+        return;
+
+    // the shader's block may be smaller than the full set of texture slots
+    PTBuffer* buffer = texture_index_buffers[frame_index];
+    memcpy(buffer->map(), texture_indices.data(), min(sizeof(texture_indices), static_cast<size_t>(buffer->getSize())));
+    texture_indices_stale[frame_index] = false;
+}
+
+void PTMaterial::createDescriptorSets()
+{
+    // sets come from the shared allocator, so there's no limit on how many materials can exist
+    PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator();
+    for (VkDescriptorSet& descriptor_set : descriptor_sets)
+        descriptor_set = allocator->allocate(getShader()->getDescriptorSetLayout());
+
+    applySetWrites();
+}
+
+void PTMaterial::releaseDescriptorSets()
+{
+    // hand the sets back for another material using the same shader
+    if (PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator())
+    {
+        for (VkDescriptorSet descriptor_set : descriptor_sets)
+            allocator->free(getShader()->getDescriptorSetLayout(), descriptor_set);
+    }
+    descriptor_sets.fill(VK_NULL_HANDLE);
+}
+
+
+void PTMaterial::reconcileBindings()
+{
+    // called after the shader has been reloaded. keep whatever still fits the new bindings, and patch up the rest
+    map<uint16_t, PTBuffer*> old_buffers = uniform_buffers;
+    uniform_buffers.clear();
+    set<uint16_t> texture_bindings;
+
+    size_t descriptors = getShader()->getDescriptorCount();
+    for (size_t b = 0; b < descriptors; b++)
+    {
+        auto binding_info = getShader()->getDescriptorBinding(b);
+        if (binding_info.bind_point == TEXTURE_INDEX_BINDING
+            || binding_info.bind_point == SCENE_UNIFORM_BINDING)
+            continue;
+
+        if (binding_info.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        {
+            auto it = old_buffers.find(binding_info.bind_point);
+            if (it != old_buffers.end() && it->second->getSize() >= binding_info.size)
+            {
+                // existing buffer is still big enough, keep it (and its contents)
+                uniform_buffers[binding_info.bind_point] = it->second;
+                old_buffers.erase(it);
+                continue;
+            }
+
+            // otherwise make a new one, carrying over as much of the old contents as fits
+            PTBuffer* buffer = PTResourceManager::get()->createBuffer(binding_info.size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            memset(buffer->map(), 0, binding_info.size);
+            if (it != old_buffers.end())
+                memcpy(buffer->map(), it->second->map(), it->second->getSize());
+            uniform_buffers[binding_info.bind_point] = buffer;
+            addDependency(buffer, false);
+        }
+        else if (binding_info.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+        {
+            texture_bindings.insert(binding_info.bind_point);
+            if (!textures.contains(binding_info.bind_point) || textures[binding_info.bind_point].first == nullptr)
+                setTexture(binding_info.bind_point, nullptr);
+        }
+    }
+
+    // buffers for bindings which no longer exist
+    for (auto pair : old_buffers)
+        removeDependency(pair.second);
+
+    // bindless slots don't show up in reflection, so the index block is what matters for those
+    if (!hasTextureIndexBuffer())
+        createTextureIndexBuffer();
+
+    // same for textures. bindless ones survive as long as nothing else has taken over their slot
+    for (auto it = textures.begin(); it != textures.end();)
+    {
+        bool keep_bindless = texture_slots.contains(it->first) && !uniform_buffers.contains(it->first);
+        if (texture_bindings.contains(it->first) || keep_bindless)
+        {
+            it++;
+            continue;
+        }
+        releaseTexture(it->first);
+        it = textures.erase(it);
+    }
+
+    // the old sets were made from a layout which no longer exists, so they can't be recycled.
+    // the shader already told the allocator to forget about them, just make new ones
+    createDescriptorSets();
+}
\ No newline at end of file
@@ -34,6 +34,27 @@ void PTPhysicalDevice::refreshInfo(VkSurfaceKHR surface)
     vkGetPhysicalDeviceProperties(device, &properties);
     vkGetPhysicalDeviceFeatures(device, &features);
 
+    features_12 = { };
+    properties_12 = { };
+    if (properties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{ };
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features_12;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        properties_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{ };
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &properties_12;
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+
+        // these get copied around, so don't leave them pointing at the stack
+        features_12.pNext = nullptr;
+        properties_12.pNext = nullptr;
+    }
+
     // grab the list of available queue families, and make a map of what index each one occurs at
     uint32_t queue_family_count = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, nullptr);
@@ -45,8 +66,9 @@ void PTPhysicalDevice::refreshInfo(VkSurfaceKHR surface)
     {
         if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
             queue_families.insert(std::make_pair(QueueFamily::GRAPHICS, index));
-        VkBool32 present_support;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, index, surface, &present_support);
+        VkBool32 present_support = VK_FALSE;
+        if (surface != VK_NULL_HANDLE)
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, index, surface, &present_support);
         if (present_support)
             queue_families.insert(std::make_pair(QueueFamily::PRESENT, index));
         index++;
@@ -58,7 +80,11 @@ void PTPhysicalDevice::refreshInfo(VkSurfaceKHR surface)
     extensions.resize(device_extension_count);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &device_extension_count, extensions.data());
 
-    // query swapchain support
+    // query swapchain support, which there's nothing to do for without a surface (headless)
+    swapchain_formats.clear();
+    swapchain_present_modes.clear();
+    if (surface == VK_NULL_HANDLE)
+        return;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &swapchain_capabilities);
     uint32_t swapchain_format_count = 0;
     vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &swapchain_format_count, nullptr);
@@ -78,3 +104,21 @@ void PTPhysicalDevice::refreshInfo(VkSurfaceKHR surface)
         vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &swapchain_present_mode_count, swapchain_present_modes.data());
     }
 }
+
+bool PTPhysicalDevice::supportsBindlessTextures() const
+{
+    // everything needed for one big partially-filled texture array which can be written while bound
+    return features.shaderSampledImageArrayDynamicIndexing == VK_TRUE
+        && features_12.runtimeDescriptorArray == VK_TRUE
+        && features_12.descriptorBindingPartiallyBound == VK_TRUE
+        && features_12.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE;
+}
+
+bool PTPhysicalDevice::supportsFormat(VkFormat format, VkFormatFeatureFlags required_features, VkImageTiling tiling) const
+{
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(device, format, &format_properties);
+    VkFormatFeatureFlags available = (tiling == VK_IMAGE_TILING_LINEAR) ? format_properties.linearTilingFeatures : format_properties.optimalTilingFeatures;
+
+    return (available & required_features) == required_features;
+}
@@ -4,12 +4,14 @@
 #include "shader.h"
 #include "render_pass.h"
 #include "swapchain.h"
+#include "resource_manager.h"
 
 using namespace std;
 
-PTPipeline::PTPipeline(VkDevice _device, PTShader* _shader, PTRenderPass* _render_pass, PTSwapchain* _swapchain, VkBool32 _depth_write, VkBool32 _depth_test, VkCompareOp _depth_op, VkCullModeFlags _culling, VkFrontFace _winding_order, VkPolygonMode _polygon_mode, vector<VkDynamicState> _dynamic_states)
+PTPipeline::PTPipeline(VkDevice _device, VkPipelineCache _pipeline_cache, PTShader* _shader, PTRenderPass* _render_pass, PTSwapchain* _swapchain, VkBool32 _depth_write, VkBool32 _depth_test, VkCompareOp _depth_op, VkCullModeFlags _culling, VkFrontFace _winding_order, VkPolygonMode _polygon_mode, vector<VkDynamicState> _dynamic_states, bool defer_creation)
 {
     device = _device;
+    pipeline_cache = _pipeline_cache;
     
     shader = _shader;
     render_pass = _render_pass;
@@ -46,19 +48,36 @@ PTPipeline::PTPipeline(VkDevice _device, PTShader* _shader, PTRenderPass* _rende
     scissor.offset = { 0, 0 };
     scissor.extent = _swapchain->getExtent();
 
-    // create the pipeline layout
-    VkDescriptorSetLayout descriptor_set_layout = shader->getDescriptorSetLayout();
+    createLayout();
+
+    // during warm-up the resource manager builds the pipeline itself, on a worker thread
+    if (!defer_creation)
+        createPipeline();
+}
+
+void PTPipeline::createLayout()
+{
+    // create the pipeline layout, with the shared scene and texture sets followed by the shader's material set
+    array<VkDescriptorSetLayout, DESCRIPTOR_SET_COUNT> set_layouts;
+    set_layouts[SCENE_DESCRIPTOR_SET] = PTResourceManager::get()->getSceneSetLayout();
+    set_layouts[TEXTURE_DESCRIPTOR_SET] = PTResourceManager::get()->getTextureSetLayout();
+    set_layouts[MATERIAL_DESCRIPTOR_SET] = shader->getDescriptorSetLayout();
+
+    // per-object data is pushed directly, rather than going through a descriptor set
+    VkPushConstantRange push_constant_range{ };
+    push_constant_range.stageFlags = PUSH_CONSTANT_STAGES;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(TransformConstants);
+
     VkPipelineLayoutCreateInfo pipeline_layout_create_info{ };
     pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_create_info.setLayoutCount = 1;
-    pipeline_layout_create_info.pSetLayouts = &descriptor_set_layout;
-    pipeline_layout_create_info.pushConstantRangeCount = 0;
-    pipeline_layout_create_info.pPushConstantRanges = nullptr;
+    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+    pipeline_layout_create_info.pSetLayouts = set_layouts.data();
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
 
     if (vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &layout) != VK_SUCCESS)
         throw runtime_error("unable to create pipeline layout");
-
-    createPipeline();
 }
 
 void PTPipeline::createPipeline()
@@ -167,7 +186,7 @@ void PTPipeline::createPipeline()
     pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_create_info.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device, pipeline_cache, 1, &pipeline_create_info, nullptr, &pipeline) != VK_SUCCESS)
         throw runtime_error("unable to create to create graphics pipeline");
 }
 
@@ -182,6 +201,16 @@ PTPipeline::~PTPipeline()
     removeDependency(render_pass);
 }
 
+void PTPipeline::rebuild()
+{
+    // the shader has been reloaded underneath us, so both the layout and the pipeline are stale
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyPipelineLayout(device, layout, nullptr);
+
+    createLayout();
+    createPipeline();
+}
+
 void PTPipeline::setDepthParams(VkBool32 write, VkBool32 test, VkCompareOp op)
 {
     // destroy the pipeline (not the layout though)
@@ -1,40 +1,113 @@
 #include "render_graph.h"
 
 #include <set>
+#include <algorithm>
+#include <fstream>
 
 #include "material.h"
 #include "render_pass.h"
 #include "image.h"
+#include "sampler.h"
+#include "compute_pipeline.h"
 #include "swapchain.h"
 #include "resource_manager.h"
+#include "descriptor_allocator.h"
+#include "render_server.h"
+#include "deserialiser.h"
 
 using namespace std;
 
+// a way the graph can use an image, along with the layout, stages and access that needs
+struct PTRGAccess
+{
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags stages = 0;
+	VkAccessFlags access = 0;
+	bool write = false;
+	// for image states only: what the barrier which moved the image into this state waited on. another stage
+	// reading in the same layout has to wait on the same thing, since the barrier only made it visible to the first
+	VkPipelineStageFlags source_stages = 0;
+	VkAccessFlags source_access = 0;
+};
+
+static const PTRGAccess COLOUR_WRITE_ACCESS{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true };
+static const PTRGAccess DEPTH_WRITE_ACCESS{ VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true };
+static const PTRGAccess SAMPLED_ACCESS{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false };
+static const PTRGAccess COPY_SOURCE_ACCESS{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, false };
+static const PTRGAccess COMPUTE_SAMPLED_ACCESS{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false };
+static const PTRGAccess STORAGE_WRITE_ACCESS{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, true };
+
+static const VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+// move an image from whatever it was last used for to a new use, adding a barrier to the batch only if one is needed
+static void requireAccess(PTRGAccess& state, const PTRGAccess& next, PTImage* image, PTRGBarrierBatch& batch)
+{
+	// two reads in the same layout can happen in any order, once the contents are visible to both stages
+	bool shared_read = !state.write && !next.write && state.layout == next.layout;
+	if (shared_read && (state.stages & next.stages) == next.stages)
+		return;
+
+	VkImageMemoryBarrier image_barrier{ };
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.image = image->getImage();
+	// attachments are always cleared or discarded, so there's no point preserving what was there before
+	image_barrier.oldLayout = next.write ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+	image_barrier.newLayout = next.layout;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.subresourceRange.aspectMask = (image->getFormat() == DEPTH_FORMAT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.baseArrayLayer = 0;
+	image_barrier.subresourceRange.layerCount = 1;
+	// only writes need making available. after a read, the next access just has to wait for it to finish
+	image_barrier.srcAccessMask = state.write ? (state.access & WRITE_ACCESS_MASK) : 0;
+	image_barrier.dstAccessMask = next.access;
+	VkPipelineStageFlags src_stages = (state.stages == 0) ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : state.stages;
+
+	if (shared_read)
+	{
+		// a new stage reading what's already there. it waits on whatever the first reader waited on, and the
+		// image stays readable by both
+		image_barrier.srcAccessMask = state.source_access;
+		src_stages = (state.source_stages == 0) ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : state.source_stages;
+		state.stages |= next.stages;
+		state.access |= next.access;
+	}
+	else
+	{
+		state = next;
+		state.source_stages = src_stages;
+		state.source_access = image_barrier.srcAccessMask;
+	}
+
+	batch.image_barriers.push_back(image_barrier);
+	batch.src_stages |= src_stages;
+	batch.dst_stages |= next.stages;
+}
+
+// resources a step needs kept alive for as long as it's in the timeline
+static vector<PTResource*> getStepResources(const PTRGStep& step)
+{
+	vector<PTResource*> step_resources;
+	if (step.is_camera_step)
+		return step_resources;
+	if (step.is_compute_step && step.compute_pipeline != nullptr)
+		step_resources.push_back(step.compute_pipeline);
+	else if (!step.is_compute_step && step.process_material != nullptr)
+		step_resources.push_back(step.process_material);
+	return step_resources;
+}
+
 PTRGGraph::PTRGGraph(VkDevice _device, PTSwapchain* _swapchain)
 {
 	device = _device;
 	swapchain = _swapchain;
 	addDependency(swapchain);
 
-	// construct descriptor pool for internal use
-	array<VkDescriptorPoolSize, 2> pool_sizes{ };
-	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	pool_sizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT * 256 * 16;
-	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	pool_sizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT * 256 * 16;
-
-	VkDescriptorPoolCreateInfo pool_create_info{ };
-	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	pool_create_info.maxSets = MAX_FRAMES_IN_FLIGHT * 256;
-	pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-	pool_create_info.pPoolSizes = pool_sizes.data();
-	pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-	if (vkCreateDescriptorPool(device, &pool_create_info, nullptr, &descriptor_pool) != VK_SUCCESS)
-		throw runtime_error("unable to create descriptor pool");
-
 	// create render pass and material uniform buffers
 	generateRenderPassAndUniformBuffers();
+	createSharedDescriptorSets();
 }
 
 PTRGGraph::~PTRGGraph()
@@ -46,109 +119,393 @@ void PTRGGraph::generateRenderPassAndUniformBuffers()
 {
 	PTRenderPass::Attachment colour_attachment;
 	colour_attachment.format = swapchain->getImageFormat();
-	colour_attachment.final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	PTRenderPass::Attachment normal_and_extra_attachment;
 	normal_and_extra_attachment.format = EXTRA_FORMAT;
-	normal_and_extra_attachment.final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	// this will result in a colour attachment, two basic data attachments, and a depth attachment
-	// it will also generate dependencies ensuring the images are available to shaders as input after rendering to them
-	render_pass = PTResourceManager::get()->createRenderPass({ colour_attachment, normal_and_extra_attachment, normal_and_extra_attachment }, true);
+	// layouts stay put during the render pass, the graph transitions images between steps itself
+	render_pass = PTResourceManager::get()->createRenderPass({ colour_attachment, normal_and_extra_attachment, normal_and_extra_attachment });
 	addDependency(render_pass, false);
 
-	// create shared scene and transform uniform buffers used by all steps
-	shared_transform_uniforms = PTResourceManager::get()->createBuffer(sizeof(TransformUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	addDependency(shared_transform_uniforms, false);
+	// create shared scene uniform buffers used by all steps
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		shared_scene_uniforms[i] = PTResourceManager::get()->createBuffer(sizeof(SceneUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 		addDependency(shared_scene_uniforms[i], false);
 	}
-}
-
-VkImageView PTRGGraph::prepareImage(PTImage*& target, VkFormat format, VkExtent2D extent)
-{
-	VkImageUsageFlags usage = IMAGE_USAGE;
-	if (format == DEPTH_FORMAT)
-		usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-	target = PTResourceManager::get()->createImage(extent, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	return target->createImageView((format == DEPTH_FORMAT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT);
+	// compute inputs may be read at a different size to the one they were written at, so filter them
+	compute_sampler = PTResourceManager::get()->createSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_FILTER_LINEAR, 0);
+	addDependency(compute_sampler, false);
 }
 
-void PTRGGraph::createImageBufferForBinding(int& binding, PTImage*& spare_image, VkImageView& spare_image_view, VkFormat format, VkExtent2D _extent)
+void PTRGGraph::compileSchedule()
 {
-	VkExtent2D extent = _extent;
-	if (extent.width == 0 || extent.height == 0)
-		extent = swapchain->getExtent();
-	// prepare colour buffer
-	if (binding < 0)
+	size_t step_count = timeline_steps.size();
+	// buffers are keyed by binding, and each attachment's spare image gets its own negative key. compute steps
+	// have no attachments, only the storage images they write
+	auto getOutputs = [](const PTRGStep& step) -> vector<int>
 	{
-		// initialise spare colour buffer
-		if (spare_image == nullptr)
-			spare_image_view = prepareImage(spare_image, format, extent);
-		else if (extent.width != spare_image->getSize().width || extent.height != spare_image->getSize().height)
+		if (step.is_compute_step)
 		{
-			debugLog("ERROR: render graph spare image re-used in an incorrect size. this will generate vulkan errors");
+			vector<int> outputs;
+			for (const auto& pair : step.compute_outputs)
+			{
+				if (pair.first >= 0)
+					outputs.push_back(pair.first);
+			}
+			return outputs;
+		}
+		return
+		{
+			(step.colour_buffer_binding >= 0) ? step.colour_buffer_binding : -1,
+			(step.normal_buffer_binding >= 0) ? step.normal_buffer_binding : -2,
+			(step.extra_buffer_binding >= 0) ? step.extra_buffer_binding : -3,
+			(step.depth_buffer_binding >= 0) ? step.depth_buffer_binding : -4
+		};
+	};
+
+	// work out what each step has to wait for. a read waits for the last write listed before it, and a write waits
+	// for every earlier read and write of the contents it replaces. only reads actually carry data between steps,
+	// so only those keep the step they read from alive
+	vector<set<size_t>> ordering(step_count);
+	vector<set<size_t>> producers(step_count);
+	map<int, size_t> last_writer;
+	map<int, vector<size_t>> readers;
+	vector<pair<size_t, int>> early_reads;
+	for (size_t i = 0; i < step_count; i++)
+	{
+		const PTRGStep& step = timeline_steps[i];
+		vector<int> outputs = getOutputs(step);
+		if (!step.is_camera_step)
+		{
+			for (const auto& pair : step.process_inputs)
+			{
+				// inputs which can't be linked to the material don't read anything
+				if (pair.first < 0 || find(outputs.begin(), outputs.end(), pair.first) != outputs.end())
+					continue;
+
+				auto it = last_writer.find(pair.first);
+				if (it != last_writer.end())
+				{
+					ordering[i].insert(it->second);
+					producers[i].insert(it->second);
+				}
+				else
+					early_reads.push_back({ i, pair.first });
+				readers[pair.first].push_back(i);
+			}
+		}
+
+		for (int buffer : outputs)
+		{
+			auto it = last_writer.find(buffer);
+			if (it != last_writer.end())
+				ordering[i].insert(it->second);
+			for (size_t reader : readers[buffer])
+				ordering[i].insert(reader);
+			readers[buffer].clear();
+			last_writer[buffer] = i;
 		}
 	}
+	// reading a buffer before it's written picks up last frame's contents, so whatever writes it last still has to run
+	for (const auto& pair : early_reads)
+	{
+		auto it = last_writer.find(pair.second);
+		if (it != last_writer.end())
+			producers[pair.first].insert(it->second);
+	}
+
+	// walk back from whichever step leaves the final image behind. anything not reached never makes it to the screen
+	vector<bool> live(step_count, false);
+	auto final_writer = last_writer.find((final_image_index >= 0) ? final_image_index : -1);
+	if (final_writer == last_writer.end())
+	{
+		if (step_count > 0)
+			debugLog("WARNING: no render graph step writes to the final image, so no steps will be culled");
+		live.assign(step_count, true);
+	}
 	else
 	{
-		// initialise a new colour buffer in the image buffer array or check usage
-		if (binding >= image_buffers.size())
+		vector<size_t> to_visit{ final_writer->second };
+		while (!to_visit.empty())
+		{
+			size_t i = to_visit.back();
+			to_visit.pop_back();
+			if (live[i])
+				continue;
+			live[i] = true;
+			to_visit.insert(to_visit.end(), producers[i].begin(), producers[i].end());
+		}
+	}
+
+	// the barriers each image needs are fixed by the dependencies, so any valid order gets the same number of them.
+	// what ordering can change is whether they stall: a barrier straight after the step it waits for drains the gpu,
+	// one further along has usually been satisfied already. so out of the steps which are ready, prefer one which
+	// doesn't read from the step just scheduled, otherwise keep the listed order
+	vector<size_t> waiting(step_count, 0);
+	size_t live_count = 0;
+	for (size_t i = 0; i < step_count; i++)
+	{
+		if (!live[i])
+			continue;
+		live_count++;
+		for (size_t dependency : ordering[i])
 		{
-			PTImage* tmp;
-			image_buffers.push_back({ tmp, prepareImage(tmp, format, extent) });
+			if (live[dependency])
+				waiting[i]++;
 		}
-		else if (image_buffers[binding].first->getFormat() != format)
+	}
+
+	schedule.clear();
+	vector<bool> scheduled(step_count, false);
+	size_t reordered = 0;
+	while (schedule.size() < live_count)
+	{
+		size_t chosen = SIZE_MAX;
+		for (size_t i = 0; i < step_count; i++)
 		{
-			// if texture is being reused by the wrong attachment, just replace this binding with the spare image
-			debugLog("ERROR: render graph image re-used in incorrect format. discarding second usage");
-			binding = -1;
-			if (spare_image == nullptr)
-				spare_image_view = prepareImage(spare_image, format, extent);
-			else if (extent.width != spare_image->getSize().width || extent.height != spare_image->getSize().height)
+			if (!live[i] || scheduled[i] || waiting[i] > 0)
+				continue;
+			if (chosen == SIZE_MAX)
+				chosen = i;
+			if (schedule.empty() || !producers[i].contains(schedule.back()))
 			{
-				debugLog("ERROR: render graph spare image re-used in an incorrect size. this will generate vulkan errors");
+				if (chosen != i)
+					reordered++;
+				chosen = i;
+				break;
 			}
 		}
-		else if (image_buffers[binding].first->getSize().width != extent.width || image_buffers[binding].first->getSize().height != extent.height)
+
+		scheduled[chosen] = true;
+		schedule.push_back(chosen);
+		for (size_t i = 0; i < step_count; i++)
 		{
-			debugLog("ERROR: render graph image re-used in an incorrect size. discarding second usage");
-			binding = -1;
-			if (spare_image == nullptr)
-				spare_image_view = prepareImage(spare_image, format, extent);
-			else if (extent.width != spare_image->getSize().width || extent.height != spare_image->getSize().height)
-			{
-				debugLog("ERROR: render graph spare image re-used in an incorrect size. this will generate vulkan errors");
-			}
+			if (live[i] && !scheduled[i] && ordering[i].contains(chosen))
+				waiting[i]--;
 		}
 	}
+
+	debugLog("render graph scheduled " + to_string(schedule.size()) + " of " + to_string(step_count) + " steps (" + to_string(step_count - schedule.size()) + " culled, " + to_string(reordered) + " moved forward)");
+}
+
+VkImageView PTRGGraph::prepareImage(PTImage*& target, VkFormat format, VkExtent2D extent, bool transient)
+{
+	VkImageUsageFlags usage = IMAGE_USAGE;
+	if (format == DEPTH_FORMAT)
+		usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	else if (format == COMPUTE_FORMAT)
+		usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	VkMemoryPropertyFlags memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (transient)
+	{
+		// never read outside the render pass, so on tiled gpus it can live in tile memory and never be backed at all
+		usage = ((format == DEPTH_FORMAT) ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		memory_flags |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	target = PTResourceManager::get()->createImage(extent, format, VK_IMAGE_TILING_OPTIMAL, usage, memory_flags);
+	return target->createImageView((format == DEPTH_FORMAT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+VkExtent2D PTRGGraph::getStepExtent(const PTRGStep& step) const
+{
+	return (step.custom_extent.width == 0 || step.custom_extent.height == 0) ? swapchain->getExtent() : step.custom_extent;
+}
+
+VkExtent2D PTRGGraph::getScaledExtent(VkExtent2D extent) const
+{
+	if (render_scale >= 1.0f)
+		return extent;
+	return VkExtent2D
+	{
+		max(static_cast<uint32_t>(extent.width * render_scale + 0.5f), 1u),
+		max(static_cast<uint32_t>(extent.height * render_scale + 0.5f), 1u)
+	};
+}
+
+VkExtent2D PTRGGraph::getFinalExtent() const
+{
+	VkExtent2D extent = getFinalImage()->getSize();
+	return final_image_scaled ? getScaledExtent(extent) : extent;
+}
+
+void PTRGGraph::declareImageBuffer(int& binding, VkFormat format, VkExtent2D extent, size_t step_index, vector<BufferUsage>& usages)
+{
+	if (binding < 0)
+		return;
+
+	if (binding >= usages.size())
+		usages.resize(binding + 1);
+
+	BufferUsage& usage = usages[binding];
+	if (!usage.declared)
+	{
+		usage.declared = true;
+		usage.format = format;
+		usage.extent = extent;
+	}
+	else if (usage.format != format)
+	{
+		// if texture is being reused by the wrong attachment, just replace this binding with the spare image
+		debugLog("ERROR: render graph image re-used in incorrect format. discarding second usage");
+		binding = -1;
+		return;
+	}
+	else if (usage.extent.width != extent.width || usage.extent.height != extent.height)
+	{
+		debugLog("ERROR: render graph image re-used in an incorrect size. discarding second usage");
+		binding = -1;
+		return;
+	}
+
+	usage.first_write = min(usage.first_write, step_index);
+	usage.last_use = max(usage.last_use, step_index);
+}
+
+void PTRGGraph::prepareSpareImage(int binding, PTImage*& spare_image, VkImageView& spare_image_view, VkFormat format, VkExtent2D extent, bool transient)
+{
+	if (binding >= 0)
+		return;
+
+	if (spare_image == nullptr)
+		spare_image_view = prepareImage(spare_image, format, extent, transient);
+	else if (extent.width != spare_image->getSize().width || extent.height != spare_image->getSize().height)
+	{
+		debugLog("ERROR: render graph spare image re-used in an incorrect size. this will generate vulkan errors");
+	}
 }
 
 void PTRGGraph::generateImagesAndFramebuffers()
 {
-	for (PTRGStep& step : timeline_steps)
+	// work out what every image buffer needs to be, and which steps it's in use between, before creating anything
+	vector<BufferUsage> usages;
+	for (size_t i = 0; i < schedule.size(); i++)
 	{
-		// prepare colour buffer
-		createImageBufferForBinding(step.colour_buffer_binding, spare_colour_image, spare_colour_image_view, swapchain->getImageFormat(), step.custom_extent);
+		PTRGStep& step = getScheduledStep(i);
+		VkExtent2D extent = getStepExtent(step);
+		if (step.is_compute_step)
+		{
+			for (auto& pair : step.compute_outputs)
+				declareImageBuffer(pair.first, COMPUTE_FORMAT, extent, i, usages);
+			continue;
+		}
+		declareImageBuffer(step.colour_buffer_binding, swapchain->getImageFormat(), extent, i, usages);
+		declareImageBuffer(step.depth_buffer_binding, DEPTH_FORMAT, extent, i, usages);
+		declareImageBuffer(step.normal_buffer_binding, EXTRA_FORMAT, extent, i, usages);
+		declareImageBuffer(step.extra_buffer_binding, EXTRA_FORMAT, extent, i, usages);
+	}
+	for (size_t i = 0; i < schedule.size(); i++)
+	{
+		const PTRGStep& step = getScheduledStep(i);
+		if (step.is_camera_step)
+			continue;
+		for (const auto& pair : step.process_inputs)
+		{
+			if (pair.first < 0 || pair.first >= usages.size() || !usages[pair.first].declared)
+				continue;
+			// reading a buffer before it's written picks up last frame's contents, so it has to keep its image to itself
+			BufferUsage& usage = usages[pair.first];
+			if (i < usage.first_write)
+				usage.pinned = true;
+			usage.last_use = max(usage.last_use, i);
+		}
+	}
+
+	// the final image has to survive until it's copied out after the last step
+	if (final_image_index < -1 || final_image_index >= (int)usages.size() || (final_image_index >= 0 && !usages[final_image_index].declared))
+	{
+		debugLog("WARNING: render graph final image index is out of range, the spare colour buffer will be used instead");
+		final_image_index = -1;
+	}
+	if (final_image_index >= 0)
+		usages[final_image_index].last_use = schedule.size();
+
+	// camera steps only fill part of their targets below full scale, so the copy to the screen has to know which wrote it last
+	final_image_scaled = false;
+	for (size_t i = 0; i < schedule.size(); i++)
+	{
+		const PTRGStep& step = getScheduledStep(i);
+		bool writes_final;
+		if (step.is_compute_step)
+			writes_final = any_of(step.compute_outputs.begin(), step.compute_outputs.end(), [this](const pair<int, uint16_t>& output) { return output.first >= 0 && output.first == final_image_index; });
+		else
+			writes_final = (step.colour_buffer_binding == final_image_index) || (final_image_index >= 0 && (step.depth_buffer_binding == final_image_index || step.normal_buffer_binding == final_image_index || step.extra_buffer_binding == final_image_index));
+		if (writes_final)
+			final_image_scaled = step.is_camera_step;
+	}
+
+	// hand out images in order of first use. buffers which want the same format and size, and are never in use
+	// at the same time, share an image. the barriers generated later treat them as one image, so the second
+	// buffer's writes wait for the first buffer's reads
+	vector<size_t> order;
+	for (size_t b = 0; b < usages.size(); b++)
+	{
+		if (usages[b].declared)
+			order.push_back(b);
+	}
+	stable_sort(order.begin(), order.end(), [&usages](size_t a, size_t b) { return usages[a].first_write < usages[b].first_write; });
+
+	image_buffers.assign(usages.size(), { nullptr, VK_NULL_HANDLE });
+	vector<size_t> image_last_use;
+	vector<bool> image_pinned;
+	for (size_t b : order)
+	{
+		const BufferUsage& usage = usages[b];
+		size_t chosen = physical_images.size();
+		for (size_t p = 0; p < physical_images.size() && !usage.pinned; p++)
+		{
+			PTImage* image = physical_images[p].first;
+			if (image_pinned[p] || image_last_use[p] >= usage.first_write || image->getFormat() != usage.format
+				|| image->getSize().width != usage.extent.width || image->getSize().height != usage.extent.height)
+				continue;
+			chosen = p;
+			break;
+		}
 
-		// prepare depth buffer
-		createImageBufferForBinding(step.depth_buffer_binding, spare_depth_image, spare_depth_image_view, DEPTH_FORMAT, step.custom_extent);
+		if (chosen == physical_images.size())
+		{
+			PTImage* image;
+			VkImageView view = prepareImage(image, usage.format, usage.extent);
+			physical_images.push_back({ image, view });
+			image_last_use.push_back(usage.last_use);
+			image_pinned.push_back(usage.pinned);
+		}
+		else
+			image_last_use[chosen] = usage.last_use;
 
-		// prepare normal buffer
-		createImageBufferForBinding(step.normal_buffer_binding, spare_normal_image, spare_normal_image_view, EXTRA_FORMAT, step.custom_extent);
+		image_buffers[b] = physical_images[chosen];
+	}
+	if (physical_images.size() < order.size())
+		debugLog("render graph image buffers share " + to_string(physical_images.size()) + " images between " + to_string(order.size()) + " buffers");
 
-		// prepare extra buffer
-		createImageBufferForBinding(step.extra_buffer_binding, spare_extra_image, spare_extra_image_view, EXTRA_FORMAT, step.custom_extent);
+	// spare images are never read, except the spare colour buffer when it's the final image. compute steps don't need them
+	for (size_t index : schedule)
+	{
+		const PTRGStep& step = timeline_steps[index];
+		if (step.is_compute_step)
+			continue;
+		VkExtent2D extent = getStepExtent(step);
+		prepareSpareImage(step.colour_buffer_binding, spare_colour_image, spare_colour_image_view, swapchain->getImageFormat(), extent, final_image_index != -1);
+		prepareSpareImage(step.depth_buffer_binding, spare_depth_image, spare_depth_image_view, DEPTH_FORMAT, extent, true);
+		prepareSpareImage(step.normal_buffer_binding, spare_normal_image, spare_normal_image_view, EXTRA_FORMAT, extent, true);
+		prepareSpareImage(step.extra_buffer_binding, spare_extra_image, spare_extra_image_view, EXTRA_FORMAT, extent, true);
+	}
+	// and the final image has to exist even if no step renders to the spare colour buffer
+	prepareSpareImage(final_image_index, spare_colour_image, spare_colour_image_view, swapchain->getImageFormat(), swapchain->getExtent(), false);
 
+	// culled steps never run, so they don't get a framebuffer, and neither do compute steps
+	for (size_t index : schedule)
+	{
+		PTRGStep& step = timeline_steps[index];
+		if (step.is_compute_step)
+			continue;
 		// create framebuffer using render pass and images
 		VkFramebufferCreateInfo framebuffer_create_info{ };
 		framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		framebuffer_create_info.renderPass = render_pass->getRenderPass();
 		framebuffer_create_info.attachmentCount = 4;
-		VkExtent2D extent = step.custom_extent;
-		if (extent.width == 0 || extent.height == 0)
-			extent = swapchain->getExtent();
+		VkExtent2D extent = getStepExtent(step);
 		framebuffer_create_info.width = extent.width;
 		framebuffer_create_info.height = extent.height;
 		framebuffer_create_info.layers = 1;
@@ -171,7 +528,203 @@ void PTRGGraph::generateImagesAndFramebuffers()
 	if (spare_normal_image != nullptr) addDependency(spare_normal_image, false);
 	if (spare_extra_image != nullptr) addDependency(spare_extra_image, false);
 
-	for (const auto& pair : image_buffers) addDependency(pair.first, false);
+	for (const auto& pair : physical_images) addDependency(pair.first, false);
+}
+
+size_t PTRGGraph::getTrackedIndex(int binding, size_t attachment) const
+{
+	return (binding >= 0) ? static_cast<size_t>(binding) : image_buffers.size() + attachment;
+}
+
+PTImage* PTRGGraph::getTrackedImage(size_t index) const
+{
+	if (index < image_buffers.size())
+		return image_buffers[index].first;
+
+	switch (index - image_buffers.size())
+	{
+	case 0: return spare_colour_image;
+	case 1: return spare_normal_image;
+	case 2: return spare_extra_image;
+	case 3: return spare_depth_image;
+	}
+	return nullptr;
+}
+
+bool PTRGGraph::isValidInput(const PTRGStep& step, int binding) const
+{
+	// same rules as linkTexturesToMaterial, without the complaining
+	if (binding < 0 || binding >= (int)image_buffers.size() || image_buffers[binding].first == nullptr)
+		return false;
+	if (step.is_compute_step)
+		return none_of(step.compute_outputs.begin(), step.compute_outputs.end(), [binding](const pair<int, uint16_t>& output) { return output.first == binding; });
+	return binding != step.colour_buffer_binding && binding != step.depth_buffer_binding && binding != step.normal_buffer_binding && binding != step.extra_buffer_binding;
+}
+
+void PTRGGraph::generateBarriersAndRenderPasses()
+{
+	size_t final_index = getTrackedIndex(final_image_index, 0);
+	// everything a step writes, and how. for render passes this is the four attachments in order (spares included)
+	auto getStepWrites = [this](const PTRGStep& step) -> vector<pair<size_t, PTRGAccess>>
+	{
+		if (step.is_compute_step)
+		{
+			vector<pair<size_t, PTRGAccess>> writes;
+			for (const auto& pair : step.compute_outputs)
+			{
+				if (pair.first >= 0)
+					writes.push_back({ static_cast<size_t>(pair.first), STORAGE_WRITE_ACCESS });
+			}
+			return writes;
+		}
+		return
+		{
+			{ getTrackedIndex(step.colour_buffer_binding, 0), COLOUR_WRITE_ACCESS },
+			{ getTrackedIndex(step.normal_buffer_binding, 1), COLOUR_WRITE_ACCESS },
+			{ getTrackedIndex(step.extra_buffer_binding, 2), COLOUR_WRITE_ACCESS },
+			{ getTrackedIndex(step.depth_buffer_binding, 3), DEPTH_WRITE_ACCESS }
+		};
+	};
+
+	// follow every image through the timeline. the first pass gets each one into the state it ends the frame in,
+	// which is the state it starts the next frame in, so the second pass gives the barriers for every frame after.
+	// state belongs to the image rather than the buffer, since buffers can share images
+	map<PTImage*, PTRGAccess> states;
+	for (size_t pass = 0; pass < 2; pass++)
+	{
+		for (size_t index : schedule)
+		{
+			PTRGStep& step = timeline_steps[index];
+			step.barriers = PTRGBarrierBatch{ };
+			if (!step.is_camera_step)
+			{
+				const PTRGAccess& read_access = step.is_compute_step ? COMPUTE_SAMPLED_ACCESS : SAMPLED_ACCESS;
+				for (const auto& pair : step.process_inputs)
+				{
+					if (isValidInput(step, pair.first))
+						requireAccess(states[image_buffers[pair.first].first], read_access, image_buffers[pair.first].first, step.barriers);
+				}
+			}
+
+			for (const auto& write : getStepWrites(step))
+			{
+				PTImage* image = getTrackedImage(write.first);
+				requireAccess(states[image], write.second, image, step.barriers);
+			}
+		}
+
+		final_barriers = PTRGBarrierBatch{ };
+		PTImage* final_image = getTrackedImage(final_index);
+		requireAccess(states[final_image], COPY_SOURCE_ACCESS, final_image, final_barriers);
+	}
+
+	// an attachment only needs storing if something reads it before it's next written. the search wraps round into
+	// the next frame, since a step can read a buffer before it's written to pick up last frame's contents
+	size_t step_count = schedule.size();
+	auto isReadAfter = [&](size_t step_index, size_t tracked) -> bool
+	{
+		for (size_t offset = 1; offset <= step_count; offset++)
+		{
+			size_t i = (step_index + offset) % step_count;
+			// the copy out of the final image happens between the last step and the first
+			if (i == 0 && tracked == final_index)
+				return true;
+
+			const PTRGStep& step = getScheduledStep(i);
+			if (!step.is_camera_step)
+			{
+				for (const auto& pair : step.process_inputs)
+				{
+					if (isValidInput(step, pair.first) && static_cast<size_t>(pair.first) == tracked)
+						return true;
+				}
+			}
+
+			vector<pair<size_t, PTRGAccess>> writes = getStepWrites(step);
+			if (any_of(writes.begin(), writes.end(), [tracked](const pair<size_t, PTRGAccess>& write) { return write.first == tracked; }))
+				return false;
+		}
+		return false;
+	};
+
+	size_t discarded = 0;
+	size_t attachment_count = 0;
+	size_t barrier_count = final_barriers.image_barriers.size();
+	for (size_t i = 0; i < step_count; i++)
+	{
+		PTRGStep& step = getScheduledStep(i);
+		barrier_count += step.barriers.image_barriers.size();
+		// storage writes always land in the image, there's no render pass to skip them
+		if (step.is_compute_step)
+		{
+			step.step_render_pass = nullptr;
+			continue;
+		}
+
+		vector<pair<size_t, PTRGAccess>> writes = getStepWrites(step);
+		vector<pair<VkAttachmentLoadOp, VkAttachmentStoreOp>> ops;
+		for (size_t a = 0; a < writes.size(); a++)
+		{
+			bool stored = isReadAfter(i, writes[a].first);
+			// colour outputs which nobody reads don't need clearing either, but depth always does for depth testing
+			VkAttachmentLoadOp load_op = (stored || a == 3) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			ops.push_back({ load_op, stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE });
+			if (!stored)
+				discarded++;
+		}
+		attachment_count += writes.size();
+		step.step_render_pass = getRenderPassVariant(ops);
+	}
+
+	// new images start out undefined, so move them into the layouts they're expected to start the frame in.
+	// only images which are read before being written really care, but it's one submission either way
+	PTRGBarrierBatch initial_barriers;
+	for (const auto& pair : states)
+	{
+		if (pair.second.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+			continue;
+		PTRGAccess undefined{ };
+		requireAccess(undefined, pair.second, pair.first, initial_barriers);
+	}
+	if (!initial_barriers.image_barriers.empty())
+	{
+		VkCommandBuffer command_buffer = PTRenderServer::get()->beginTransientCommands();
+		vkCmdPipelineBarrier
+		(
+			command_buffer,
+			initial_barriers.src_stages, initial_barriers.dst_stages,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(initial_barriers.image_barriers.size()), initial_barriers.image_barriers.data()
+		);
+		PTRenderServer::get()->endTransientCommands(command_buffer);
+	}
+
+	debugLog("render graph compiled with " + to_string(barrier_count) + " image barriers per frame, " + to_string(discarded) + " of " + to_string(attachment_count) + " attachments discarded");
+}
+
+PTRenderPass* PTRGGraph::getRenderPassVariant(const vector<pair<VkAttachmentLoadOp, VkAttachmentStoreOp>>& ops)
+{
+	auto it = render_pass_variants.find(ops);
+	if (it != render_pass_variants.end())
+		return it->second;
+
+	// load/store ops don't affect render pass compatibility, so pipelines built against the main pass work with all of these
+	vector<PTRenderPass::Attachment> attachments = render_pass->getAttachments();
+	for (size_t a = 0; a < attachments.size(); a++)
+	{
+		attachments[a].load_op = ops[a].first;
+		attachments[a].store_op = ops[a].second;
+	}
+	PTRenderPass::Attachment depth_attachment = render_pass->getDepthAttachment();
+	depth_attachment.load_op = ops.back().first;
+	depth_attachment.store_op = ops.back().second;
+
+	PTRenderPass* variant = PTResourceManager::get()->createRenderPass(attachments, depth_attachment);
+	addDependency(variant, false);
+	render_pass_variants[ops] = variant;
+	return variant;
 }
 
 void PTRGGraph::linkTexturesToMaterial(const PTRGStep& step)
@@ -183,7 +736,7 @@ void PTRGGraph::linkTexturesToMaterial(const PTRGStep& step)
 			debugLog("ERROR: render graph process step is using a texture as both an input and a render attachment, which is not allowed. it will be unbound");
 			continue;
 		}
-		if (pair.first >= image_buffers.size())
+		if (pair.first >= image_buffers.size() || (pair.first >= 0 && image_buffers[pair.first].first == nullptr))
 		{
 			debugLog("ERROR: render graph process step is referencing a texture which does not exist. it will be unbound");
 			continue;
@@ -197,105 +750,181 @@ void PTRGGraph::linkTexturesToMaterial(const PTRGStep& step)
 	}
 }
 
-void PTRGGraph::createMaterialDescriptorSets()
+void PTRGGraph::resolveComputeBindings()
+{
+	for (size_t index : schedule)
+	{
+		PTRGStep& step = timeline_steps[index];
+		if (step.is_camera_step || !step.is_compute_step)
+			continue;
+		step.compute_bindings.clear();
+		if (step.compute_pipeline == nullptr)
+		{
+			debugLog("ERROR: render graph compute step has no compute shader. it will be skipped");
+			continue;
+		}
+
+		auto addBinding = [&](int image_index, uint16_t slot, VkDescriptorType type, VkImageLayout layout)
+		{
+			if (!step.compute_pipeline->hasDescriptorWithBinding(slot, type))
+			{
+				debugLog("WARNING: compute shader " + step.compute_pipeline->getOriginPath() + " has no " + ((type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) ? "storage image" : "sampler") + " at binding " + to_string(slot) + ". it will be unbound");
+				return;
+			}
+			step.compute_bindings.push_back(PTRGComputeBinding{ image_index, slot, type, layout });
+		};
+
+		for (const auto& pair : step.process_inputs)
+		{
+			if (!isValidInput(step, pair.first))
+			{
+				debugLog("ERROR: render graph compute step is reading a texture which does not exist, or which it also writes to. it will be unbound");
+				continue;
+			}
+			addBinding(pair.first, pair.second, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+		for (const auto& pair : step.compute_outputs)
+		{
+			// outputs which clashed with an earlier use were already reported when the images were declared
+			if (pair.first < 0)
+				continue;
+			addBinding(pair.first, pair.second, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_IMAGE_LAYOUT_GENERAL);
+		}
+
+		if (step.compute_bindings.size() < step.compute_pipeline->getDescriptorCount())
+			debugLog("WARNING: render graph compute step leaves some of the bindings in " + step.compute_pipeline->getOriginPath() + " empty, which is undefined behaviour if the shader uses them");
+	}
+}
+
+VkDescriptorSet PTRGGraph::writeComputeDescriptorSet(const PTRGStep& step, uint32_t frame_index) const
+{
+	VkDescriptorSet descriptor_set = PTResourceManager::get()->getDescriptorAllocator()->allocateTransient(step.compute_pipeline->getDescriptorSetLayout(), frame_index);
+
+	// the infos have to stay put until the writes are applied, so reserve up front
+	vector<VkDescriptorImageInfo> image_infos;
+	image_infos.reserve(step.compute_bindings.size());
+	vector<VkWriteDescriptorSet> write_sets;
+	for (const PTRGComputeBinding& binding : step.compute_bindings)
+	{
+		VkDescriptorImageInfo image_info{ };
+		image_info.sampler = (binding.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) ? compute_sampler->getSampler() : VK_NULL_HANDLE;
+		image_info.imageView = image_buffers[binding.image_index].second;
+		image_info.imageLayout = binding.layout;
+		image_infos.push_back(image_info);
+
+		VkWriteDescriptorSet write_set{ };
+		write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_set.dstSet = descriptor_set;
+		write_set.dstBinding = binding.binding;
+		write_set.dstArrayElement = 0;
+		write_set.descriptorCount = 1;
+		write_set.descriptorType = binding.type;
+		write_set.pImageInfo = &image_infos.back();
+		write_sets.push_back(write_set);
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(write_sets.size()), write_sets.data(), 0, nullptr);
+	return descriptor_set;
+}
+
+void PTRGGraph::createSharedDescriptorSets()
+{
+	// materials own their own sets, so all the graph needs is one scene set per frame
+	PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator();
+	for (VkDescriptorSet& descriptor_set : scene_descriptor_sets)
+		descriptor_set = allocator->allocate(PTResourceManager::get()->getSceneSetLayout());
+
+	// hook the descriptor sets up to the scene uniform buffers
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorBufferInfo scene_buffer_info{ };
+		scene_buffer_info.buffer = shared_scene_uniforms[i]->getBuffer();
+		scene_buffer_info.offset = 0;
+		scene_buffer_info.range = sizeof(SceneUniforms);
+
+		VkWriteDescriptorSet write_set{ };
+		write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_set.dstSet = scene_descriptor_sets[i];
+		write_set.dstBinding = SCENE_UNIFORM_BINDING;
+		write_set.dstArrayElement = 0;
+		write_set.descriptorCount = 1;
+		write_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		write_set.pBufferInfo = &scene_buffer_info;
+
+		vkUpdateDescriptorSets(device, 1, &write_set, 0, nullptr);
+	}
+}
+
+void PTRGGraph::linkAllTexturesToMaterials()
 {
 	std::set<PTMaterial*> materials_set;
-	for (PTRGStep& step : timeline_steps)
+	for (size_t index : schedule)
 	{
-		if (step.is_camera_step)
+		const PTRGStep& step = timeline_steps[index];
+		if (step.is_camera_step || step.is_compute_step)
 			continue;
 
 		if (materials_set.contains(step.process_material))
 			debugLog("WARNING: material asset used in multiple render graph steps. this will cause undefined behaviour for all but the last instance");
 		materials_set.insert(step.process_material);
 
-		// link material texture slots to image buffers
+		// link material texture slots to image buffers, then push them into the material's sets
 		linkTexturesToMaterial(step);
-
-		// allocate descriptor sets for the material
-		std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
-		layouts.fill(step.process_material->getShader()->getDescriptorSetLayout());
-		VkDescriptorSetAllocateInfo set_allocation_info{ };
-		set_allocation_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		set_allocation_info.descriptorPool = descriptor_pool;
-		set_allocation_info.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-		set_allocation_info.pSetLayouts = layouts.data();
-
-		if (vkAllocateDescriptorSets(device, &set_allocation_info, step.descriptor_sets.data()) != VK_SUCCESS)
-			throw runtime_error("unable to allocate descriptor sets");
-
-		// hook the descriptor sets up to the transform, scene, and material uniform buffers
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-		{
-			VkDescriptorBufferInfo transform_buffer_info{ };
-			transform_buffer_info.buffer = shared_transform_uniforms->getBuffer();
-			transform_buffer_info.offset = 0;
-			transform_buffer_info.range = sizeof(TransformUniforms);
-
-			VkDescriptorBufferInfo scene_buffer_info{ };
-			scene_buffer_info.buffer = shared_scene_uniforms[i]->getBuffer();
-			scene_buffer_info.offset = 0;
-			scene_buffer_info.range = sizeof(SceneUniforms);
-
-			VkWriteDescriptorSet write_set{ };
-			write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write_set.dstSet = step.descriptor_sets[i];
-			write_set.dstBinding = TRANSFORM_UNIFORM_BINDING;
-			write_set.dstArrayElement = 0;
-			write_set.descriptorCount = 1;
-			write_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			write_set.pBufferInfo = &transform_buffer_info;
-
-			VkWriteDescriptorSet write_set2{ };
-			write_set2.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write_set2.dstSet = step.descriptor_sets[i];
-			write_set2.dstBinding = SCENE_UNIFORM_BINDING;
-			write_set2.dstArrayElement = 0;
-			write_set2.descriptorCount = 1;
-			write_set2.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			write_set2.pBufferInfo = &scene_buffer_info;
-
-			std::array<VkWriteDescriptorSet, 2> write_sets = { write_set, write_set2 };
-
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(write_sets.size()), write_sets.data(), 0, nullptr);
-			step.process_material->applySetWrites(step.descriptor_sets[i]);
-		}
+		step.process_material->applySetWrites();
 	}
 }
 
 void PTRGGraph::discardAllResources()
 {
 	// release uniform buffers
-	removeDependency(shared_transform_uniforms);
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		removeDependency(shared_scene_uniforms[i]);
 
 	// destroy images and views
 	destroyImages();
 
-	// kill render pass
+	// let go of the step materials while the render pass they were built against is still around
+	for (const PTRGStep& step : timeline_steps)
+	{
+		for (PTResource* resource : getStepResources(step))
+			removeDependency(resource);
+	}
+	timeline_steps.clear();
+	schedule.clear();
+	removeDependency(compute_sampler);
+
+	// kill render passes
+	for (auto pair : render_pass_variants)
+		removeDependency(pair.second);
+	render_pass_variants.clear();
 	removeDependency(render_pass);
 
-	// destroy descriptors and pool
-	vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+	// give the scene sets back
+	if (PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator())
+	{
+		for (VkDescriptorSet descriptor_set : scene_descriptor_sets)
+			allocator->free(PTResourceManager::get()->getSceneSetLayout(), descriptor_set);
+	}
 	removeDependency(swapchain);
 }
 
 void PTRGGraph::destroyImages()
 {
-	// destroy framebuffers first
+	// destroy framebuffers first. compute sets are transient, so there's nothing to give back for those
 	for (PTRGStep& step : timeline_steps)
 	{
 		vkDestroyFramebuffer(device, step.framebuffer, nullptr);
 		step.framebuffer = VK_NULL_HANDLE;
+		step.compute_bindings.clear();
 	}
 
-	// destroy image views and images in the array
-	for (auto pair : image_buffers)
+	// destroy image views and images backing the array. buffers may share these, so only go through them once
+	for (auto pair : physical_images)
 	{
 		vkDestroyImageView(device, pair.second, nullptr);
 		removeDependency(pair.first);
 	}
+	physical_images.clear();
 	image_buffers.clear();
 
 	// destroy spare image views and images
@@ -325,15 +954,21 @@ void PTRGGraph::destroyImages()
 	}
 }
 
-PTRGStepInfo PTRGGraph::getStepInfo(size_t step_index) const
+PTRGStepInfo PTRGGraph::getStepInfo(size_t step_index, uint32_t frame_index) const
 {
-	PTRGStep step = timeline_steps[step_index];
+	const PTRGStep& step = getScheduledStep(step_index);
 
 	PTRGStepInfo step_info{ };
 	// assign info necessary for starting a render pass
-	step_info.render_pass = render_pass;
+	step_info.render_pass = step.step_render_pass;
 	step_info.framebuffer = step.framebuffer;
-	step_info.extent = (step.custom_extent.width == 0 || step.custom_extent.height == 0) ? swapchain->getExtent() : step.custom_extent;
+	step_info.barriers = &step.barriers;
+	if (step.is_compute_step && step.compute_pipeline != nullptr)
+		step_info.compute_descriptor_set = writeComputeDescriptorSet(step, frame_index);
+	// camera steps render into the corner of their (full size) targets when the scale is turned down
+	step_info.extent = getStepExtent(step);
+	if (step.is_camera_step)
+		step_info.extent = getScaledExtent(step_info.extent);
 	// assign clear values for each attachment
 	PTVector4f c_col = step.colour_clear_value;
 	PTVector4f c_nor = step.normal_clear_value;
@@ -349,50 +984,127 @@ PTRGStepInfo PTRGGraph::getStepInfo(size_t step_index) const
 
 void PTRGGraph::resize()
 {
-	// destroy the images and regenerate them
+	// destroy the images and regenerate them. the schedule gets recompiled too, since generating images can
+	// swap conflicting bindings for spare images
 	destroyImages();
+	compileSchedule();
 	generateImagesAndFramebuffers();
+	generateBarriersAndRenderPasses();
 
 	// re-hook up all the textures to the materials
-	for (size_t i = 0; i < timeline_steps.size(); i++)
+	for (size_t index : schedule)
 	{
-		PTRGStep step = timeline_steps[i];
+		const PTRGStep& step = timeline_steps[index];
 
-		if (step.is_camera_step)
+		if (step.is_camera_step || step.is_compute_step)
 			continue;
 
 		linkTexturesToMaterial(step);
-
-		for (size_t j = 0; j < MAX_FRAMES_IN_FLIGHT; j++)
-			step.process_material->applySetWrites(step.descriptor_sets[j]);
+		step.process_material->applySetWrites();
 	}
+	resolveComputeBindings();
 }
 
-void PTRGGraph::updateUniforms(const SceneUniforms& scene_uniforms, const TransformUniforms& transform_uniforms, uint32_t frame_index)
+void PTRGGraph::updateUniforms(const SceneUniforms& scene_uniforms, uint32_t frame_index)
 {
 	// update the shared buffers holding uniforms
 	memcpy(shared_scene_uniforms[frame_index]->map(), &scene_uniforms, sizeof(scene_uniforms));
-	memcpy(shared_transform_uniforms->map(), &transform_uniforms, sizeof(transform_uniforms));
 }
 
-void PTRGGraph::configure(const std::vector<PTRGStep>& steps, int final_image)
+void PTRGGraph::configure(const std::vector<PTRGStep>& steps, int final_image, const PTResolutionSettings& resolution)
 {
 	// destroy images
 	destroyImages();
 
-	// copy configuration into internal array
+	// hold onto the new steps' materials and compute shaders before letting go of the old ones, in case they share any
+	for (const PTRGStep& step : steps)
+	{
+		for (PTResource* resource : getStepResources(step))
+			addDependency(resource);
+	}
+	for (const PTRGStep& step : timeline_steps)
+	{
+		for (PTResource* resource : getStepResources(step))
+			removeDependency(resource);
+	}
+
+	// copy configuration into internal array. a new graph starts at the top of its resolution range
 	final_image_index = final_image;
+	resolution_settings = resolution;
+	render_scale = resolution.enabled ? clamp(resolution.max_scale, 0.05f, 1.0f) : 1.0f;
 	timeline_steps.clear();
 	for (const PTRGStep& step : steps)
 		timeline_steps.push_back(step);
 
-	// generate images and descriptors
+	// work out what actually needs to run, then generate images and descriptors for it
+	compileSchedule();
 	generateImagesAndFramebuffers();
-	createMaterialDescriptorSets();
+	generateBarriersAndRenderPasses();
+	linkAllTexturesToMaterials();
+	resolveComputeBindings();
+}
+
+bool PTRGGraph::configure(const std::string& graph_path)
+{
+	ifstream file(graph_path, ios::ate);
+	if (!file.is_open())
+	{
+		debugLog("ERROR: render graph file " + graph_path + " not found");
+		return false;
+	}
+
+	size_t size = file.tellg();
+	string text;
+	text.resize(size, ' ');
+	file.seekg(0);
+	file.read(text.data(), size);
+	file.close();
+
+	// remember the file even if it doesn't parse, so that fixing it gets picked up by hot reloading
+	source_path = graph_path;
+	error_code err;
+	source_write_time = filesystem::last_write_time(graph_path, err);
 
-	if (final_image < -1 || final_image >= image_buffers.size())
+	vector<PTRGStep> steps;
+	int final_image = -1;
+	PTResolutionSettings resolution;
+	vector<PTResource*> loaded_resources;
+	bool loaded = true;
+	try
 	{
-		final_image = -1;
-		createImageBufferForBinding(final_image, spare_colour_image, spare_colour_image_view, swapchain->getImageFormat(), swapchain->getExtent());
+		PTDeserialiser::deserialiseRenderGraph(text, steps, final_image, resolution, loaded_resources);
 	}
+	catch (runtime_error& e)
+	{
+		debugLog("ERROR: unable to parse render graph " + graph_path + ", keeping the current configuration: " + e.what());
+		loaded = false;
+	}
+
+	if (loaded)
+	{
+		configure(steps, final_image, resolution);
+		debugLog("render graph configured from " + graph_path);
+	}
+
+	// the graph holds onto whatever its steps use, so the loader's references can go
+	for (PTResource* resource : loaded_resources)
+		resource->removeReferencer();
+
+	return loaded;
+}
+
+bool PTRGGraph::hasSourceChanged()
+{
+	if (source_path.empty())
+		return false;
+
+	// this gets asked every frame, so don't go to the filesystem every time
+	auto now = chrono::steady_clock::now();
+	if (now - last_source_check < chrono::milliseconds(250))
+		return false;
+	last_source_check = now;
+
+	error_code err;
+	filesystem::file_time_type write_time = filesystem::last_write_time(source_path, err);
+	return !err && write_time != source_write_time;
 }
@@ -4,10 +4,11 @@
 
 using namespace std;
 
-PTRenderPass::PTRenderPass(VkDevice _device, vector<Attachment> _attachments, bool transition_to_readable)
+PTRenderPass::PTRenderPass(VkDevice _device, vector<Attachment> _attachments, Attachment _depth_attachment)
 {
     device = _device;
     attachments = _attachments;
+    depth_attachment = _depth_attachment;
 
     if (attachments.size() == 0)
         throw runtime_error("cannot create render pass with no colour attachment!");
@@ -23,8 +24,8 @@ PTRenderPass::PTRenderPass(VkDevice _device, vector<Attachment> _attachments, bo
         VkAttachmentDescription attachment{ };
         attachment.format = attachment_info.format;
         attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.loadOp = attachment_info.load_op;
+        attachment.storeOp = attachment_info.store_op;
         attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         attachment.initialLayout = attachment_info.initial_layout;
@@ -41,22 +42,22 @@ PTRenderPass::PTRenderPass(VkDevice _device, vector<Attachment> _attachments, bo
     }
 
     // create an additional attachment for the depth buffer
-    VkAttachmentDescription depth_attachment{ };
-    depth_attachment.format = VK_FORMAT_D32_SFLOAT;
-    depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_attachment.storeOp = transition_to_readable ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depth_attachment.finalLayout = transition_to_readable ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    VkAttachmentDescription depth_attachment_description{ };
+    depth_attachment_description.format = depth_attachment.format;
+    depth_attachment_description.samples = VK_SAMPLE_COUNT_1_BIT;
+    depth_attachment_description.loadOp = depth_attachment.load_op;
+    depth_attachment_description.storeOp = depth_attachment.store_op;
+    depth_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment_description.initialLayout = depth_attachment.initial_layout;
+    depth_attachment_description.finalLayout = depth_attachment.final_layout;
 
     // here index is always one greater than the last location requested
     VkAttachmentReference depth_attachment_ref{ };
     depth_attachment_ref.attachment = index;
     depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-    colour_attachments.push_back(depth_attachment);
+    colour_attachments.push_back(depth_attachment_description);
 
     // create a subpass description, referencing the colour attachments and the depth attachment
     VkSubpassDescription subpass{ };
@@ -65,45 +66,32 @@ PTRenderPass::PTRenderPass(VkDevice _device, vector<Attachment> _attachments, bo
     subpass.pColorAttachments = colour_attachment_refs.data();
     subpass.pDepthStencilAttachment = &depth_attachment_ref;
 
-    // create dependencies for the subpass
-    vector<VkSubpassDependency> dependencies;
-    VkSubpassDependency dependency{ };
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = VK_ACCESS_NONE_KHR;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-    dependencies.push_back(dependency);
-
-    if (transition_to_readable)
-    {
-        VkSubpassDependency dependency2{ };
-        dependency2.srcSubpass = 0;
-        dependency2.dstSubpass = VK_SUBPASS_EXTERNAL;
-        dependency2.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency2.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        dependency2.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-        dependency2.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-        dependency2.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-        dependencies.push_back(dependency2);
-    }
+    // no subpass dependencies here. render passes are only recorded by the render graph, which works
+    // out exactly which barriers are needed between steps and records them itself
 
-    // create a render pass referencing all of the attachments (colour and depth), the subpass and dependency
+    // create a render pass referencing all of the attachments (colour and depth) and the subpass
     VkRenderPassCreateInfo render_pass_create_info{ };
     render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     render_pass_create_info.attachmentCount = static_cast<uint32_t>(colour_attachments.size());
     render_pass_create_info.pAttachments = colour_attachments.data();
     render_pass_create_info.subpassCount = 1;
     render_pass_create_info.pSubpasses = &subpass;
-    render_pass_create_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
-    render_pass_create_info.pDependencies = dependencies.data();
+    render_pass_create_info.dependencyCount = 0;
+    render_pass_create_info.pDependencies = nullptr;
 
     if (vkCreateRenderPass(device, &render_pass_create_info, nullptr, &render_pass) != VK_SUCCESS)
         throw runtime_error("unable to create render pass");
 }
 
+PTRenderPass::Attachment PTRenderPass::defaultDepthAttachment()
+{
+    Attachment attachment;
+    attachment.format = VK_FORMAT_D32_SFLOAT;
+    attachment.initial_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    attachment.final_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    return attachment;
+}
+
 PTRenderPass::~PTRenderPass()
 {
     vkDestroyRenderPass(device, render_pass, nullptr);
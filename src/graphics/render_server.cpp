@@ -8,11 +8,13 @@
 #include <set>
 #include <algorithm>
 #include <cstdlib>
+#include <format>
 
 #include "application.h"
 #include "node.h"
 #include "shader.h"
 #include "pipeline.h"
+#include "compute_pipeline.h"
 #include "swapchain.h"
 #include "buffer.h"
 #include "render_pass.h"
@@ -21,15 +23,17 @@
 #include "material.h"
 #include "debug.h"
 #include "resource_manager.h"
-#include "bitmap.h"
 #include "light_node.h"
 #include "render_graph.h"
-
-#define MAX_OBJECTS 512
+#include "texture_table.h"
+#include "descriptor_allocator.h"
+#include "gpu_profiler.h"
+#include "frame_capture.h"
+#include "profiler.h"
 
 using namespace std;
 
-#ifndef NDEBUG
+#ifdef PT_VALIDATION
 static VKAPI_ATTR VkBool32 VKAPI_CALL vulkanDebugMessengerCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
     VkDebugUtilsMessageTypeFlagsEXT message_type,
@@ -130,60 +134,7 @@ void PTRenderServer::addDrawRequest(PTNode* owner, PTMesh* mesh, PTMaterial* mat
     request.mesh = mesh;
     request.material =  (material == nullptr) ? default_material : material;
     request.transform = (target_transform == nullptr) ? owner->getTransform() : target_transform;
-
-    std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
-    layouts.fill(request.material->getShader()->getDescriptorSetLayout());
-    VkDescriptorSetAllocateInfo set_allocation_info{ };
-    set_allocation_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    set_allocation_info.descriptorPool = descriptor_pool;
-    set_allocation_info.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-    set_allocation_info.pSetLayouts = layouts.data();
-
-    if (vkAllocateDescriptorSets(device, &set_allocation_info, request.descriptor_sets.data()) != VK_SUCCESS)
-        throw runtime_error("unable to allocate descriptor sets");
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        request.descriptor_buffers[i] = PTResourceManager::get()->createBuffer(sizeof(TransformUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        {
-            VkDescriptorBufferInfo buffer_info{ };
-            buffer_info.buffer = request.descriptor_buffers[i]->getBuffer();
-            buffer_info.offset = 0;
-            buffer_info.range = sizeof(TransformUniforms);
-
-            VkWriteDescriptorSet write_set{ };
-            write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write_set.dstSet = request.descriptor_sets[i];
-            write_set.dstBinding = TRANSFORM_UNIFORM_BINDING;
-            write_set.dstArrayElement = 0;
-            write_set.descriptorCount = 1;
-            write_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            write_set.pBufferInfo = &buffer_info;
-
-            vkUpdateDescriptorSets(device, 1, &write_set, 0, nullptr);
-        }
-
-        {
-            VkDescriptorBufferInfo buffer_info{ };
-            buffer_info.buffer = scene_uniform_buffers[i]->getBuffer();
-            buffer_info.offset = 0;
-            buffer_info.range = sizeof(SceneUniforms);
-
-            VkWriteDescriptorSet write_set{ };
-            write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write_set.dstSet = request.descriptor_sets[i];
-            write_set.dstBinding = SCENE_UNIFORM_BINDING;
-            write_set.dstArrayElement = 0;
-            write_set.descriptorCount = 1;
-            write_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            write_set.pBufferInfo = &buffer_info;
-
-            vkUpdateDescriptorSets(device, 1, &write_set, 0, nullptr);
-        }
-
-        request.material->applySetWrites(request.descriptor_sets[i]);
-    }
+    request.object_id = (uint32_t)((size_t)owner);
 
     beginEditLock();
 
@@ -196,13 +147,6 @@ void PTRenderServer::removeAllDrawRequests(PTNode* owner)
 {
     beginEditLock();
 
-    for (auto[itr, range_end] = draw_queue.equal_range(owner); itr != range_end; ++itr)
-    {
-        vkFreeDescriptorSets(device, descriptor_pool, static_cast<uint32_t>(itr->second.descriptor_sets.size()), itr->second.descriptor_sets.data());
-        for (PTBuffer* buf : itr->second.descriptor_buffers)
-            buf->removeReferencer();
-    }
-
     draw_queue.erase(owner);
 
     endEditLock();
@@ -261,25 +205,30 @@ PTRenderServer::~PTRenderServer()
 void PTRenderServer::initVulkan(GLFWwindow* window, vector<const char*> glfw_extensions)
 {
     render_server = this;
+    headless = window == nullptr;
 
 	debugLog("initialising vulkan...");
 
     // initialise vulkan app instance
     vector<const char*> layers;
     auto extensions = glfw_extensions;
-#ifndef NDEBUG
+#ifdef PT_VALIDATION
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
     initVulkanInstance(layers, extensions);
 
-	debugLog("    creating window surface");
-    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
-        throw runtime_error("unable to create window surface");
+    // without a window there's no surface, and the swapchain becomes a set of offscreen images
+    if (!headless)
+    {
+        debugLog("    creating window surface");
+        if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
+            throw runtime_error("unable to create window surface");
+    }
 
     debugLog("    initialising device");
 	initDevice(layers);
 
-	PTResourceManager::get()->init(device, physical_device);
+	PTResourceManager::get()->init(device, physical_device, bindless_textures);
 
 	debugLog("    creating swapchain");
 	PTVector2u size = PTApplication::get()->getFramebufferSize();
@@ -291,8 +240,12 @@ void PTRenderServer::initVulkan(GLFWwindow* window, vector<const char*> glfw_ext
 	debugLog("    creating command pool");
 	createCommandPoolAndBuffers();
 
-	debugLog("    creating descriptor pool");
-	createDescriptorPoolAndSets();
+	debugLog("    creating scene descriptor sets");
+	createSceneDescriptorSets();
+
+	debugLog("    creating gpu profiler");
+	gpu_profiler = new PTGPUProfiler(device, physical_device, pipeline_statistics);
+    frame_capture = new PTFrameCapture(device, physical_device);
 
 	debugLog("    creating framebuffers");
 	createFramebufferAndSyncResources();
@@ -302,22 +255,9 @@ void PTRenderServer::initVulkan(GLFWwindow* window, vector<const char*> glfw_ext
     default_material = PTResourceManager::get()->createMaterial(DEFAULT_MATERIAL_PATH, swapchain, render_graph->getRenderPass(), true);
     default_shader->removeReferencer();
 
-    PTRGStep basic_step{ };
-    basic_step.is_camera_step = true;
-    basic_step.camera_slot = 0;
-    basic_step.colour_buffer_binding = 0;
-    basic_step.depth_buffer_binding = 1;
-    basic_step.normal_buffer_binding = 2;
-    basic_step.extra_buffer_binding = 3;
-    //basic_step.custom_extent = VkExtent2D{ 128, 128 };
-
-    PTRGStep pp_step{ };
-    pp_step.is_camera_step = false;
-    pp_step.colour_buffer_binding = 4;
-    pp_step.process_material = PTResourceManager::get()->createMaterial("res/pp_demo.ptmat");
-    pp_step.process_inputs = { { 0, 2 }, { 1, 3 }, { 2, 4 }, { 3, 5 } };
-
-    render_graph->configure({ basic_step, pp_step }, 4);
+    debugLog("    configuring render graph");
+    if (!render_graph->configure(DEFAULT_RENDER_GRAPH_PATH))
+        throw runtime_error("unable to load default render graph");
 
     debugLog("    loading quad");
     quad_mesh = PTResourceManager::get()->createMesh(
@@ -340,9 +280,8 @@ void PTRenderServer::update()
 {
     static uint32_t frame_index = 0;
     drawFrame(frame_index);
-
-	if (wants_screenshot)
-        takeScreenshot(frame_index);
+    applyShaderReloads();
+    applyRenderGraphReload();
 
 	frame_index = (frame_index + 1) % MAX_FRAMES_IN_FLIGHT;
 }
@@ -364,21 +303,26 @@ void PTRenderServer::deinitVulkan()
     destroyFramebufferAndSyncResources();
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        PTResourceManager::get()->getDescriptorAllocator()->free(PTResourceManager::get()->getSceneSetLayout(), scene_descriptor_sets[i]);
         scene_uniform_buffers[i]->removeReferencer();
+    }
     
+    delete gpu_profiler;
+    // finishes writing any captures still in progress
+    delete frame_capture;
+
     vkDestroyCommandPool(device, command_pool, nullptr);
 
     swapchain->removeReferencer();
 
     PTResourceManager::deinit();
 
-    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
-
     vkDestroyDevice(device, nullptr);
 
     vkDestroySurfaceKHR(instance, surface, nullptr);
 
-#ifndef NDEBUG
+#ifdef PT_VALIDATION
     destroyDebugUtilsMessenger(instance, debug_messenger);
 #endif
 
@@ -399,7 +343,7 @@ void PTRenderServer::initVulkanInstance(vector<const char*>& layers, vector<cons
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.apiVersion = VK_API_VERSION_1_3;
 
-#ifndef NDEBUG
+#ifdef PT_VALIDATION
     // get debug validation layer
     debugLog("    searching for debug validation layer...");
     uint32_t layer_count;
@@ -428,7 +372,7 @@ void PTRenderServer::initVulkanInstance(vector<const char*>& layers, vector<cons
     create_info.pApplicationInfo = &app_info;
     create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     create_info.ppEnabledExtensionNames = extensions.data();
-#ifdef NDEBUG
+#ifndef PT_VALIDATION
     create_info.enabledLayerCount = 0;
     create_info.ppEnabledLayerNames = nullptr;
 #else
@@ -449,7 +393,7 @@ void PTRenderServer::initVulkanInstance(vector<const char*>& layers, vector<cons
         throw runtime_error("unable to create VK instance");
     }
 
-#ifndef NDEBUG
+#ifdef PT_VALIDATION
     debugLog("    creating debug messenger...");
     VkDebugUtilsMessengerCreateInfoEXT debug_messenger_create_info{ };
     debug_messenger_create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -495,6 +439,32 @@ void PTRenderServer::initDevice(const std::vector<const char*>& layers)
 		features.fillModeNonSolid = VK_TRUE;
         features.samplerAnisotropy = VK_TRUE;
 
+        // bindless textures need descriptor indexing, which is core since 1.2 (it was VK_EXT_descriptor_indexing)
+        VkPhysicalDeviceVulkan12Features features_12{ };
+        features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+#ifdef PT_BINDLESS_TEXTURES
+        bindless_textures = physical_device.supportsBindlessTextures();
+        if (!bindless_textures)
+            debugLog("WARNING: device doesn't support descriptor indexing, falling back to per-material texture bindings");
+#endif
+        // statistics are only used by the gpu profiler, so go without them if they aren't there
+        pipeline_statistics = physical_device.getFeatures().pipelineStatisticsQuery;
+        features.pipelineStatisticsQuery = pipeline_statistics ? VK_TRUE : VK_FALSE;
+        if (!pipeline_statistics)
+            debugLog("WARNING: device doesn't support pipeline statistics queries, the gpu profiler will only record timings");
+        // block compressed formats are only usable if the feature is turned on. cooked textures check for it themselves
+        features.textureCompressionBC = physical_device.getFeatures().textureCompressionBC;
+        if (features.textureCompressionBC == VK_FALSE)
+            debugLog("WARNING: device doesn't support bc texture compression, cooked bc textures won't load");
+
+        if (bindless_textures)
+        {
+            features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+            features_12.runtimeDescriptorArray = VK_TRUE;
+            features_12.descriptorBindingPartiallyBound = VK_TRUE;
+            features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        }
+
 		debugLog("    creating logical device...");
 		VkDeviceCreateInfo device_create_info{ };
 		device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -503,11 +473,15 @@ void PTRenderServer::initDevice(const std::vector<const char*>& layers)
 		device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
 
 		device_create_info.pEnabledFeatures = &features;
+        if (bindless_textures)
+            device_create_info.pNext = &features_12;
 
-		debugLog("        enabling " + to_string(sizeof(required_device_extensions) / sizeof(required_device_extensions[0])) + " device extensions");
-		device_create_info.enabledExtensionCount = sizeof(required_device_extensions) / sizeof(required_device_extensions[0]);
+        // the only required extension is the swapchain, which headless doesn't use (or necessarily have)
+        uint32_t extension_count = headless ? 0 : sizeof(required_device_extensions) / sizeof(required_device_extensions[0]);
+		debugLog("        enabling " + to_string(extension_count) + " device extensions");
+		device_create_info.enabledExtensionCount = extension_count;
 		device_create_info.ppEnabledExtensionNames = required_device_extensions;
-#ifdef NDEBUG
+#ifndef PT_VALIDATION
 		device_create_info.enabledLayerCount = 0;
 #else
 		debugLog("        enabling " + to_string(layers.size()) + " layers");
@@ -556,30 +530,37 @@ void PTRenderServer::createCommandPoolAndBuffers()
         throw std::runtime_error("unable to allocate command buffers");
 }
 
-void PTRenderServer::createDescriptorPoolAndSets()
+void PTRenderServer::createSceneDescriptorSets()
 {
-	// allow enough for a lot of indiviual uniform descriptors
-	array<VkDescriptorPoolSize, 2> pool_sizes{ };
-    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_sizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT * MAX_OBJECTS * 16;
-    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    pool_sizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT * MAX_OBJECTS * 16;
-
-	// each object will have MAX_FRAMES_IN_FLIGHT descriptor sets associated probably
-    VkDescriptorPoolCreateInfo pool_create_info{ };
-    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_create_info.maxSets = MAX_FRAMES_IN_FLIGHT * MAX_OBJECTS;
-    pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-    pool_create_info.pPoolSizes = pool_sizes.data();
-    pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-	if (vkCreateDescriptorPool(device, &pool_create_info, nullptr, &descriptor_pool) != VK_SUCCESS)
-		throw runtime_error("unable to create descriptor pool");
-
+	// objects push their transforms and materials own their sets, so all that's left is one scene set per frame
 	// create a scene uniform buffer for each frame
     VkDeviceSize buffer_size = sizeof(SceneUniforms);
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         scene_uniform_buffers[i] = PTResourceManager::get()->createBuffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    // and a scene descriptor set for each frame, which is bound once and shared by every draw
+    PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator();
+    for (VkDescriptorSet& descriptor_set : scene_descriptor_sets)
+        descriptor_set = allocator->allocate(PTResourceManager::get()->getSceneSetLayout());
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        VkDescriptorBufferInfo buffer_info{ };
+        buffer_info.buffer = scene_uniform_buffers[i]->getBuffer();
+        buffer_info.offset = 0;
+        buffer_info.range = sizeof(SceneUniforms);
+
+        VkWriteDescriptorSet write_set{ };
+        write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_set.dstSet = scene_descriptor_sets[i];
+        write_set.dstBinding = SCENE_UNIFORM_BINDING;
+        write_set.dstArrayElement = 0;
+        write_set.descriptorCount = 1;
+        write_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write_set.pBufferInfo = &buffer_info;
+
+        vkUpdateDescriptorSets(device, 1, &write_set, 0, nullptr);
+    }
 }
 
 void PTRenderServer::createFramebufferAndSyncResources()
@@ -644,37 +625,22 @@ void PTRenderServer::destroyDebugUtilsMessenger(VkInstance instance, VkDebugUtil
         func(instance, debugMessenger, nullptr);
 }
 
-void PTRenderServer::updateSceneAndTransformUniforms(uint32_t frame_index)
+void PTRenderServer::updateSceneUniforms(uint32_t frame_index)
 {
-    TransformUniforms blank_transform;
-
-	{
-        // update transforms of each draw request
-        TransformUniforms uniforms;
+    PT_PROFILE_ZONE("PTRenderServer::updateSceneUniforms");
+    {
+        // update scene uniforms. per-object transforms are pushed while recording, so the camera lives here
+        SceneUniforms uniforms;
 
         PTMatrix4f world_to_view;
         PTMatrix4f view_to_clip;
         PTApplication::get()->getCameraMatrix(world_to_view, view_to_clip);
         world_to_view.getColumnMajor(uniforms.world_to_view);
-        world_to_view.getColumnMajor(blank_transform.world_to_view);
         view_to_clip.getColumnMajor(uniforms.view_to_clip);
-        view_to_clip.getColumnMajor(blank_transform.view_to_clip);
-
-        for (auto instruction : draw_queue)
-        {
-            instruction.second.transform->getLocalToWorld().getColumnMajor(uniforms.model_to_world);
-            uniforms.object_id = (uint32_t)((size_t)instruction.first);
-
-            memcpy(instruction.second.descriptor_buffers[frame_index]->map(), &uniforms, instruction.second.descriptor_buffers[frame_index]->getSize());
-        }
-    }
-
-    {
-        // update scene uniforms
-        SceneUniforms uniforms;
 
         uniforms.viewport_size = PTVector2f{ (float)swapchain->getExtent().width, (float)swapchain->getExtent().height };
         uniforms.time = PTApplication::get()->getTotalTime();
+        uniforms.render_scale = render_graph->getRenderScale();
 
         // figure out the 8 closest lights
         PTVector3f camera_position = PTApplication::get()->getCameraPosition();
@@ -699,33 +665,121 @@ void PTRenderServer::updateSceneAndTransformUniforms(uint32_t frame_index)
 
         memcpy(scene_uniform_buffers[frame_index]->map(), &uniforms, scene_uniform_buffers[frame_index]->getSize());
 
-        render_graph->updateUniforms(uniforms, blank_transform, frame_index);
+        render_graph->updateUniforms(uniforms, frame_index);
     }
 }
 
+void PTRenderServer::applyShaderReloads()
+{
+    // cheap check, the compiling itself happens on the watcher's thread
+    if (!PTResourceManager::get()->hasPendingShaderReloads())
+        return;
+
+    // we're between frames, but make sure nothing is still using the old shaders before swapping them out
+    vkDeviceWaitIdle(device);
+
+    // materials rebuild their own sets, and the scene sets don't depend on the shader, so that's all
+    PTResourceManager::get()->applyShaderReloads();
+}
+
+void PTRenderServer::applyRenderGraphReload()
+{
+    if (!render_graph->hasSourceChanged())
+        return;
+
+    // same deal as shaders, the images are about to be swapped out from under the GPU
+    vkDeviceWaitIdle(device);
+    render_graph->configure(render_graph->getSourcePath());
+    resolution_scaler.reset();
+}
+
+void PTRenderServer::setRenderGraph(std::string graph_path)
+{
+    if (graph_path == render_graph->getSourcePath())
+        return;
+
+    vkDeviceWaitIdle(device);
+    render_graph->configure(graph_path);
+    resolution_scaler.reset();
+}
+
 void PTRenderServer::updateTextureBindings()
 {
-    beginEditLock();
-    for (auto instruction : draw_queue)
+    // materials own their sets and queue themselves when a texture changes, so there's no need to
+    // go anywhere near the draw queue. frames where nothing changed don't do any work
+    PTResourceManager::get()->applyTextureUpdates();
+}
+
+void PTRenderServer::updateRenderScale()
+{
+    const PTResolutionSettings& settings = render_graph->getResolutionSettings();
+    if (!settings.enabled)
+        return;
+
+    // only the render area changes, so the new scale applies from the very next frame without recreating anything
+    float scale = resolution_scaler.update(gpu_profiler->getFrameTime(), render_graph->getRenderScale(), settings);
+    if (scale != render_graph->getRenderScale())
+        render_graph->setRenderScale(scale);
+}
+
+void PTRenderServer::updateGPUProfileView()
+{
+    // compact counts, the debug view doesn't have much room
+    auto shortCount = [](uint64_t count)
     {
-        if (instruction.second.material->getTextureUpdateFlag())
-        {
-            for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-                instruction.second.material->applySetWrites(instruction.second.descriptor_sets[i]);
-        }
+        if (count >= 10000000)
+            return format("{}M", count / 1000000);
+        if (count >= 10000)
+            return format("{}k", count / 1000);
+        return to_string(count);
+    };
+
+    vector<pair<string, string>> rows;
+    rows.push_back({ "frame", format("{:.2f}ms", gpu_profiler->getFrameTime()) });
+    for (const PTGPUProfiler::Zone& zone : gpu_profiler->getResults())
+    {
+        string value = format("{:.2f}ms", zone.gpu_ms);
+        if (zone.has_statistics)
+            value = format("{}v {}f ", shortCount(zone.vertices), shortCount(zone.fragment_invocations + zone.compute_invocations)) + value;
+        rows.push_back({ string(zone.depth * 2, ' ') + zone.name, value });
     }
-    endEditLock();
+    debugSetGPUProfile(rows);
 }
 
 void PTRenderServer::drawFrame(uint32_t frame_index)
 {
-	updateSceneAndTransformUniforms(frame_index);
+    PT_PROFILE_ZONE("PTRenderServer::drawFrame");
+
+    // the last frame drawn in this slot has finished, so its timings are in. the render scale has to be settled
+    // before the scene uniforms go out, since they carry it too
+    if (gpu_profiler->collect(frame_index))
+    {
+        updateRenderScale();
+        updateGPUProfileView();
+    }
+
+	updateSceneUniforms(frame_index);
     updateTextureBindings();
 
     vkWaitForFences(device, 1, &in_flight_fences[frame_index], VK_TRUE, UINT64_MAX);
 
-    uint32_t image_index;
-    VkResult result = vkAcquireNextImageKHR(device, swapchain->getSwapchain(), UINT64_MAX, image_available_semaphores[frame_index], VK_NULL_HANDLE, &image_index);
+    // anything captured last time this slot was drawn is in memory now, so it can go off to be written
+    frame_capture->collect(frame_index);
+
+    // nothing from this frame's last go round is still in use, so its transient sets can all go, along with any
+    // descriptor sets and bindless texture slots that were given up while it was the latest frame
+    PTResourceManager::get()->getDescriptorAllocator()->collect(frame_index);
+    if (PTTextureTable* table = PTResourceManager::get()->getTextureTable())
+        table->collect(frame_index);
+
+    // offscreen images are only used by the frame slot they belong to, so there's nothing to acquire
+    uint32_t image_index = frame_index % swapchain->getImageCount();
+    VkResult result = VK_SUCCESS;
+    if (!headless)
+    {
+        PT_PROFILE_ZONE("acquire image");
+        result = vkAcquireNextImageKHR(device, swapchain->getSwapchain(), UINT64_MAX, image_available_semaphores[frame_index], VK_NULL_HANDLE, &image_index);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
         debugLog("swapchain out of date during acquire image!");
@@ -742,13 +796,17 @@ void PTRenderServer::drawFrame(uint32_t frame_index)
         throw runtime_error("unable to acquire next swapchain image");
 
     vkResetFences(device, 1, &in_flight_fences[frame_index]);
+    uint64_t record_start = profileNow();
 
     // before we start drawing, make a list of draw requests, sorted by priority, then by material, then by mesh
     vector<DrawRequest> sorted_queue;
-    sorted_queue.reserve(draw_queue.size());
-    for (const auto& p : draw_queue)
-        sorted_queue.push_back(p.second);
-    sort(sorted_queue.begin(), sorted_queue.end(), DrawRequest::compare);
+    {
+        PT_PROFILE_ZONE("sort draw queue");
+        sorted_queue.reserve(draw_queue.size());
+        for (const auto& p : draw_queue)
+            sorted_queue.push_back(p.second);
+        sort(sorted_queue.begin(), sorted_queue.end(), DrawRequest::compare);
+    }
 
     vkResetCommandBuffer(command_buffers[frame_index], 0);
 
@@ -762,32 +820,50 @@ void PTRenderServer::drawFrame(uint32_t frame_index)
     if (vkBeginCommandBuffer(command_buffers[frame_index], &command_buffer_begin_info) != VK_SUCCESS)
         throw runtime_error("unable to begin recording command buffer");
 
-    // step through the render graph
+    gpu_profiler->beginFrame(command_buffers[frame_index], frame_index);
+
+    // step through the render graph. each step is a profiler zone, barriers included, since waiting is part of its cost
     for (size_t step_index = 0; step_index < render_graph->getStepCount(); step_index++)
     {
-        PTRGStepInfo step_info = render_graph->getStepInfo(step_index);
+        PTRGStepInfo step_info = render_graph->getStepInfo(step_index, frame_index);
+        uint32_t zone;
         if (render_graph->getStepIsCamera(step_index))
+        {
+            zone = gpu_profiler->beginZone(command_buffers[frame_index], to_string(step_index) + " camera", true);
+            generateBarrierCommands(command_buffers[frame_index], *step_info.barriers);
             generateCameraRenderStepCommands(frame_index, command_buffers[frame_index], step_info, sorted_queue);
+        }
+        else if (render_graph->getStepIsCompute(step_index))
+        {
+            zone = gpu_profiler->beginZone(command_buffers[frame_index], to_string(step_index) + " " + render_graph->getStepComputePipeline(step_index)->getOriginPath(), true);
+            generateBarrierCommands(command_buffers[frame_index], *step_info.barriers);
+            generateComputeStepCommands(frame_index, command_buffers[frame_index], step_info, render_graph->getStepComputePipeline(step_index));
+        }
         else
-            generatePostProcessRenderStepCommands(frame_index, command_buffers[frame_index], step_info, render_graph->getStepMaterial(step_index, frame_index));
+        {
+            zone = gpu_profiler->beginZone(command_buffers[frame_index], to_string(step_index) + " " + render_graph->getStepMaterial(step_index)->getOriginPath(), true);
+            generateBarrierCommands(command_buffers[frame_index], *step_info.barriers);
+            generatePostProcessRenderStepCommands(frame_index, command_buffers[frame_index], step_info, render_graph->getStepMaterial(step_index));
+        }
+        gpu_profiler->endZone(command_buffers[frame_index], zone);
     }
 
+    uint32_t final_zone = gpu_profiler->beginZone(command_buffers[frame_index], "final copy");
+
     VkImage source_image = render_graph->getFinalImage()->getImage();
     VkImage swap_image = swapchain->getImage(image_index);
 
-    // transition the swapchain and result images into copiable layouts
+    // the graph knows how the final image was last used, so it gets that one ready to copy from.
+    // the swapchain image only has to wait for the acquire semaphore, which the submit waits on at the transfer stage
+    generateBarrierCommands(command_buffers[frame_index], render_graph->getFinalBarriers());
     generateImageLayoutTransitionCommands(command_buffers[frame_index], swap_image,
         VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-
-    generateImageLayoutTransitionCommands(command_buffers[frame_index], source_image,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VK_ACCESS_NONE_KHR, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
     VkExtent2D swap_ext = swapchain->getExtent();
-    VkExtent2D source_ext = render_graph->getFinalImage()->getSize();
+    // with dynamic resolution, only part of the final image may have been drawn to
+    VkExtent2D source_ext = render_graph->getFinalExtent();
 
     VkImageSubresourceLayers src_layers{ };
     src_layers.aspectMask = (render_graph->getFinalImage()->getFormat() == DEPTH_FORMAT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
@@ -827,35 +903,59 @@ void PTRenderServer::drawFrame(uint32_t frame_index)
         vkCmdBlitImage(command_buffers[frame_index], render_graph->getFinalImage()->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchain->getImage(image_index), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit_region, VK_FILTER_LINEAR);
     }
 
+    // captures read from the final image too, while it's still ready to copy from, rather than the swapchain image
+    if (frame_capture->wantsCapture())
+    {
+        if (src_layers.aspectMask != VK_IMAGE_ASPECT_COLOR_BIT)
+        {
+            debugLog("WARNING: the final image is a depth buffer, which can't be captured");
+            frame_capture->cancel();
+        }
+        else
+            frame_capture->recordCapture(command_buffers[frame_index], frame_index, source_image, source_ext, swap_ext);
+    }
+
+    // presentation is synchronised by the semaphore, so nothing after this needs to wait on the copy
     generateImageLayoutTransitionCommands(command_buffers[frame_index], swap_image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, swapchain->getPresentLayout(),
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_NONE_KHR,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
 
-    generateImageLayoutTransitionCommands(command_buffers[frame_index], source_image,
-        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    gpu_profiler->endZone(command_buffers[frame_index], final_zone);
+    gpu_profiler->endFrame(command_buffers[frame_index]);
 
     if (vkEndCommandBuffer(command_buffers[frame_index]) != VK_SUCCESS)
         throw std::runtime_error("unable to record command buffer");
+    uint64_t submit_start = profileNow();
+    last_record_ms = (submit_start - record_start) / 1000000.0f;
 
     VkSubmitInfo submit_info{ };
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     VkSemaphore submit_wait_semaphores[] = { image_available_semaphores[frame_index] };
-    VkPipelineStageFlags submit_wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submit_info.waitSemaphoreCount = 1;
+    VkPipelineStageFlags submit_wait_stages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
+    submit_info.waitSemaphoreCount = headless ? 0 : 1;
     submit_info.pWaitSemaphores = submit_wait_semaphores;
     submit_info.pWaitDstStageMask = submit_wait_stages;
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &command_buffers[frame_index];
     VkSemaphore signal_semaphores[] = { render_finished_semaphores[image_index] };
-    submit_info.signalSemaphoreCount = 1;
+    submit_info.signalSemaphoreCount = headless ? 0 : 1;
     submit_info.pSignalSemaphores = signal_semaphores;
 
     if (vkQueueSubmit(queues[PTPhysicalDevice::QueueFamily::GRAPHICS], 1, &submit_info, in_flight_fences[frame_index]) != VK_SUCCESS)
         throw std::runtime_error("unable to submit draw command buffer");
 
+    if (headless)
+    {
+        {
+            PT_PROFILE_ZONE("wait for gpu");
+            vkWaitForFences(device, 1, &in_flight_fences[frame_index], VK_TRUE, UINT64_MAX);
+        }
+        last_submit_ms = (profileNow() - submit_start) / 1000000.0f;
+        endDrawLock();
+        return;
+    }
+
     VkPresentInfoKHR present_info{ };
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     present_info.waitSemaphoreCount = 1;
@@ -866,7 +966,10 @@ void PTRenderServer::drawFrame(uint32_t frame_index)
     present_info.pImageIndices = &image_index;
     present_info.pResults = nullptr;
 
-    result = vkQueuePresentKHR(queues[PTPhysicalDevice::QueueFamily::PRESENT], &present_info);
+    {
+        PT_PROFILE_ZONE("present");
+        result = vkQueuePresentKHR(queues[PTPhysicalDevice::QueueFamily::PRESENT], &present_info);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
         debugLog("swapchain out of date during present~");
@@ -880,7 +983,11 @@ void PTRenderServer::drawFrame(uint32_t frame_index)
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
         throw runtime_error("unable to present swapchain image");
 
-    vkWaitForFences(device, 1, &in_flight_fences[frame_index], VK_TRUE, UINT64_MAX);
+    {
+        PT_PROFILE_ZONE("wait for gpu");
+        vkWaitForFences(device, 1, &in_flight_fences[frame_index], VK_TRUE, UINT64_MAX);
+    }
+    last_submit_ms = (profileNow() - submit_start) / 1000000.0f;
     endDrawLock();
 }
 
@@ -914,13 +1021,31 @@ void PTRenderServer::generateCameraRenderStepCommands(uint32_t frame_index, VkCo
 
     PTMaterial* mat = nullptr;
     PTMesh* mesh = nullptr;
+    uint32_t batch_zone = PTGPUProfiler::NO_ZONE;
     for (auto instruction : sorted_queue)
     {
         if (instruction.material != mat)
         {
-            // for each material, bind the shader and pipeline
+            // batches only get timestamps, the step's statistics query is already running
+            if (profile_material_batches)
+            {
+                if (batch_zone != PTGPUProfiler::NO_ZONE)
+                    gpu_profiler->endZone(command_buffer, batch_zone);
+                batch_zone = gpu_profiler->beginZone(command_buffer, instruction.material->getOriginPath());
+            }
+
+            // for each material, bind the shader and pipeline, and the material descriptor set
+            VkPipelineLayout layout = instruction.material->getPipeline()->getLayout();
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instruction.material->getPipeline()->getPipeline());
+
+            // every pipeline layout agrees on the scene and texture sets, so they stay bound across pipeline changes
+            if (mat == nullptr)
+                bindSharedDescriptorSets(command_buffer, layout, scene_descriptor_sets[frame_index]);
+
             mat = instruction.material;
-            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mat->getPipeline()->getPipeline());
+            mat->updateTextureIndices(frame_index);
+            VkDescriptorSet material_set = mat->getDescriptorSet(frame_index);
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, MATERIAL_DESCRIPTOR_SET, 1, &material_set, 0, nullptr);
         }
 
         if (instruction.mesh != mesh)
@@ -937,19 +1062,33 @@ void PTRenderServer::generateCameraRenderStepCommands(uint32_t frame_index, VkCo
             vkCmdBindIndexBuffer(command_buffer, ibuf, 0, VK_INDEX_TYPE_UINT16);
         }
 
-        // for each object, bind the object-specific common descriptor set, then draw indexed
-        if (mat == nullptr)
-            continue;
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mat->getPipeline()->getLayout(), 0, 1, &(instruction.descriptor_sets[frame_index]), 0, nullptr);
-        if (mesh == nullptr)
+        // for each object, push its transform straight into the command buffer, then draw indexed
+        if (mat == nullptr || mesh == nullptr)
             continue;
+        TransformConstants constants;
+        instruction.transform->getLocalToWorld().getColumnMajor(constants.model_to_world);
+        constants.object_id = instruction.object_id;
+        vkCmdPushConstants(command_buffer, mat->getPipeline()->getLayout(), PUSH_CONSTANT_STAGES, 0, sizeof(TransformConstants), &constants);
         vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(mesh->getIndexCount()), 1, 0, 0, 0);
     }
 
+    if (batch_zone != PTGPUProfiler::NO_ZONE)
+        gpu_profiler->endZone(command_buffer, batch_zone);
+
     vkCmdEndRenderPass(command_buffer);
 }
 
-void PTRenderServer::generatePostProcessRenderStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, std::pair<PTMaterial*, VkDescriptorSet> material)
+void PTRenderServer::bindSharedDescriptorSets(VkCommandBuffer command_buffer, VkPipelineLayout layout, VkDescriptorSet scene_set, VkPipelineBindPoint bind_point)
+{
+    // the texture set only exists in bindless mode, otherwise its slot in the layout is empty and can be left unbound
+    array<VkDescriptorSet, 2> sets = { scene_set, VK_NULL_HANDLE };
+    uint32_t set_count = 1;
+    if (bindless_textures)
+        sets[set_count++] = PTResourceManager::get()->getTextureTable()->getDescriptorSet();
+    vkCmdBindDescriptorSets(command_buffer, bind_point, layout, SCENE_DESCRIPTOR_SET, set_count, sets.data(), 0, nullptr);
+}
+
+void PTRenderServer::generatePostProcessRenderStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, PTMaterial* material)
 {
     VkViewport viewport{ };
     viewport.x = 0.0f;
@@ -977,18 +1116,46 @@ void PTRenderServer::generatePostProcessRenderStepCommands(uint32_t frame_index,
 
     vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.first->getPipeline()->getPipeline());
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material->getPipeline()->getPipeline());
 
     VkBuffer vertex_buffers[] = { quad_mesh->getVertexBuffer() };
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
     vkCmdBindIndexBuffer(command_buffer, quad_mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT16);
-    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.first->getPipeline()->getLayout(), 0, 1, &(material.second), 0, nullptr);
+    // post-process steps use the render graph's own scene set, and an identity transform
+    VkPipelineLayout layout = material->getPipeline()->getLayout();
+    bindSharedDescriptorSets(command_buffer, layout, render_graph->getSceneDescriptorSet(frame_index));
+    material->updateTextureIndices(frame_index);
+    VkDescriptorSet material_set = material->getDescriptorSet(frame_index);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, MATERIAL_DESCRIPTOR_SET, 1, &material_set, 0, nullptr);
+    TransformConstants constants;
+    PTMatrix4f().getColumnMajor(constants.model_to_world);
+    constants.object_id = 0;
+    vkCmdPushConstants(command_buffer, material->getPipeline()->getLayout(), PUSH_CONSTANT_STAGES, 0, sizeof(TransformConstants), &constants);
     vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(quad_mesh->getIndexCount()), 1, 0, 0, 0);
     
     vkCmdEndRenderPass(command_buffer);
 }
 
+void PTRenderServer::generateComputeStepCommands(uint32_t frame_index, VkCommandBuffer command_buffer, PTRGStepInfo step_info, PTComputePipeline* pipeline)
+{
+    // steps the graph couldn't set up are just skipped
+    if (pipeline == nullptr || step_info.compute_descriptor_set == VK_NULL_HANDLE)
+        return;
+
+    // no render pass, no quad. the graph's barriers have already put the outputs in the general layout
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getPipeline());
+    VkPipelineLayout layout = pipeline->getLayout();
+    bindSharedDescriptorSets(command_buffer, layout, render_graph->getSceneDescriptorSet(frame_index), VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, MATERIAL_DESCRIPTOR_SET, 1, &step_info.compute_descriptor_set, 0, nullptr);
+
+    // one invocation per pixel, rounded up to whole workgroups. the shader has to ignore the ones off the edge
+    array<uint32_t, 3> workgroup_size = pipeline->getWorkgroupSize();
+    uint32_t group_count_x = (step_info.extent.width + workgroup_size[0] - 1) / workgroup_size[0];
+    uint32_t group_count_y = (step_info.extent.height + workgroup_size[1] - 1) / workgroup_size[1];
+    vkCmdDispatch(command_buffer, group_count_x, group_count_y, 1);
+}
+
 void PTRenderServer::generateImageLayoutTransitionCommands(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
 {
     VkImageMemoryBarrier image_barrier{ };
@@ -1017,6 +1184,22 @@ void PTRenderServer::generateImageLayoutTransitionCommands(VkCommandBuffer comma
     );
 }
 
+void PTRenderServer::generateBarrierCommands(VkCommandBuffer command_buffer, const PTRGBarrierBatch& barriers)
+{
+    if (barriers.image_barriers.empty())
+        return;
+
+    vkCmdPipelineBarrier
+    (
+        command_buffer,
+        barriers.src_stages, barriers.dst_stages,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(barriers.image_barriers.size()), barriers.image_barriers.data()
+    );
+}
+
 void PTRenderServer::resizeSwapchain()
 {
 	debugLog("resizing swapchain + framebuffer...");
@@ -1039,98 +1222,9 @@ void PTRenderServer::resizeSwapchain()
     debugLog("done.");
 }
 
-void PTRenderServer::takeScreenshot(uint32_t frame_index)
+void PTRenderServer::setWantsScreenshot(string path)
 {
-	VkCommandBuffer cmd = beginTransientCommands();
-
-    VkExtent2D ext = swapchain->getExtent();
-    PTImage* screenshot_img = PTResourceManager::get()->createImage(ext, 
-                                                                    VK_FORMAT_R8G8B8A8_SRGB, 
-                                                                    VK_IMAGE_TILING_OPTIMAL, 
-                                                                    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 
-                                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    screenshot_img->transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmd);
-    VkMemoryRequirements memory_requirements{ };
-    vkGetImageMemoryRequirements(device, screenshot_img->getImage(), &memory_requirements);
-    PTBuffer* host_buffer = PTResourceManager::get()->createBuffer(memory_requirements.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    VkImageSubresourceLayers src_layers{ };
-    src_layers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    src_layers.baseArrayLayer = 0;
-    src_layers.layerCount = 1;
-    src_layers.mipLevel = 0;
-
-    VkImageBlit blit_region{ };
-    blit_region.srcOffsets[0] = VkOffset3D{ 0, 0, 0 };
-    blit_region.srcOffsets[1] = VkOffset3D{ static_cast<int32_t>(ext.width), static_cast<int32_t>(ext.height), 1 };
-    blit_region.dstOffsets[0] = VkOffset3D{ 0, static_cast<int32_t>(ext.height), 0 };
-    blit_region.dstOffsets[1] = VkOffset3D{ static_cast<int32_t>(ext.width), 0, 1 };
-    blit_region.srcSubresource = src_layers;
-    blit_region.dstSubresource = src_layers;
-    
-    VkImageMemoryBarrier image_barrier{ };
-    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    image_barrier.image = swapchain->getImage(frame_index);
-    image_barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    image_barrier.subresourceRange.baseMipLevel = 0;
-    image_barrier.subresourceRange.levelCount = 1;
-    image_barrier.subresourceRange.baseArrayLayer = 0;
-    image_barrier.subresourceRange.layerCount = 1;
-    image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-    vkCmdPipelineBarrier
-    (
-        cmd,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &image_barrier
-    );
-    
-    vkCmdBlitImage(cmd, swapchain->getImage(frame_index), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, screenshot_img->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit_region, VkFilter::VK_FILTER_NEAREST);
-    
-    VkImageMemoryBarrier image_barrier_reversed = image_barrier;
-    image_barrier_reversed.oldLayout = image_barrier.newLayout;
-    image_barrier_reversed.newLayout = image_barrier.oldLayout;
-    image_barrier_reversed.srcAccessMask = image_barrier.dstAccessMask;
-    image_barrier_reversed.dstAccessMask = image_barrier.srcAccessMask;
-    
-    vkCmdPipelineBarrier
-    (
-        cmd,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &image_barrier_reversed
-    );
-
-    VkBufferImageCopy copy_region{ };
-    copy_region.imageOffset = VkOffset3D{ 0, 0, 0 };
-    copy_region.imageExtent = VkExtent3D{ ext.width, ext.height, 1 };
-    copy_region.imageSubresource = src_layers;
-    copy_region.bufferOffset = 0;
-    copy_region.bufferRowLength = ext.width;
-    copy_region.bufferImageHeight = ext.height;
-
-    screenshot_img->transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cmd);
-
-    vkCmdCopyImageToBuffer(cmd, screenshot_img->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, host_buffer->getBuffer(), 1, &copy_region);
-
-    endTransientCommands(cmd);
-
-    screenshot_img->removeReferencer();
-
-    writeRGBABitmap("screenshot.bmp", (char*)(host_buffer->map()), ext.width, ext.height);
-
-    host_buffer->removeReferencer();
-    wants_screenshot = false;
+    frame_capture->requestScreenshot(path);
 }
 
 PTPhysicalDevice PTRenderServer::selectPhysicalDevice()
@@ -1163,31 +1257,36 @@ int PTRenderServer::evaluatePhysicalDevice(PTPhysicalDevice d)
     // this device is unsuitable if it doesn't have all the queues we want
     if (!d.hasQueueFamily(PTPhysicalDevice::QueueFamily::GRAPHICS))
         return 0;
-    if (!d.hasQueueFamily(PTPhysicalDevice::QueueFamily::PRESENT))
-        return 0;
 
-    // if any required extensions are absent, the device is unsuitable
-    for (const char* extension_name : required_device_extensions)
+    // headless never presents, so presenting and the swapchain only matter with a window
+    if (!headless)
     {
-        bool found = false;
-        for (VkExtensionProperties& prop : d.getExtensions())
+        if (!d.hasQueueFamily(PTPhysicalDevice::QueueFamily::PRESENT))
+            return 0;
+
+        // if any required extensions are absent, the device is unsuitable
+        for (const char* extension_name : required_device_extensions)
         {
-            if (strcmp(prop.extensionName, extension_name) == 0)
+            bool found = false;
+            for (VkExtensionProperties& prop : d.getExtensions())
             {
-                found = true;
-                break;
+                if (strcmp(prop.extensionName, extension_name) == 0)
+                {
+                    found = true;
+                    break;
+                }
             }
+            if (!found)
+                return 0;
         }
-        if (!found)
+
+        // query swapchain support
+        if (d.getSwapchainFormats().size() == 0)
+            return 0;
+        if (d.getSwapchainPresentModes().size() == 0)
             return 0;
     }
 
-    // query swapchain support
-    if (d.getSwapchainFormats().size() == 0)
-        return 0;
-    if (d.getSwapchainPresentModes().size() == 0)
-        return 0;
-
     // award points for being a good boy
     auto device_properties = d.getProperties();
     auto device_features = d.getFeatures();
@@ -0,0 +1,54 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// frames to wait after a change before changing again, so the smoothed time catches up with the new scale
+static const uint32_t SETTLE_FRAMES = 8;
+// weight of each new sample in the smoothed frame time
+static const float SMOOTHING = 0.1f;
+// only scale up once frames come in this far under budget, so a scene sitting right at the target stays put
+static const float HEADROOM = 0.85f;
+// largest change in scale per step. going down is urgent (frames are being missed), going up isn't
+static const float MAX_DECREASE = 0.1f;
+static const float MAX_INCREASE = 0.05f;
+// changes smaller than this aren't worth it
+static const float MIN_CHANGE = 0.01f;
+
+float PTResolutionScaler::update(float gpu_ms, float current_scale, const PTResolutionSettings& settings)
+{
+    float min_scale = clamp(settings.min_scale, 0.05f, 1.0f);
+    float max_scale = clamp(settings.max_scale, min_scale, 1.0f);
+    if (!settings.enabled)
+        return max_scale;
+
+    smoothed_ms = (smoothed_ms <= 0.0f) ? gpu_ms : ((smoothed_ms * (1.0f - SMOOTHING)) + (gpu_ms * SMOOTHING));
+    frames_since_change++;
+    if (frames_since_change < SETTLE_FRAMES || smoothed_ms <= 0.0f)
+        return clamp(current_scale, min_scale, max_scale);
+
+    float next_scale = current_scale;
+    if (smoothed_ms > settings.target_ms)
+        next_scale = max(current_scale * sqrt(settings.target_ms / smoothed_ms), current_scale - MAX_DECREASE);
+    else if (smoothed_ms < settings.target_ms * HEADROOM)
+        next_scale = min(current_scale * sqrt((settings.target_ms * HEADROOM) / smoothed_ms), current_scale + MAX_INCREASE);
+    next_scale = clamp(next_scale, min_scale, max_scale);
+
+    // small changes are still worth making if they land exactly on a bound, otherwise it could stop just short
+    bool at_bound = (next_scale == min_scale || next_scale == max_scale);
+    if (next_scale == current_scale || (fabs(next_scale - current_scale) < MIN_CHANGE && !at_bound))
+        return current_scale;
+
+    // assume the change does what it should, rather than waiting for the average to drift there
+    smoothed_ms *= (next_scale * next_scale) / (current_scale * current_scale);
+    frames_since_change = 0;
+    return next_scale;
+}
+
+void PTResolutionScaler::reset()
+{
+    smoothed_ms = 0.0f;
+    frames_since_change = 0;
+}
\ No newline at end of file
@@ -1,28 +1,87 @@
 #include "resource_manager.h"
 
 #include <fstream>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <filesystem>
+#include <functional>
+#include <exception>
 
 #include "debug.h"
+#include "profiler.h"
 #include "scene.h"
 #include "buffer.h"
 #include "image.h"
 #include "pipeline.h"
+#include "compute_pipeline.h"
 #include "shader.h"
 #include "swapchain.h"
 #include "render_server.h"
 #include "sampler.h"
 #include "render_graph.h"
+#include "shader_watcher.h"
+#include "texture_table.h"
+#include "descriptor_allocator.h"
 
 using namespace std;
 
 static PTResourceManager* resource_manager = nullptr;
 
-void PTResourceManager::init(VkDevice _device, PTPhysicalDevice& _physical_device)
+static bool readFileText(const string& path, string& text)
+{
+    ifstream file(path, ios::ate);
+    if (!file.is_open())
+        return false;
+
+    size_t size = file.tellg();
+    text.resize(size, ' ');
+    file.seekg(0);
+    file.read(text.data(), size);
+    return true;
+}
+
+static void runParallel(size_t job_count, function<void(size_t)> job)
+{
+    // hand out job indices to a pool of workers until we run out
+    size_t worker_count = min((size_t)max(thread::hardware_concurrency(), 1u), job_count);
+    atomic<size_t> next_job = 0;
+    vector<thread> workers;
+    // an exception escaping a thread terminates the program, so each worker stops at its first one and it's
+    // rethrown here once they've all finished
+    vector<exception_ptr> errors(worker_count);
+    for (size_t w = 0; w < worker_count; w++)
+    {
+        workers.push_back(thread([&, w]()
+        {
+            try
+            {
+                size_t index;
+                while ((index = next_job++) < job_count)
+                    job(index);
+            }
+            catch (...)
+            {
+                errors[w] = current_exception();
+            }
+        }));
+    }
+
+    for (thread& worker : workers)
+        worker.join();
+    for (exception_ptr& error : errors)
+        if (error)
+            rethrow_exception(error);
+}
+
+void PTResourceManager::init(VkDevice _device, PTPhysicalDevice& _physical_device, bool bindless_textures)
 {
     if (resource_manager != nullptr)
         return;
     
-    resource_manager = new PTResourceManager(_device, _physical_device);
+    resource_manager = new PTResourceManager(_device, _physical_device, bindless_textures);
 }
 
 void PTResourceManager::deinit()
@@ -39,6 +98,14 @@ PTResourceManager* PTResourceManager::get()
     return resource_manager;
 }
 
+PTResourceManager::PTResourceManager(VkDevice _device, PTPhysicalDevice& _physical_device, bool bindless_textures) : device(_device), physical_device(_physical_device)
+{
+    loadPipelineCache();
+    createCommonSetLayouts(bindless_textures);
+    descriptor_allocator = new PTDescriptorAllocator(device);
+    shader_watcher = new PTShaderWatcher();
+}
+
 PTBuffer* PTResourceManager::createBuffer(VkDeviceSize buffer_size, VkBufferUsageFlags usage_flags, VkMemoryPropertyFlags memory_flags)
 {
     PTBuffer* buf = new PTBuffer(device, physical_device, buffer_size, usage_flags, memory_flags);
@@ -65,6 +132,7 @@ PTImage* PTResourceManager::createImage(VkExtent2D size, VkFormat _format, VkIma
 
 PTImage* PTResourceManager::createImage(std::string texture_file, bool force_duplicate)
 {
+    PT_PROFILE_ZONE("PTResourceManager::createImage");
     string identifier = "image-" + texture_file;
     PTImage* img = nullptr;
 
@@ -80,6 +148,7 @@ PTImage* PTResourceManager::createImage(std::string texture_file, bool force_dup
 
 PTMesh* PTResourceManager::createMesh(std::string file_name, bool force_duplicate)
 {
+    PT_PROFILE_ZONE("PTResourceManager::createMesh");
     string identifier = "mesh-" + file_name;
     PTMesh* me = nullptr;
 
@@ -105,21 +174,48 @@ PTMesh* PTResourceManager::createMesh(std::vector<PTVertex> vertices, std::vecto
     return me;
 }
 
-PTPipeline* PTResourceManager::createPipeline(PTShader* shader, PTRenderPass* render_pass, PTSwapchain* swapchain, VkBool32 depth_write, VkBool32 depth_test, VkCompareOp depth_op, VkCullModeFlags culling, VkFrontFace winding_order, VkPolygonMode polygon_mode, std::vector<VkDynamicState> dynamic_states)
+PTPipeline* PTResourceManager::createPipeline(PTShader* shader, PTRenderPass* render_pass, PTSwapchain* swapchain, VkBool32 depth_write, VkBool32 depth_test, VkCompareOp depth_op, VkCullModeFlags culling, VkFrontFace winding_order, VkPolygonMode polygon_mode, std::vector<VkDynamicState> dynamic_states, bool force_duplicate)
 {
-    PTPipeline* pipe = new PTPipeline(device, shader, render_pass, swapchain, depth_write, depth_test, depth_op, culling, winding_order, polygon_mode, dynamic_states);
-    string identifier = "pipeline-" + to_string((size_t)pipe);
-    
-    resources.emplace(identifier, pipe);
+    PT_PROFILE_ZONE("PTResourceManager::createPipeline");
+    // the swapchain is only used for the (dynamic) viewport, so it doesn't form part of the identifier
+    string identifier = "pipeline-" + to_string((size_t)shader) + '-' + to_string((size_t)render_pass) + '-' + to_string(depth_write) + '-' + to_string(depth_test) + '-' + to_string(depth_op) + '-' + to_string(culling) + '-' + to_string(winding_order) + '-' + to_string(polygon_mode);
+    for (VkDynamicState state : dynamic_states)
+        identifier += '-' + to_string(state);
+    PTPipeline* pipe = nullptr;
+
+    if (!force_duplicate)
+        pipe = tryGetExistingResource<PTPipeline>(identifier);
+    if (pipe == nullptr)
+    {
+        resources.emplace(identifier, pipe = new PTPipeline(device, pipeline_cache, shader, render_pass, swapchain, depth_write, depth_test, depth_op, culling, winding_order, polygon_mode, dynamic_states, deferring_pipelines));
+        if (deferring_pipelines)
+            deferred_pipelines.push_back(pipe);
+    }
+
+    pipe->addReferencer();
+
+    return pipe;
+}
+
+PTComputePipeline* PTResourceManager::createComputePipeline(std::string shader_path_stub, bool force_duplicate)
+{
+    PT_PROFILE_ZONE("PTResourceManager::createComputePipeline");
+    string identifier = "computepipeline-" + shader_path_stub;
+    PTComputePipeline* pipe = nullptr;
+
+    if (!force_duplicate)
+        pipe = tryGetExistingResource<PTComputePipeline>(identifier);
+    if (pipe == nullptr)
+        resources.emplace(identifier, pipe = new PTComputePipeline(device, pipeline_cache, shader_path_stub));
 
     pipe->addReferencer();
 
     return pipe;
 }
 
-PTRenderPass* PTResourceManager::createRenderPass(std::vector<PTRenderPass::Attachment> attachments, bool transition_to_readable)
+PTRenderPass* PTResourceManager::createRenderPass(std::vector<PTRenderPass::Attachment> attachments, PTRenderPass::Attachment depth_attachment)
 {
-    PTRenderPass* rp = new PTRenderPass(device, attachments, transition_to_readable);
+    PTRenderPass* rp = new PTRenderPass(device, attachments, depth_attachment);
     string identifier = "renderpass-" + to_string((size_t)rp);
     
     resources.emplace(identifier, rp);
@@ -131,13 +227,18 @@ PTRenderPass* PTResourceManager::createRenderPass(std::vector<PTRenderPass::Atta
 
 PTShader* PTResourceManager::createShader(std::string shader_path_stub, bool is_precompiled, bool has_geometry_shader, bool force_duplicate)
 {
+    PT_PROFILE_ZONE("PTResourceManager::createShader");
     string identifier = "shader-" + shader_path_stub;
     PTShader* sh = nullptr;
 
     if (!force_duplicate)
         sh = tryGetExistingResource<PTShader>(identifier);
     if (sh == nullptr)
+    {
         resources.emplace(identifier, sh = new PTShader(device, shader_path_stub, is_precompiled, has_geometry_shader));
+        if (!is_precompiled)
+            shader_watcher->watch(shader_path_stub, has_geometry_shader);
+    }
 
     sh->addReferencer();
 
@@ -158,6 +259,7 @@ PTSwapchain* PTResourceManager::createSwapchain(VkSurfaceKHR surface, int window
 
 PTMaterial* PTResourceManager::createMaterial(std::string material_path, PTSwapchain* swapchain, PTRenderPass* render_pass, bool force_duplicate)
 {
+    PT_PROFILE_ZONE("PTResourceManager::createMaterial");
     string identifier = "material-" + material_path;
     PTMaterial* mt = nullptr;
 
@@ -210,6 +312,7 @@ PTRGGraph* PTResourceManager::createRenderGraph(PTSwapchain* swapchain)
 
 PTScene* PTResourceManager::createScene(string file_name, bool force_duplicate)
 {
+    PT_PROFILE_ZONE("PTResourceManager::createScene");
     string identifier = "scene-" + file_name;
     PTScene* scene = nullptr;
 
@@ -276,14 +379,367 @@ PTResource* PTResourceManager::createGeneric(string type, vector<PTDeserialiser:
         
         return createMaterial(args[0].s_val);
     }
+    else if (type == "compute")
+    {
+        if (args.size() < 1)
+            return nullptr;
+        if (args[0].type != PTDeserialiser::ArgType::STRING_ARG)
+            return nullptr;
+
+        return createComputePipeline(args[0].s_val);
+    }
 
     return nullptr;
 }
 
+void PTResourceManager::warmUp(vector<string> material_paths)
+{
+    PT_PROFILE_ZONE("PTResourceManager::warmUp");
+    debugLog("warming up " + to_string(material_paths.size()) + " materials...");
+    auto stage_start = chrono::high_resolution_clock::now();
+    auto endStage = [&stage_start](string stage, size_t count)
+    {
+        auto now = chrono::high_resolution_clock::now();
+        float ms = chrono::duration<float, milli>(now - stage_start).count();
+        debugLog("    " + stage + ": " + to_string(count) + " in " + to_string(ms) + "ms");
+        stage_start = now;
+    };
+
+    // find every shader the materials use, without loading anything yet
+    set<string> shader_stubs = { DEFAULT_SHADER_PATH };
+    for (string path : material_paths)
+    {
+        string text;
+        if (!readFileText(path, text))
+            continue;
+        try
+        {
+            for (auto descriptor : PTDeserialiser::findResourceDescriptors(text))
+                if (descriptor.first == "shader")
+                    shader_stubs.insert(descriptor.second);
+        }
+        catch (runtime_error& e)
+        {
+            debugLog("WARNING: unable to parse material " + path + " for warm-up: " + e.what());
+        }
+    }
+    vector<string> pending_stubs;
+    for (string stub : shader_stubs)
+        if (tryGetExistingResource<PTShader>("shader-" + stub) == nullptr)
+            pending_stubs.push_back(stub);
+
+    // compile, reflect and create modules for all of them at once. shaders don't touch the resource map so this is safe
+    vector<PTShader*> shaders(pending_stubs.size(), nullptr);
+    runParallel(pending_stubs.size(), [&](size_t i)
+    {
+        // the same flags the shader descriptor in a material creates it with, or the material would get a different
+        // shader to the one warmed up
+        try { shaders[i] = new PTShader(device, pending_stubs[i], false, false); }
+        catch (exception& e) { debugLog("WARNING: failed to warm up shader " + pending_stubs[i] + ": " + e.what()); }
+    });
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        if (shaders[i] == nullptr)
+            continue;
+        resources.emplace("shader-" + pending_stubs[i], shaders[i]);
+        shader_watcher->watch(pending_stubs[i], false);
+        shaders[i]->addReferencer();
+        warm_resources.push_back(shaders[i]);
+    }
+    endStage("shaders", shaders.size());
+
+    // materials are built serially since they mutate the resource map, but their pipelines are only recorded, not compiled
+    deferring_pipelines = true;
+    for (string path : material_paths)
+    {
+        try { warm_resources.push_back(createMaterial(path)); }
+        catch (runtime_error& e) { debugLog("WARNING: failed to warm up material " + path + ": " + e.what()); }
+    }
+    deferring_pipelines = false;
+    endStage("materials", material_paths.size());
+
+    // now compile every new pipeline in parallel, sharing the pipeline cache (which is internally synchronised)
+    vector<PTPipeline*> pipelines = deferred_pipelines;
+    deferred_pipelines.clear();
+    atomic<bool> pipeline_failed = false;
+    runParallel(pipelines.size(), [&](size_t i)
+    {
+        try { pipelines[i]->createPipeline(); }
+        catch (exception& e) { pipeline_failed = true; }
+    });
+    if (pipeline_failed)
+        throw runtime_error("unable to create graphics pipeline during warm-up");
+    endStage("pipelines", pipelines.size());
+
+    debugLog("done.");
+}
+
+void PTResourceManager::warmUpScene(string scene_path)
+{
+    string text;
+    if (!readFileText(scene_path, text))
+        return;
+
+    // every material the scene names directly...
+    vector<string> material_paths;
+    try
+    {
+        for (auto descriptor : PTDeserialiser::findResourceDescriptors(text))
+            if (descriptor.first == "material")
+                material_paths.push_back(descriptor.second);
+    }
+    catch (runtime_error& e)
+    {
+        debugLog("WARNING: unable to parse scene " + scene_path + " for warm-up: " + e.what());
+    }
+
+    // ...plus the engine materials which nodes pull in by themselves
+    error_code err;
+    for (auto& entry : filesystem::directory_iterator(filesystem::path(DEFAULT_MATERIAL_PATH).parent_path(), err))
+        if (entry.path().extension() == ".ptmat")
+            material_paths.push_back(entry.path().generic_string());
+
+    warmUp(material_paths);
+}
+
+void PTResourceManager::releaseWarmUp()
+{
+    // anything still needed has been referenced by something else by now
+    vector<PTResource*> held = warm_resources;
+    warm_resources.clear();
+    for (PTResource* res : held)
+        res->removeReferencer();
+}
+
+bool PTResourceManager::hasPendingShaderReloads() const
+{
+    return shader_watcher->hasResults();
+}
+
+set<PTShader*> PTResourceManager::applyShaderReloads()
+{
+    // the caller must make sure the device is idle, since we're about to pull the rug out from under the GPU
+    set<PTShader*> reloaded;
+    for (PTShaderWatcher::Result& result : shader_watcher->takeResults())
+    {
+        // there may be several copies of the same shader (e.g. the default shader)
+        auto range = resources.equal_range("shader-" + result.shader_path_stub);
+        for (auto it = range.first; it != range.second; it++)
+        {
+            PTShader* shader = (PTShader*)(it->second);
+            if (shader->reload(result.has_geometry_shader, result.vertex_code, result.fragment_code, result.geometry_code))
+                reloaded.insert(shader);
+        }
+    }
+
+    if (reloaded.empty())
+        return reloaded;
+
+    // rebuild every pipeline and material which was built on top of the old shaders
+    size_t pipeline_count = 0;
+    size_t material_count = 0;
+    for (auto pair : resources)
+    {
+        if (PTPipeline* pipeline = dynamic_cast<PTPipeline*>(pair.second))
+        {
+            if (reloaded.contains(pipeline->getShader()))
+            {
+                pipeline->rebuild();
+                pipeline_count++;
+            }
+        }
+        else if (PTMaterial* material = dynamic_cast<PTMaterial*>(pair.second))
+        {
+            if (reloaded.contains(material->getShader()))
+            {
+                material->reconcileBindings();
+                material_count++;
+            }
+        }
+    }
+
+    debugLog("hot reloaded " + to_string(reloaded.size()) + " shaders (" + to_string(pipeline_count) + " pipelines, " + to_string(material_count) + " materials)");
+
+    return reloaded;
+}
+
+void PTResourceManager::queueTextureUpdate(PTMaterial* material)
+{
+    pending_texture_updates.insert(material);
+}
+
+void PTResourceManager::cancelTextureUpdate(PTMaterial* material)
+{
+    pending_texture_updates.erase(material);
+}
+
+size_t PTResourceManager::applyTextureUpdates()
+{
+    // only materials which actually changed get rewritten, so most frames this does nothing at all
+    size_t written = 0;
+    for (PTMaterial* material : pending_texture_updates)
+    {
+        // it may already have been written directly (e.g. by the render graph) since it was queued
+        if (!material->hasPendingTextureUpdate())
+            continue;
+        material->applySetWrites();
+        written++;
+    }
+    pending_texture_updates.clear();
+
+    return written;
+}
+
+void PTResourceManager::loadPipelineCache()
+{
+    vector<char> cache_data;
+
+    // read whatever the last run left behind, if anything
+    ifstream file(PIPELINE_CACHE_PATH, ios::ate | ios::binary);
+    if (file.is_open())
+    {
+        size_t size = file.tellg();
+        cache_data.resize(size);
+        file.seekg(0);
+        file.read(cache_data.data(), size);
+        file.close();
+    }
+
+    // only hand the data to the driver if it was written by this exact device, otherwise start fresh
+    if (!cache_data.empty())
+    {
+        VkPhysicalDeviceProperties properties = physical_device.getProperties();
+        VkPipelineCacheHeaderVersionOne header{ };
+        bool valid = cache_data.size() >= sizeof(VkPipelineCacheHeaderVersionOne);
+        if (valid)
+        {
+            memcpy(&header, cache_data.data(), sizeof(VkPipelineCacheHeaderVersionOne));
+            valid = header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne)
+                && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                && header.vendorID == properties.vendorID
+                && header.deviceID == properties.deviceID
+                && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+        if (valid)
+            debugLog("loaded pipeline cache (" + to_string(cache_data.size()) + " bytes)");
+        else
+        {
+            debugLog("WARNING: pipeline cache was created by a different device or driver, discarding");
+            cache_data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_create_info{ };
+    cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_create_info.initialDataSize = cache_data.size();
+    cache_create_info.pInitialData = cache_data.empty() ? nullptr : cache_data.data();
+
+    if (vkCreatePipelineCache(device, &cache_create_info, nullptr, &pipeline_cache) != VK_SUCCESS)
+    {
+        debugLog("WARNING: unable to create pipeline cache, pipelines will be compiled from scratch");
+        pipeline_cache = VK_NULL_HANDLE;
+    }
+}
+
+void PTResourceManager::savePipelineCache()
+{
+    if (pipeline_cache == VK_NULL_HANDLE)
+        return;
+
+    size_t size = 0;
+    vector<char> cache_data;
+    if (vkGetPipelineCacheData(device, pipeline_cache, &size, nullptr) == VK_SUCCESS && size > 0)
+    {
+        cache_data.resize(size);
+        if (vkGetPipelineCacheData(device, pipeline_cache, &size, cache_data.data()) != VK_SUCCESS)
+            cache_data.clear();
+    }
+
+    if (!cache_data.empty())
+    {
+        ofstream file(PIPELINE_CACHE_PATH, ios::binary);
+        if (file.is_open())
+        {
+            file.write(cache_data.data(), size);
+            file.close();
+            debugLog("saved pipeline cache (" + to_string(size) + " bytes)");
+        }
+        else
+            debugLog("WARNING: unable to write pipeline cache to " + string(PIPELINE_CACHE_PATH));
+    }
+
+    vkDestroyPipelineCache(device, pipeline_cache, nullptr);
+    pipeline_cache = VK_NULL_HANDLE;
+}
+
+void PTResourceManager::createCommonSetLayouts(bool bindless_textures)
+{
+    scene_set_layout = createUniformSetLayout(SCENE_UNIFORM_BINDING);
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{ };
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = 0;
+    if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &empty_set_layout) != VK_SUCCESS)
+        throw runtime_error("unable to create descriptor set layout");
+
+    if (bindless_textures)
+    {
+        // the array has to fit in every stage at once, since the layout is visible to all of them
+        VkPhysicalDeviceVulkan12Properties limits = physical_device.getProperties12();
+        uint32_t capacity = min(MAX_BINDLESS_TEXTURES, limits.maxDescriptorSetUpdateAfterBindSampledImages);
+        capacity = min(capacity, limits.maxPerStageDescriptorUpdateAfterBindSampledImages);
+        texture_table = new PTTextureTable(device, capacity);
+    }
+}
+
+VkDescriptorSetLayout PTResourceManager::getTextureSetLayout() const
+{
+    return texture_table != nullptr ? texture_table->getLayout() : empty_set_layout;
+}
+
+VkDescriptorSetLayout PTResourceManager::createUniformSetLayout(uint16_t binding)
+{
+    // these can't take their stage flags from reflection, since every pipeline layout has to agree on them.
+    // compute is included so render graph compute steps can read the scene uniforms too
+    VkDescriptorSetLayoutBinding layout_binding{ };
+    layout_binding.binding = binding;
+    layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    layout_binding.descriptorCount = 1;
+    layout_binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{ };
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = 1;
+    layout_create_info.pBindings = &layout_binding;
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &layout) != VK_SUCCESS)
+        throw runtime_error("unable to create descriptor set layout");
+
+    return layout;
+}
+
 PTResourceManager::~PTResourceManager()
 {
     debugLog("shutting down resource manager.");
 
+    delete shader_watcher;
+    shader_watcher = nullptr;
+
+    // materials give their slots back when they die, so by now this should only be holding leaks
+    delete texture_table;
+    texture_table = nullptr;
+
+    // same goes for descriptor sets. anything left over is freed along with the pools
+    delete descriptor_allocator;
+    descriptor_allocator = nullptr;
+
+    savePipelineCache();
+
+    // pipeline layouts and descriptor sets made from this don't need it to stick around
+    vkDestroyDescriptorSetLayout(device, scene_set_layout, nullptr);
+    vkDestroyDescriptorSetLayout(device, empty_set_layout, nullptr);
+
     if (resources.empty())
     {
         debugLog("well done for cleaning up!");
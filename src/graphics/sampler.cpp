@@ -11,6 +11,7 @@ PTSampler::PTSampler(VkDevice _device, VkSamplerAddressMode _address_mode, VkFil
     min_filter = _min_filter;
     mag_filter = _mag_filter;
     max_anisotropy = _max_anisotropy;
+    mipmap_mode = (min_filter == VK_FILTER_NEAREST) ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
     createSampler();
 }
@@ -35,10 +36,11 @@ void PTSampler::createSampler()
     sampler_info.unnormalizedCoordinates = VK_FALSE;
     sampler_info.compareEnable = VK_FALSE;
     sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.mipmapMode = mipmap_mode;
     sampler_info.mipLodBias = 0.0f;
     sampler_info.minLod = 0.0f;
-    sampler_info.maxLod = 0.0f;
+    // the image view decides how many levels there actually are
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(device, &sampler_info, nullptr, &sampler) != VK_SUCCESS)
         throw runtime_error("unable to create texture sampler");
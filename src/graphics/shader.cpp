@@ -2,11 +2,147 @@
 
 #include "constant.h"
 #include <fstream>
+#include <filesystem>
+#include <set>
+#include <mutex>
+#include <thread>
+#ifdef PT_USE_SHADERC
+#include <shaderc/shaderc.h>
+#endif
 
 #include "spirv_reflect.h"
+#include "resource_manager.h"
+#include "descriptor_allocator.h"
 
 using namespace std;
 
+#ifdef PT_USE_SHADERC
+static const char* SHADER_COMPILER_NAME = "shaderc";
+#else
+static const char* SHADER_COMPILER_NAME = "glslc";
+#endif
+
+static bool readTextFile(const string& path, string& text)
+{
+    ifstream file(path, ios::ate | ios::binary);
+    if (!file.is_open())
+        return false;
+
+    size_t size = file.tellg();
+    text.resize(size);
+    file.seekg(0);
+    file.read(text.data(), size);
+    return true;
+}
+
+static bool readBinaryFile(const string& path, vector<char>& data)
+{
+    ifstream file(path, ios::ate | ios::binary);
+    if (!file.is_open())
+        return false;
+
+    size_t size = file.tellg();
+    data.clear();
+    data.resize(size);
+    file.seekg(0);
+    file.read(data.data(), size);
+    return size > 0;
+}
+
+static string resolveIncludePath(const string& requesting_path, const string& include_name)
+{
+    // includes are resolved relative to the file doing the including, same as glslc
+    size_t slash = requesting_path.find_last_of("/\\");
+    if (slash == string::npos)
+        return include_name;
+    return requesting_path.substr(0, slash + 1) + include_name;
+}
+
+static uint64_t hashShaderSource(const string& data)
+{
+    // FNV-1a. not cryptographic, it just needs to tell source revisions apart
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool PTShader::collectShaderSource(const string& path, string& out, set<string>& visited, size_t depth)
+{
+    if (depth > 16 || visited.contains(path))
+        return true;
+    visited.insert(path);
+
+    string text;
+    if (!readTextFile(path, text))
+        return depth > 0; // a missing include is left for the compiler to report
+
+    out += path + '\0' + text + '\0';
+
+    // follow every `#include "..."` line
+    size_t offset = 0;
+    while ((offset = text.find("#include", offset)) != string::npos)
+    {
+        size_t line_end = text.find('\n', offset);
+        size_t open_quote = text.find('"', offset);
+        offset += 8;
+        if (open_quote == string::npos || open_quote > line_end)
+            continue;
+        size_t close_quote = text.find('"', open_quote + 1);
+        if (close_quote == string::npos || close_quote > line_end)
+            continue;
+
+        collectShaderSource(resolveIncludePath(path, text.substr(open_quote + 1, close_quote - open_quote - 1)), out, visited, depth + 1);
+    }
+
+    return true;
+}
+
+#ifdef PT_USE_SHADERC
+static shaderc_compiler_t getShaderCompiler()
+{
+    // a single compiler instance is shared by everybody; compiling with it is thread-safe
+    static shaderc_compiler_t compiler = nullptr;
+    static once_flag compiler_init;
+    call_once(compiler_init, []() { compiler = shaderc_compiler_initialize(); });
+    return compiler;
+}
+
+struct ShaderIncludeData
+{
+    string path;
+    string content;
+};
+
+static shaderc_include_result* resolveShaderInclude(void* user_data, const char* requested_source, int type, const char* requesting_source, size_t include_depth)
+{
+    ShaderIncludeData* data = new ShaderIncludeData();
+    data->path = resolveIncludePath(requesting_source, requested_source);
+    shaderc_include_result* result = new shaderc_include_result();
+    if (!readTextFile(data->path, data->content))
+    {
+        // shaderc expects an empty source name and the error message in content on failure
+        data->content = "unable to open include file " + data->path;
+        data->path = "";
+    }
+    result->source_name = data->path.c_str();
+    result->source_name_length = data->path.size();
+    result->content = data->content.c_str();
+    result->content_length = data->content.size();
+    result->user_data = data;
+    return result;
+}
+
+static void releaseShaderInclude(void* user_data, shaderc_include_result* include_result)
+{
+    delete (ShaderIncludeData*)(include_result->user_data);
+    delete include_result;
+}
+#endif
+
 PTShader::PTShader(VkDevice _device, const string shader_path_stub, bool is_precompiled, bool has_geometry_shader)
 {
     origin_path = shader_path_stub;
@@ -22,7 +158,7 @@ PTShader::PTShader(VkDevice _device, const string shader_path_stub, bool is_prec
         {
             debugLog("ERROR: failed to load precompiled shader " + shader_path_stub);
             geom_shader_present = false;
-            if (!readRawAndCompile(DEFAULT_SHADER_PATH, vert, frag, geom))
+            if (!readRawAndCompile(DEFAULT_SHADER_PATH, false, vert, frag, geom))
                 throw runtime_error("failed to load default shader");
             else
                 createShaderModules(vert, frag, geom);
@@ -30,25 +166,90 @@ PTShader::PTShader(VkDevice _device, const string shader_path_stub, bool is_prec
     }
     else
     {
-        if (readRawAndCompile(shader_path_stub, vert, frag, geom))
+        if (readRawAndCompile(shader_path_stub, geom_shader_present, vert, frag, geom))
             createShaderModules(vert, frag, geom);
         else
         {
             debugLog("ERROR: failed to compile shader " + shader_path_stub);
             geom_shader_present = false;
-            if (!readRawAndCompile(DEFAULT_SHADER_PATH, vert, frag, geom))
+            if (!readRawAndCompile(DEFAULT_SHADER_PATH, false, vert, frag, geom))
                 throw runtime_error("failed to load default shader");
             else
                 createShaderModules(vert, frag, geom);
         }
     }
 
-    // these bindings should always be binding 0 and 1, and should always be present
-    descriptor_bindings.push_back(BindingInfo{ "TransformUniforms", TRANSFORM_UNIFORM_BINDING, sizeof(TransformUniforms), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER });
-    descriptor_bindings.push_back(BindingInfo{ "SceneUniforms", SCENE_UNIFORM_BINDING, sizeof(SceneUniforms), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER });
+    // the scene binding lives in its own set which is shared between all shaders (see PTResourceManager),
+    // and the transform is a push constant, so the layout here only covers the material set
     createDescriptorSetLayout();
 }
 
+bool PTShader::reload(bool has_geometry_shader, const vector<char>& vertex_code, const vector<char>& fragment_code, vector<char>& geometry_code)
+{
+    // hang on to the old modules and layout until the new ones have been built, so a bad edit leaves the shader as it was
+    VkShaderModule old_vertex_shader = vertex_shader;
+    VkShaderModule old_fragment_shader = fragment_shader;
+    VkShaderModule old_geometry_shader = geometry_shader;
+    VkDescriptorSetLayout old_descriptor_set_layout = descriptor_set_layout;
+    vector<BindingInfo> old_descriptor_bindings = move(descriptor_bindings);
+    bool old_geom_shader_present = geom_shader_present;
+
+    vertex_shader = VK_NULL_HANDLE;
+    fragment_shader = VK_NULL_HANDLE;
+    geometry_shader = VK_NULL_HANDLE;
+    descriptor_set_layout = VK_NULL_HANDLE;
+    descriptor_bindings.clear();
+
+    // rebuild everything from the new code, exactly as the constructor does
+    geom_shader_present = has_geometry_shader;
+    try
+    {
+        createShaderModules(vertex_code, fragment_code, geometry_code);
+        createDescriptorSetLayout();
+    }
+    catch (runtime_error& e)
+    {
+        // destroying null handles is allowed, so whatever got partway through can just be thrown away
+        vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+        vkDestroyShaderModule(device, vertex_shader, nullptr);
+        vkDestroyShaderModule(device, fragment_shader, nullptr);
+        vkDestroyShaderModule(device, geometry_shader, nullptr);
+
+        vertex_shader = old_vertex_shader;
+        fragment_shader = old_fragment_shader;
+        geometry_shader = old_geometry_shader;
+        descriptor_set_layout = old_descriptor_set_layout;
+        descriptor_bindings = move(old_descriptor_bindings);
+        geom_shader_present = old_geom_shader_present;
+
+        debugLog("WARNING: unable to reload shader " + origin_path + ", keeping the old one: " + e.what());
+        return false;
+    }
+
+    // now the old ones can go, the device must be idle when this happens
+    if (PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator())
+        allocator->forgetLayout(old_descriptor_set_layout);
+    vkDestroyDescriptorSetLayout(device, old_descriptor_set_layout, nullptr);
+    vkDestroyShaderModule(device, old_vertex_shader, nullptr);
+    vkDestroyShaderModule(device, old_fragment_shader, nullptr);
+    if (old_geom_shader_present)
+        vkDestroyShaderModule(device, old_geometry_shader, nullptr);
+
+    return true;
+}
+
+set<string> PTShader::getSourceFiles(string shader_path_stub, bool has_geometry_shader)
+{
+    // every file which contributes to any stage of the shader, including headers
+    set<string> visited;
+    string unused;
+    collectShaderSource(shader_path_stub + ".vert", unused, visited, 0);
+    collectShaderSource(shader_path_stub + ".frag", unused, visited, 0);
+    if (has_geometry_shader)
+        collectShaderSource(shader_path_stub + ".geom", unused, visited, 0);
+    return visited;
+}
+
 vector<VkPipelineShaderStageCreateInfo> PTShader::getStageCreateInfo() const
 {
     vector<VkPipelineShaderStageCreateInfo> infos;
@@ -88,6 +289,8 @@ vector<VkPipelineShaderStageCreateInfo> PTShader::getStageCreateInfo() const
 PTShader::~PTShader()
 {
     // destroy the layout and the blobs
+    if (PTDescriptorAllocator* allocator = PTResourceManager::get()->getDescriptorAllocator())
+        allocator->forgetLayout(descriptor_set_layout);
     vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
     vkDestroyShaderModule(device, vertex_shader, nullptr);
     vkDestroyShaderModule(device, fragment_shader, nullptr);
@@ -120,156 +323,126 @@ bool PTShader::hasDescriptorWithBinding(uint16_t binding, BindingInfo& out, size
     return false;
 }
 
-bool PTShader::readRawAndCompile(string shader_path_stub, vector<char>& vertex_code, vector<char>& fragment_code, vector<char>& geometry_code)
+bool PTShader::readRawAndCompile(string shader_path_stub, bool has_geometry_shader, vector<char>& vertex_code, vector<char>& fragment_code, vector<char>& geometry_code)
 {
-    // run compile commands
-    string compiler = "";
-    string deleter = "";
-    string windows_path_stub = shader_path_stub;
-    string out_path_base = shader_path_stub + "_TEMP_" + to_string((uint32_t)((size_t)this));
-    string windows_out_base = out_path_base;
-#ifdef _WIN32
-    compiler = "glslc";
-    deleter = "del";
-    for (size_t i = 0; i < windows_path_stub.size(); i++)
+    // compile (or fetch from the cache) each stage in turn
+    if (!compileStage(shader_path_stub + ".vert", "vert", vertex_code))
+        return false;
+    if (!compileStage(shader_path_stub + ".frag", "frag", fragment_code))
+        return false;
+    if (has_geometry_shader && !compileStage(shader_path_stub + ".geom", "geom", geometry_code))
+        return false;
+
+    return true;
+}
+
+bool PTShader::compileStage(string source_path, string stage, vector<char>& code)
+{
+    // hash the source along with everything it includes, so edits to common.glsl also invalidate the cache
+    // (and with the defines, since the same source compiles differently in bindless mode)
+    bool bindless = PTResourceManager::get()->usesBindlessTextures();
+    string hash_input = string(SHADER_COMPILER_NAME) + '\0' + stage + '\0' + (bindless ? "BINDLESS_TEXTURES" : "") + '\0';
+    set<string> visited;
+    if (!collectShaderSource(source_path, hash_input, visited, 0))
     {
-        if (windows_path_stub[i] == '/')
-            windows_path_stub[i] = '\\';
+        debugLog("WARNING: unable to open " + source_path);
+        return false;
     }
-    for (size_t i = 0; i < windows_out_base.size(); i++)
+    char hash_str[17];
+    snprintf(hash_str, sizeof(hash_str), "%016llx", (unsigned long long)hashShaderSource(hash_input));
+    string cache_path = string(SHADER_CACHE_PATH) + hash_str + '_' + stage + ".spv";
+
+    // if this exact source has been compiled before, skip the compiler entirely
+    if (readBinaryFile(cache_path, code))
+        return true;
+
+    error_code err;
+    filesystem::create_directories(SHADER_CACHE_PATH, err);
+    // write to a private temporary first, so a parallel compile never sees a half-written cache entry
+    string temp_path = cache_path + ".tmp" + to_string(hash<thread::id>{ }(this_thread::get_id()));
+
+#ifdef PT_USE_SHADERC
+    string source_text;
+    if (!readTextFile(source_path, source_text))
+        return false;
+
+    shaderc_shader_kind kind = shaderc_vertex_shader;
+    if (stage == "frag")
+        kind = shaderc_fragment_shader;
+    else if (stage == "geom")
+        kind = shaderc_geometry_shader;
+    else if (stage == "comp")
+        kind = shaderc_compute_shader;
+
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_include_callbacks(options, resolveShaderInclude, releaseShaderInclude, nullptr);
+    if (bindless)
+        shaderc_compile_options_add_macro_definition(options, "BINDLESS_TEXTURES", 17, nullptr, 0);
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(getShaderCompiler(), source_text.data(), source_text.size(), kind, source_path.c_str(), "main", options);
+    shaderc_compile_options_release(options);
+
+    if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
     {
-        if (windows_out_base[i] == '/')
-            windows_out_base[i] = '\\';
+        debugLog("WARNING: failed to compile " + source_path + ":");
+        debugLog(shaderc_result_get_error_message(result));
+        shaderc_result_release(result);
+        return false;
     }
-#else
-    compiler = "glslc";
-    deleter = "rm";
-#endif
 
+    code.assign(shaderc_result_get_bytes(result), shaderc_result_get_bytes(result) + shaderc_result_get_length(result));
+    shaderc_result_release(result);
+
+    ofstream cache_file(temp_path, ios::binary);
+    if (cache_file.is_open())
+    {
+        cache_file.write(code.data(), code.size());
+        cache_file.close();
+    }
+#else
+    // fall back to running glslc, which writes straight into the cache
     string command_out;
-    string command;
-    int result;
-    
-    // try to compile the vertex shader
-    command = compiler + ' ' + shader_path_stub + ".vert -o " + out_path_base + "_vert.spv";
-    result = exec(command.c_str(), command_out);
+    string command = string(SHADER_COMPILER_NAME) + (bindless ? " -DBINDLESS_TEXTURES " : " ") + source_path + " -o " + temp_path;
+    int result = exec(command.c_str(), command_out);
 
     // if failed, report error
     if (result != 0)
     {
-        debugLog("WARNING: failed to compile " + shader_path_stub + ".vert:");
+        debugLog("WARNING: failed to compile " + source_path + ":");
         debugLog(command_out);
         return false;
     }
 
-    // try to compile the fragment shader
-    command = compiler + ' ' + shader_path_stub + ".frag -o " + out_path_base + "_frag.spv";
-    result = exec(command.c_str(), command_out);
-
-    // if failed, delete the vertex shader and report error
-    if (result != 0)
+    if (!readBinaryFile(temp_path, code))
     {
-        debugLog("WARNING: failed to compile " + shader_path_stub + ".frag:");
-        debugLog(command_out);
-
-        command = deleter + ' ' + windows_out_base + "_vert.spv";
-        system(command.c_str());
+        debugLog("WARNING: unable to open compiled output " + temp_path);
         return false;
     }
+#endif
 
-    // try to compile the geometry shader
-    if (geom_shader_present)
-    {
-        command = compiler + ' ' + shader_path_stub + ".geom -o " + out_path_base + "_geom.spv";
-        result = exec(command.c_str(), command_out);
-
-        // if failed, delete the vertex and fragment shaders and report error
-        if (result != 0)
-        {
-            debugLog("WARNING: failed to compile " + shader_path_stub + ".geom:");
-            debugLog(command_out);
-
-            command = deleter + ' ' + windows_out_base + "_vert.spv";
-            system(command.c_str());
-            command = deleter + ' ' + windows_out_base + "_frag.spv";
-            system(command.c_str());
-            return false;
-        }
-    }
-    
-    // load shader modules using the other function
-    bool load_result = readPrecompiled(out_path_base, vertex_code, fragment_code, geometry_code);
-    
-    // delete the generated files
-    command = deleter + ' ' + windows_out_base + "_vert.spv";
-    system(command.c_str());
-    command = deleter + ' ' + windows_out_base + "_frag.spv";
-    system(command.c_str());
-    if (geom_shader_present)
-    {
-        command = deleter + ' ' + windows_out_base + "_geom.spv";
-        system(command.c_str());
-    }
+    filesystem::rename(temp_path, cache_path, err);
+    if (err)
+        filesystem::remove(temp_path, err);
 
-    return load_result;
+    return true;
 }
 
 bool PTShader::readPrecompiled(const string shader_path_stub, vector<char>& vertex_code, vector<char>& fragment_code, vector<char>& geometry_code)
 {
-    ifstream vert_file, frag_file, geom_file;
-    
-    // open vertex and frag shader files (precompiled)
-    vert_file.open(shader_path_stub + "_vert.spv", ios::ate | ios::binary);
-    if (!vert_file.is_open())
+    // read the whole of each precompiled stage
+    if (!readBinaryFile(shader_path_stub + "_vert.spv", vertex_code))
     {
         debugLog("WARNING: unable to open " + shader_path_stub + "_vert.spv");
         return false;
     }
-    frag_file.open(shader_path_stub + "_frag.spv", ios::ate | ios::binary);
-    if (!frag_file.is_open())
+    if (!readBinaryFile(shader_path_stub + "_frag.spv", fragment_code))
     {
-        vert_file.close();
         debugLog("WARNING: unable to open " + shader_path_stub + "_frag.spv");
         return false;
     }
-    if (geom_shader_present)
+    if (geom_shader_present && !readBinaryFile(shader_path_stub + "_geom.spv", geometry_code))
     {
-        geom_file.open(shader_path_stub + "_geom.spv", ios::ate | ios::binary);
-        if (!geom_file.is_open())
-        {
-            vert_file.close();
-            frag_file.close();
-            debugLog("WARNING: unable to open " + shader_path_stub + "_geom.spv");
-            return false;
-        }
-    }
-
-    // clear and resize the vertex and fragment arrays, then read the whole of each file
-    vertex_code.clear();
-    size_t vert_size = (size_t)vert_file.tellg();
-    vertex_code.resize(vert_size);
-
-    vert_file.seekg(0);
-    vert_file.read(vertex_code.data(), vert_size);
-    vert_file.close();
-
-    fragment_code.clear();
-    size_t frag_size = (size_t)frag_file.tellg();
-    fragment_code.resize(frag_size);
-
-    frag_file.seekg(0);
-    frag_file.read(fragment_code.data(), frag_size);
-    frag_file.close();
-
-    if (geom_shader_present)
-    {
-        geometry_code.clear();
-        size_t geom_size = (size_t)geom_file.tellg();
-        geometry_code.resize(geom_size);
-
-        geom_file.seekg(0);
-        geom_file.read(geometry_code.data(), geom_size);
-        geom_file.close();
+        debugLog("WARNING: unable to open " + shader_path_stub + "_geom.spv");
+        return false;
     }
 
     return true;
@@ -287,24 +460,7 @@ void PTShader::createShaderModules(const vector<char>& vertex_code, const vector
         throw runtime_error("unable to create vertex shader module");
 
     // extract a list of descriptor bindings from the vertex shader
-    SpvReflectShaderModule reflect;
-    spvReflectCreateShaderModule(vertex_code.size(), vertex_code.data(), &reflect);
-    for (size_t i = 0; i < reflect.descriptor_binding_count; i++)
-    {
-        SpvReflectDescriptorBinding binding = reflect.descriptor_bindings[i];
-        BindingInfo descriptor{ binding.name, static_cast<uint16_t>(binding.binding), binding.block.padded_size };
-        if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-            descriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        else if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-            descriptor.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        else
-        {
-            debugLog("ERROR: vertex shader '" + origin_path + "' contains unsupported descriptor of type " + to_string(binding.descriptor_type));
-            continue;
-        }
-        insertDescriptor(descriptor);
-    }
-    spvReflectDestroyShaderModule(&reflect);
+    reflectDescriptors(vertex_code, VK_SHADER_STAGE_VERTEX_BIT, "vertex");
 
     // turn a block of bytes into a frag buffer
     VkShaderModuleCreateInfo frag_create_info{ };
@@ -316,61 +472,71 @@ void PTShader::createShaderModules(const vector<char>& vertex_code, const vector
         throw runtime_error("unable to create fragment shader module");
 
     // extract a list of descriptor bindings from the fragment shader
-    spvReflectCreateShaderModule(fragment_code.size(), fragment_code.data(), &reflect);
+    reflectDescriptors(fragment_code, VK_SHADER_STAGE_FRAGMENT_BIT, "fragment");
+
+    if (geom_shader_present)
+    {
+        // turn a block of bytes into a geom buffer
+        VkShaderModuleCreateInfo geom_create_info{ };
+        geom_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        geom_create_info.codeSize = geometry_code.size();
+        geom_create_info.pCode = reinterpret_cast<const uint32_t*>(geometry_code.data());
+
+        if (vkCreateShaderModule(device, &geom_create_info, nullptr, &geometry_shader) != VK_SUCCESS)
+            throw runtime_error("unable to create geometry shader module");
+
+        // extract a list of descriptor bindings from the geometry shader
+        reflectDescriptors(geometry_code, VK_SHADER_STAGE_GEOMETRY_BIT, "geometry");
+    }
+}
+
+void PTShader::reflectDescriptors(const vector<char>& code, VkShaderStageFlagBits stage, string stage_name)
+{
+    SpvReflectShaderModule reflect;
+    if (spvReflectCreateShaderModule(code.size(), code.data(), &reflect) != SPV_REFLECT_RESULT_SUCCESS)
+        throw runtime_error("unable to reflect " + stage_name + " shader module");
     for (size_t i = 0; i < reflect.descriptor_binding_count; i++)
     {
         SpvReflectDescriptorBinding binding = reflect.descriptor_bindings[i];
+
+        // the scene and texture sets have fixed layouts shared by every shader, so only the material set is ours to build
+        if (binding.set != MATERIAL_DESCRIPTOR_SET)
+        {
+            bool is_scene = (binding.set == SCENE_DESCRIPTOR_SET && binding.binding == SCENE_UNIFORM_BINDING);
+            bool is_texture_array = (binding.set == TEXTURE_DESCRIPTOR_SET && binding.binding == 0 && PTResourceManager::get()->usesBindlessTextures());
+            if (!is_scene && !is_texture_array)
+                debugLog("ERROR: " + stage_name + " shader '" + origin_path + "' has a descriptor in set " + to_string(binding.set) + ", binding " + to_string(binding.binding) + ", which is reserved by the engine. it will be ignored");
+            continue;
+        }
+
         BindingInfo descriptor{ binding.name, static_cast<uint16_t>(binding.binding), binding.block.padded_size };
+        descriptor.stages = stage;
         if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
             descriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         else if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
             descriptor.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         else
         {
-            debugLog("ERROR: fragment shader '" + origin_path + "' contains unsupported descriptor of type " + to_string(binding.descriptor_type));
+            debugLog("ERROR: " + stage_name + " shader '" + origin_path + "' contains unsupported descriptor of type " + to_string(binding.descriptor_type));
             continue;
         }
         insertDescriptor(descriptor);
     }
-    spvReflectDestroyShaderModule(&reflect);
 
-    if (geom_shader_present)
+    // the push constant range is the same for every pipeline, so all we can do is make sure the shader fits in it
+    for (size_t i = 0; i < reflect.push_constant_block_count; i++)
     {
-        // turn a block of bytes into a geom buffer
-        VkShaderModuleCreateInfo geom_create_info{ };
-        geom_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        geom_create_info.codeSize = geometry_code.size();
-        geom_create_info.pCode = reinterpret_cast<const uint32_t*>(geometry_code.data());
-
-        if (vkCreateShaderModule(device, &geom_create_info, nullptr, &geometry_shader) != VK_SUCCESS)
-            throw runtime_error("unable to create geometry shader module");
-
-        // extract a list of descriptor bindings from the geometry shader
-        spvReflectCreateShaderModule(geometry_code.size(), geometry_code.data(), &reflect);
-        for (size_t i = 0; i < reflect.descriptor_binding_count; i++)
-        {
-            SpvReflectDescriptorBinding binding = reflect.descriptor_bindings[i];
-            BindingInfo descriptor{ binding.name, static_cast<uint16_t>(binding.binding), binding.block.padded_size };
-            if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-                descriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            else if (binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-                descriptor.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            else
-            {
-                debugLog("ERROR: geometry shader '" + origin_path + "' contains unsupported descriptor of type " + to_string(binding.descriptor_type));
-                continue;
-            }
-            insertDescriptor(descriptor);
-        }
-        spvReflectDestroyShaderModule(&reflect);
+        if (reflect.push_constant_blocks[i].size > sizeof(TransformConstants))
+            debugLog("ERROR: " + stage_name + " shader '" + origin_path + "' has a push constant block larger than the engine provides (" + to_string(sizeof(TransformConstants)) + " bytes)");
     }
+    spvReflectDestroyShaderModule(&reflect);
 }
 
 void PTShader::createDescriptorSetLayout()
 {
     vector<VkDescriptorSetLayoutBinding> bindings = { };
 
-    // go through all the descriptor bindings which are listed (currently only uniform buffers are supported)
+    // go through all the material descriptor bindings which are listed (uniform buffers and textures)
     // and create descriptor set layout bindings
     for (BindingInfo descriptor : descriptor_bindings)
     {
@@ -378,7 +544,7 @@ void PTShader::createDescriptorSetLayout()
         binding.binding = descriptor.bind_point;
         binding.descriptorType = descriptor.type;
         binding.descriptorCount = 1;
-        binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS; // TODO: detect which stages it's used in and set this to something other than 'absoultely everything'
+        binding.stageFlags = descriptor.stages; // only the stages which actually reference it, from reflection
 
         bindings.push_back(binding);
     }
@@ -395,7 +561,9 @@ void PTShader::createDescriptorSetLayout()
 
 void PTShader::insertDescriptor(BindingInfo descriptor)
 {
-    if (descriptor.bind_point == TRANSFORM_UNIFORM_BINDING
+    // the only engine binding allowed in the material set is the bindless texture index block
+    bool is_texture_indices = (descriptor.bind_point == TEXTURE_INDEX_BINDING && descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && PTResourceManager::get()->usesBindlessTextures());
+    if ((descriptor.bind_point == TEXTURE_INDEX_BINDING && !is_texture_indices)
      || descriptor.bind_point == SCENE_UNIFORM_BINDING)
         return;
     BindingInfo existing;
@@ -408,9 +576,14 @@ void PTShader::insertDescriptor(BindingInfo descriptor)
             debugLog("ERROR: during shader " + origin_path + " loading, multiple descriptors found bound to " + to_string(descriptor.bind_point) + ", with incompatible types. the later one will be ignored");
             return;
         }
-        debugLog("WARNING: during shader " + origin_path + " loading, multiple descriptors found bound to " + to_string(descriptor.bind_point) + ". i will overwrite with the larger one");
+        // the same descriptor being used by several stages is normal, it just needs to be visible to all of them
+        descriptor.stages |= existing.stages;
+        if (descriptor.size != existing.size)
+            debugLog("WARNING: during shader " + origin_path + " loading, multiple descriptors found bound to " + to_string(descriptor.bind_point) + " with different sizes. i will overwrite with the larger one");
         if (existing.size < descriptor.size)
             descriptor_bindings[index] = descriptor;
+        else
+            descriptor_bindings[index].stages = descriptor.stages;
 
         return;
     }
@@ -0,0 +1,221 @@
+#include "shader_watcher.h"
+
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "shader.h"
+#include "debug.h"
+
+using namespace std;
+
+static string normalisePath(const string& path)
+{
+    return filesystem::path(path).lexically_normal().generic_string();
+}
+
+PTShaderWatcher::PTShaderWatcher()
+{
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK);
+    if (inotify_fd < 0)
+        debugLog("WARNING: unable to initialise inotify, shaders will not be hot reloaded");
+#endif
+
+    watch_thread = thread(&PTShaderWatcher::watchLoop, this);
+}
+
+PTShaderWatcher::~PTShaderWatcher()
+{
+    should_stop = true;
+    watch_thread.join();
+
+#ifdef __linux__
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+#endif
+}
+
+void PTShaderWatcher::watch(string shader_path_stub, bool has_geometry_shader)
+{
+    set<string> files;
+    for (string file : PTShader::getSourceFiles(shader_path_stub, has_geometry_shader))
+        files.insert(normalisePath(file));
+
+    lock_guard<mutex> lock(watch_mutex);
+    watched_shaders[shader_path_stub] = WatchedShader{ has_geometry_shader, files };
+    watchFiles(files);
+}
+
+bool PTShaderWatcher::hasResults()
+{
+    lock_guard<mutex> lock(result_mutex);
+    return !results.empty();
+}
+
+vector<PTShaderWatcher::Result> PTShaderWatcher::takeResults()
+{
+    lock_guard<mutex> lock(result_mutex);
+    vector<Result> taken;
+    taken.swap(results);
+    return taken;
+}
+
+void PTShaderWatcher::watchLoop()
+{
+    while (!should_stop)
+    {
+        set<string> changed_files = waitForChanges();
+        if (!changed_files.empty())
+            recompile(changed_files);
+    }
+}
+
+set<string> PTShaderWatcher::waitForChanges()
+{
+    set<string> changed_files;
+
+#ifdef __linux__
+    if (inotify_fd < 0)
+    {
+        this_thread::sleep_for(chrono::milliseconds(250));
+        return changed_files;
+    }
+
+    // wait a little while for something to happen, so we notice when we're asked to stop
+    pollfd poll_fd{ inotify_fd, POLLIN, 0 };
+    if (poll(&poll_fd, 1, 100) <= 0)
+        return changed_files;
+
+    // editors tend to write a file in several goes (or write a temp file and rename it), so keep
+    // draining events until things go quiet
+    alignas(inotify_event) char buffer[4096];
+    do
+    {
+        ssize_t length;
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length;)
+            {
+                inotify_event* event = (inotify_event*)ptr;
+                ptr += sizeof(inotify_event) + event->len;
+                if (event->len == 0)
+                    continue;
+
+                lock_guard<mutex> lock(watch_mutex);
+                auto dir = watched_directories.find(event->wd);
+                if (dir != watched_directories.end())
+                    changed_files.insert(normalisePath(dir->second + '/' + event->name));
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    while (poll(&poll_fd, 1, 0) > 0);
+#else
+    // no inotify here, so fall back to checking modification times every so often
+    this_thread::sleep_for(chrono::milliseconds(250));
+
+    lock_guard<mutex> lock(watch_mutex);
+    for (auto& pair : last_write_times)
+    {
+        error_code err;
+        auto write_time = filesystem::last_write_time(pair.first, err);
+        if (err || write_time == pair.second)
+            continue;
+        pair.second = write_time;
+        changed_files.insert(pair.first);
+    }
+#endif
+
+    return changed_files;
+}
+
+void PTShaderWatcher::recompile(const set<string>& changed_files)
+{
+    // figure out which shaders are affected, then release the lock so registration doesn't stall behind the compiler
+    vector<pair<string, bool>> affected;
+    {
+        lock_guard<mutex> lock(watch_mutex);
+        for (auto& pair : watched_shaders)
+        {
+            for (const string& file : changed_files)
+            {
+                if (pair.second.source_files.contains(file))
+                {
+                    affected.push_back({ pair.first, pair.second.has_geometry_shader });
+                    break;
+                }
+            }
+        }
+    }
+
+    for (auto& shader : affected)
+    {
+        auto start = chrono::high_resolution_clock::now();
+
+        Result result;
+        result.shader_path_stub = shader.first;
+        result.has_geometry_shader = shader.second;
+        if (!PTShader::readRawAndCompile(shader.first, shader.second, result.vertex_code, result.fragment_code, result.geometry_code))
+        {
+            debugLog("WARNING: failed to recompile shader " + shader.first + ", keeping the old one");
+            continue;
+        }
+
+        float ms = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+        debugLog("recompiled shader " + shader.first + " in " + to_string(ms) + "ms");
+
+        {
+            lock_guard<mutex> lock(result_mutex);
+            results.push_back(result);
+        }
+
+        // includes may have changed, so refresh the list of files to watch
+        set<string> files;
+        for (string file : PTShader::getSourceFiles(shader.first, shader.second))
+            files.insert(normalisePath(file));
+
+        lock_guard<mutex> lock(watch_mutex);
+        watched_shaders[shader.first].source_files = files;
+        watchFiles(files);
+    }
+}
+
+void PTShaderWatcher::watchFiles(const set<string>& files)
+{
+    // must be called with the watch mutex held
+#ifdef __linux__
+    if (inotify_fd < 0)
+        return;
+
+    // watch the containing directories rather than the files, so that save-by-rename is caught too
+    for (const string& file : files)
+    {
+        string dir = filesystem::path(file).parent_path().generic_string();
+        if (dir.empty())
+            dir = ".";
+
+        bool already_watched = false;
+        for (auto& pair : watched_directories)
+            already_watched |= (pair.second == dir);
+        if (already_watched)
+            continue;
+
+        int wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd >= 0)
+            watched_directories[wd] = dir;
+    }
+#else
+    for (const string& file : files)
+    {
+        if (last_write_times.contains(file))
+            continue;
+        error_code err;
+        last_write_times[file] = filesystem::last_write_time(file, err);
+    }
+#endif
+}
\ No newline at end of file
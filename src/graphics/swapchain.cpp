@@ -2,6 +2,10 @@
 
 #include <stdexcept>
 
+#include "constant.h"
+#include "image.h"
+#include "resource_manager.h"
+
 using namespace std;
 
 inline uint32_t clamp(uint32_t x, uint32_t mini, uint32_t maxi)
@@ -12,6 +16,19 @@ inline uint32_t clamp(uint32_t x, uint32_t mini, uint32_t maxi)
 
 PTSwapchain::PTSwapchain(VkDevice _device, PTPhysicalDevice& physical_device, VkSurfaceKHR surface, int window_x, int window_y)
 {
+    device = _device;
+
+    // no surface means headless, so make images that look like a swapchain's and leave it at that
+    if (surface == VK_NULL_HANDLE)
+    {
+        surface_format = VkSurfaceFormatKHR{ VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+        image_format = surface_format.format;
+        extent = VkExtent2D{ static_cast<uint32_t>(window_x), static_cast<uint32_t>(window_y) };
+        image_count = MAX_FRAMES_IN_FLIGHT;
+        createOffscreenImages();
+        return;
+    }
+
     // decide on surface format
     for (const auto& format : physical_device.getSwapchainFormats())
     {
@@ -60,7 +77,6 @@ PTSwapchain::PTSwapchain(VkDevice _device, PTPhysicalDevice& physical_device, Vk
 
     surface_present_mode = VK_PRESENT_MODE_FIFO_KHR;
     transform = capabilities.currentTransform;
-    device = _device;
 
     // build and collect
     createSwapchain(surface);
@@ -71,29 +87,58 @@ PTSwapchain::PTSwapchain(VkDevice _device, PTPhysicalDevice& physical_device, Vk
 PTSwapchain::~PTSwapchain()
 {
     // destroy the image views and the swapchain
-    for (auto image_view : image_views)
-        vkDestroyImageView(device, image_view, nullptr);
-
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
+    destroyImages();
 }
 
 void PTSwapchain::resize(VkSurfaceKHR surface, int size_x, int size_y)
 {
     // destroy the image views and the swapchain
-    for (auto image_view : image_views)
-        vkDestroyImageView(device, image_view, nullptr);
-
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
+    bool offscreen = isOffscreen();
+    destroyImages();
 
     // recalculate the extents
     extent = VkExtent2D{ static_cast<uint32_t>(size_x), static_cast<uint32_t>(size_y) };
 
     // rebuild everything
+    if (offscreen)
+    {
+        createOffscreenImages();
+        return;
+    }
     createSwapchain(surface);
 
     collectImages();
 }
 
+void PTSwapchain::destroyImages()
+{
+    for (auto image_view : image_views)
+        vkDestroyImageView(device, image_view, nullptr);
+    image_views.clear();
+
+    if (swapchain != VK_NULL_HANDLE)
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+    swapchain = VK_NULL_HANDLE;
+
+    for (PTImage* image : offscreen_images)
+        image->removeReferencer();
+    offscreen_images.clear();
+}
+
+void PTSwapchain::createOffscreenImages()
+{
+    // transfer dst since the final image is copied in. captures read from the final image, not these
+    images.resize(image_count);
+    offscreen_images.resize(image_count);
+    for (size_t i = 0; i < image_count; i++)
+    {
+        offscreen_images[i] = PTResourceManager::get()->createImage(extent, image_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        images[i] = offscreen_images[i]->getImage();
+    }
+
+    createImageViews();
+}
+
 void PTSwapchain::createSwapchain(VkSurfaceKHR surface)
 {
     // create swapchain using the stashed parameters
@@ -105,7 +150,7 @@ void PTSwapchain::createSwapchain(VkSurfaceKHR surface)
     swap_chain_create_info.imageColorSpace = surface_format.colorSpace;
     swap_chain_create_info.imageExtent = extent;
     swap_chain_create_info.imageArrayLayers = 1;
-    swap_chain_create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    swap_chain_create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     if (sharing_mode == VK_SHARING_MODE_CONCURRENT)
     {
         swap_chain_create_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
@@ -129,6 +174,11 @@ void PTSwapchain::collectImages()
     images.resize(image_count);
     vkGetSwapchainImagesKHR(device, swapchain, &image_count, images.data());
 
+    createImageViews();
+}
+
+void PTSwapchain::createImageViews()
+{
     // create swapchain image views
     image_views.resize(images.size());
     for (size_t i = 0; i < images.size(); i++)
@@ -0,0 +1,177 @@
+#include "texture_table.h"
+
+#include <stdexcept>
+
+#include "image.h"
+#include "sampler.h"
+#include "debug.h"
+
+using namespace std;
+
+PTTextureTable::PTTextureTable(VkDevice _device, uint32_t _capacity)
+{
+    device = _device;
+    capacity = _capacity;
+
+    // one big array binding. partially bound, since most of it will be empty most of the time,
+    // and update-after-bind, so textures can come and go while the set is bound
+    VkDescriptorSetLayoutBinding layout_binding{ };
+    layout_binding.binding = 0;
+    layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    layout_binding.descriptorCount = capacity;
+    layout_binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+    VkDescriptorBindingFlags binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{ };
+    binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_info.bindingCount = 1;
+    binding_flags_info.pBindingFlags = &binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{ };
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.pNext = &binding_flags_info;
+    layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layout_create_info.bindingCount = 1;
+    layout_create_info.pBindings = &layout_binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &layout) != VK_SUCCESS)
+        throw runtime_error("unable to create bindless texture set layout");
+
+    VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity };
+    VkDescriptorPoolCreateInfo pool_create_info{ };
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_create_info.maxSets = 1;
+    pool_create_info.poolSizeCount = 1;
+    pool_create_info.pPoolSizes = &pool_size;
+
+    if (vkCreateDescriptorPool(device, &pool_create_info, nullptr, &pool) != VK_SUCCESS)
+        throw runtime_error("unable to create bindless texture descriptor pool");
+
+    // only one set, shared by every frame. writes only ever go to fresh slots or ones whose last user has been
+    // collected, so they never touch a descriptor a frame in flight might read
+    VkDescriptorSetAllocateInfo set_allocation_info{ };
+    set_allocation_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_allocation_info.descriptorPool = pool;
+    set_allocation_info.descriptorSetCount = 1;
+    set_allocation_info.pSetLayouts = &layout;
+
+    if (vkAllocateDescriptorSets(device, &set_allocation_info, &descriptor_set) != VK_SUCCESS)
+        throw runtime_error("unable to allocate bindless texture descriptor set");
+
+    debugLog("bindless texture table created with " + to_string(capacity) + " slots");
+}
+
+PTTextureTable::~PTTextureTable()
+{
+    // the device is idle by now, so retired slots can go straight away
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        collect(i);
+
+    // anything still in here was leaked by a material, but let go of it anyway
+    for (uint32_t i = 0; i < slots.size(); i++)
+    {
+        if (slots[i].users > 0)
+            freeSlot(i);
+    }
+
+    vkDestroyDescriptorPool(device, pool, nullptr);
+    vkDestroyDescriptorSetLayout(device, layout, nullptr);
+}
+
+uint32_t PTTextureTable::acquire(PTImage* image, PTSampler* sampler, VkImageAspectFlags aspect)
+{
+    auto key = make_tuple(image, sampler, aspect);
+    auto it = slot_lookup.find(key);
+    if (it != slot_lookup.end())
+    {
+        slots[it->second].users++;
+        return it->second;
+    }
+
+    uint32_t index;
+    if (!free_slots.empty())
+    {
+        index = free_slots.back();
+        free_slots.pop_back();
+    }
+    else if (slots.size() < capacity)
+    {
+        index = static_cast<uint32_t>(slots.size());
+        slots.push_back(Slot{ });
+    }
+    else
+        throw runtime_error("bindless texture table is full");
+
+    Slot& slot = slots[index];
+    slot.image = image;
+    slot.sampler = sampler;
+    slot.aspect = aspect;
+    slot.view = image->createImageView(aspect);
+    slot.users = 1;
+    image->addReferencer();
+    sampler->addReferencer();
+    slot_lookup[key] = index;
+
+    // this is the only descriptor write a texture change ever needs
+    VkDescriptorImageInfo image_info{ };
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_info.imageView = slot.view;
+    image_info.sampler = sampler->getSampler();
+
+    VkWriteDescriptorSet write_set{ };
+    write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_set.dstSet = descriptor_set;
+    write_set.dstBinding = 0;
+    write_set.dstArrayElement = index;
+    write_set.descriptorCount = 1;
+    write_set.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write_set.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(device, 1, &write_set, 0, nullptr);
+
+    return index;
+}
+
+void PTTextureTable::release(uint32_t index)
+{
+    if (index >= slots.size() || slots[index].users == 0)
+    {
+        debugLog("WARNING: attempt to release unused bindless texture slot " + to_string(index));
+        return;
+    }
+
+    Slot& slot = slots[index];
+    slot.users--;
+    if (slot.users > 0)
+        return;
+
+    // nothing new will pick up the slot, but frames already submitted may still sample it, so the view
+    // (and the image behind it) has to stay alive until they're done
+    slot_lookup.erase(make_tuple(slot.image, slot.sampler, slot.aspect));
+    retired_slots[current_frame].push_back(index);
+}
+
+void PTTextureTable::collect(uint32_t frame_index)
+{
+    // everything retired here was released before this slot's last submission finished recording, which is done
+    // now. anything submitted before that had already been waited on, and anything recorded since doesn't use it
+    for (uint32_t index : retired_slots[frame_index])
+        freeSlot(index);
+    retired_slots[frame_index].clear();
+
+    // anything released from here on could end up in this frame slot's next submission
+    current_frame = frame_index;
+}
+
+void PTTextureTable::freeSlot(uint32_t index)
+{
+    // shaders won't read the slot any more, so it can just be left dangling until it's reused (that's what
+    // partially bound is for)
+    Slot& slot = slots[index];
+    vkDestroyImageView(device, slot.view, nullptr);
+    slot.image->removeReferencer();
+    slot.sampler->removeReferencer();
+    slot = Slot{ };
+    free_slots.push_back(index);
+}
\ No newline at end of file
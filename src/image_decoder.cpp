@@ -0,0 +1,667 @@
+#include "image_decoder.h"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+
+#include "bitmap.h"
+#include "inflate.h"
+#include "swizzle.h"
+
+using namespace std;
+
+// the 2d image limit on desktop gpus, and far bigger than any texture the engine loads. anything claiming to be
+// larger is corrupt (or hostile), and would only fail trying to allocate it
+static const uint32_t MAX_IMAGE_DIMENSION = 16384;
+// deflate can't do better than about 1032:1, so a png claiming more data than that is lying about its size
+static const size_t MAX_DEFLATE_RATIO = 1032;
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+static inline uint32_t readBE32(const uint8_t* data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+static inline uint16_t readLE16(const uint8_t* data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+// hdr values are all positive, and anything past the largest half just gets clamped to it
+static uint16_t floatToHalf(float value)
+{
+    if (!(value > 0.0f))
+        return 0;
+    if (value >= 65504.0f)
+        return 0x7bff;
+    // below the smallest normal half, store it as a denormal
+    if (value < 6.103515625e-05f)
+        return static_cast<uint16_t>((value * 16777216.0f) + 0.5f);
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    uint32_t exponent = ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = (bits >> 13) & 0x3ff;
+    // round to nearest, which can carry into the exponent
+    if (bits & 0x1000)
+    {
+        mantissa++;
+        if (mantissa == 0x400)
+        {
+            mantissa = 0;
+            exponent++;
+        }
+    }
+    return static_cast<uint16_t>((exponent << 10) | mantissa);
+}
+
+uint32_t imagePixelSize(PTImagePixelFormat format)
+{
+    return (format == PTImagePixelFormat::PIXEL_RGBA16F) ? 8 : 4;
+}
+
+// compression type for bitmaps whose channels are given by masks
+static const uint32_t BMP_BITFIELDS = 3;
+
+static inline bool validImageSize(uint32_t width, uint32_t height)
+{
+    return width > 0 && height > 0 && width <= MAX_IMAGE_DIMENSION && height <= MAX_IMAGE_DIMENSION;
+}
+
+static bool decodeBMP(const vector<uint8_t>& file, const PTImageSink& sink)
+{
+    if (file.size() < sizeof(PTBitmapHeader) + sizeof(PTBitmapInfoHeader))
+        return false;
+
+    PTBitmapHeader header;
+    memcpy(&header, file.data(), sizeof(PTBitmapHeader));
+    PTBitmapInfoHeader info_header;
+    memcpy(&info_header, file.data() + sizeof(PTBitmapHeader), sizeof(PTBitmapInfoHeader));
+
+    // the later (v4/v5) info headers start the same way, they just carry more after it
+    if (info_header.header_size < sizeof(PTBitmapInfoHeader))
+        return false;
+    if (info_header.bits_per_pixel != 24 && info_header.bits_per_pixel != 32)
+        return false;
+
+    // 32 bit v4/v5 bitmaps usually say their channel layout with masks (BI_BITFIELDS) rather than leaving it implied.
+    // the masks come straight after the 40 byte header, either as part of the bigger header or on their own, and only
+    // plain bgr(a) is supported. without an alpha mask the fourth byte is padding
+    bool opaque = false;
+    if (info_header.compresion == BMP_BITFIELDS)
+    {
+        size_t masks_offset = sizeof(PTBitmapHeader) + sizeof(PTBitmapInfoHeader);
+        if (info_header.bits_per_pixel != 32 || file.size() < masks_offset + 12)
+            return false;
+        uint32_t masks[4] = { };
+        memcpy(masks, file.data() + masks_offset, 12);
+        if (info_header.header_size >= sizeof(PTBitmapInfoHeader) + 16 && file.size() >= masks_offset + 16)
+            memcpy(masks + 3, file.data() + masks_offset + 12, 4);
+        if (masks[0] != 0x00ff0000 || masks[1] != 0x0000ff00 || masks[2] != 0x000000ff || (masks[3] != 0xff000000 && masks[3] != 0))
+            return false;
+        opaque = masks[3] == 0;
+    }
+    else if (info_header.compresion != 0)
+        return false;
+    if (info_header.bitmap_width <= 0 || info_header.bitmap_height == 0)
+        return false;
+
+    // a negative height means the rows are stored top-down, otherwise they're bottom-up like the engine wants
+    bool top_down = info_header.bitmap_height < 0;
+    uint32_t width = static_cast<uint32_t>(info_header.bitmap_width);
+    uint32_t height = static_cast<uint32_t>(top_down ? -static_cast<int64_t>(info_header.bitmap_height) : info_header.bitmap_height);
+    if (!validImageSize(width, height))
+        return false;
+    uint32_t bytes_per_pixel = info_header.bits_per_pixel / 8;
+    // rows are padded out to four bytes
+    size_t stride = ((static_cast<size_t>(width) * bytes_per_pixel) + 3) & ~static_cast<size_t>(3);
+    if (header.data_offset > file.size() || file.size() - header.data_offset < stride * height)
+        return false;
+
+    if (!sink.begin(PTImageInfo{ width, height, PTImagePixelFormat::PIXEL_RGBA8 }))
+        return false;
+
+    for (uint32_t r = 0; r < height; r++)
+    {
+        // stored as bgr(a)
+        const uint8_t* in = file.data() + header.data_offset + (r * stride);
+        uint8_t* out = sink.row(top_down ? height - 1 - r : r);
+        if (bytes_per_pixel == 4)
+        {
+            swizzleRGBAToBGRA(in, out, width);
+            if (opaque)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                    out[(x * 4) + 3] = 255;
+            }
+        }
+        else
+            expandBGRToRGBA(in, out, width);
+    }
+
+    return true;
+}
+
+static inline uint8_t paethPredictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return static_cast<uint8_t>(a);
+    if (pb <= pc)
+        return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+// undoes one row's filter in place, prior is the previous row already unfiltered (or null for the first row)
+static bool unfilterPNGRow(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t length, size_t pixel_bytes)
+{
+    switch (filter)
+    {
+    case 0:
+        break;
+    case 1:
+        for (size_t i = pixel_bytes; i < length; i++)
+            row[i] += row[i - pixel_bytes];
+        break;
+    case 2:
+        if (prior)
+        {
+            for (size_t i = 0; i < length; i++)
+                row[i] += prior[i];
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < length; i++)
+        {
+            int left = (i >= pixel_bytes) ? row[i - pixel_bytes] : 0;
+            int up = prior ? prior[i] : 0;
+            row[i] += static_cast<uint8_t>((left + up) / 2);
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < length; i++)
+        {
+            int left = (i >= pixel_bytes) ? row[i - pixel_bytes] : 0;
+            int up = prior ? prior[i] : 0;
+            int up_left = (prior && i >= pixel_bytes) ? prior[i - pixel_bytes] : 0;
+            row[i] += paethPredictor(left, up, up_left);
+        }
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static bool decodePNG(const vector<uint8_t>& file, const PTImageSink& sink)
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t bit_depth = 0;
+    uint8_t colour_type = 0;
+    uint8_t palette[256][4];
+    uint32_t palette_size = 0;
+    // for colour types without alpha, tRNS can name one colour as transparent
+    bool has_transparent_key = false;
+    uint16_t transparent_key[3] = { };
+    vector<uint8_t> compressed;
+
+    size_t position = 8;
+    bool seen_header = false;
+    bool seen_end = false;
+    while (!seen_end && position + 12 <= file.size())
+    {
+        uint32_t length = readBE32(file.data() + position);
+        const uint8_t* type = file.data() + position + 4;
+        const uint8_t* data = file.data() + position + 8;
+        if (length > file.size() - position - 12)
+            return false;
+
+        if (memcmp(type, "IHDR", 4) == 0)
+        {
+            if (length < 13)
+                return false;
+            width = readBE32(data);
+            height = readBE32(data + 4);
+            bit_depth = data[8];
+            colour_type = data[9];
+            // only the default compression and filter methods exist. interlaced images aren't supported
+            if (data[10] != 0 || data[11] != 0 || data[12] != 0)
+                return false;
+            seen_header = true;
+        }
+        else if (memcmp(type, "PLTE", 4) == 0)
+        {
+            palette_size = min(length / 3, 256u);
+            for (uint32_t i = 0; i < palette_size; i++)
+            {
+                palette[i][0] = data[(i * 3) + 0];
+                palette[i][1] = data[(i * 3) + 1];
+                palette[i][2] = data[(i * 3) + 2];
+                palette[i][3] = 255;
+            }
+        }
+        else if (memcmp(type, "tRNS", 4) == 0)
+        {
+            if (colour_type == 3)
+            {
+                for (uint32_t i = 0; i < min(length, palette_size); i++)
+                    palette[i][3] = data[i];
+            }
+            else if (colour_type == 0 && length >= 2)
+            {
+                has_transparent_key = true;
+                transparent_key[0] = (data[0] << 8) | data[1];
+            }
+            else if (colour_type == 2 && length >= 6)
+            {
+                has_transparent_key = true;
+                for (int c = 0; c < 3; c++)
+                    transparent_key[c] = (data[c * 2] << 8) | data[(c * 2) + 1];
+            }
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+            compressed.insert(compressed.end(), data, data + length);
+        else if (memcmp(type, "IEND", 4) == 0)
+            seen_end = true;
+
+        position += length + 12;
+    }
+
+    if (!seen_header || !validImageSize(width, height) || compressed.empty())
+        return false;
+
+    uint32_t channels;
+    switch (colour_type)
+    {
+    case 0: channels = 1; break;
+    case 2: channels = 3; break;
+    case 3: channels = 1; break;
+    case 4: channels = 2; break;
+    case 6: channels = 4; break;
+    default: return false;
+    }
+    bool valid_depth = (bit_depth == 8) || (bit_depth == 16 && colour_type != 3) || ((bit_depth == 1 || bit_depth == 2 || bit_depth == 4) && (colour_type == 0 || colour_type == 3));
+    if (!valid_depth || (colour_type == 3 && palette_size == 0))
+        return false;
+
+    size_t stride = ((static_cast<size_t>(width) * channels * bit_depth) + 7) / 8;
+    size_t pixel_bytes = max<size_t>(1, (channels * bit_depth) / 8);
+
+    // each row is a filter byte followed by the row's bytes
+    if ((stride + 1) * height > compressed.size() * MAX_DEFLATE_RATIO)
+        return false;
+    vector<uint8_t> filtered;
+    filtered.reserve((stride + 1) * height);
+    if (!zlibInflate(compressed.data(), compressed.size(), filtered, (stride + 1) * height) || filtered.size() < (stride + 1) * height)
+        return false;
+    compressed.clear();
+    compressed.shrink_to_fit();
+
+    if (!sink.begin(PTImageInfo{ width, height, PTImagePixelFormat::PIXEL_RGBA8 }))
+        return false;
+
+    const uint8_t* prior = nullptr;
+    uint32_t sample_max = (1u << bit_depth) - 1;
+    for (uint32_t r = 0; r < height; r++)
+    {
+        uint8_t* row = filtered.data() + (r * (stride + 1));
+        if (!unfilterPNGRow(row[0], row + 1, prior, stride, pixel_bytes))
+            return false;
+        prior = row + 1;
+        const uint8_t* in = row + 1;
+
+        // png rows are top-down
+        uint8_t* out = sink.row(height - 1 - r);
+        for (uint32_t x = 0; x < width; x++, out += 4)
+        {
+            // gather this pixel's samples at full precision, then reduce to 8 bits
+            uint16_t samples[4];
+            for (uint32_t c = 0; c < channels; c++)
+            {
+                if (bit_depth == 16)
+                {
+                    size_t offset = ((static_cast<size_t>(x) * channels) + c) * 2;
+                    samples[c] = (in[offset] << 8) | in[offset + 1];
+                }
+                else if (bit_depth == 8)
+                    samples[c] = in[(static_cast<size_t>(x) * channels) + c];
+                else
+                {
+                    size_t bit = static_cast<size_t>(x) * bit_depth;
+                    samples[c] = (in[bit / 8] >> (8 - bit_depth - (bit % 8))) & sample_max;
+                }
+            }
+
+            auto to8 = [&](uint16_t sample) -> uint8_t
+            {
+                if (bit_depth == 16)
+                    return static_cast<uint8_t>(sample >> 8);
+                return static_cast<uint8_t>((sample * 255) / sample_max);
+            };
+
+            switch (colour_type)
+            {
+            case 0:
+                out[0] = out[1] = out[2] = to8(samples[0]);
+                out[3] = (has_transparent_key && samples[0] == transparent_key[0]) ? 0 : 255;
+                break;
+            case 2:
+                out[0] = to8(samples[0]);
+                out[1] = to8(samples[1]);
+                out[2] = to8(samples[2]);
+                out[3] = (has_transparent_key && samples[0] == transparent_key[0] && samples[1] == transparent_key[1] && samples[2] == transparent_key[2]) ? 0 : 255;
+                break;
+            case 3:
+            {
+                uint32_t index = min<uint32_t>(samples[0], palette_size - 1);
+                memcpy(out, palette[index], 4);
+                break;
+            }
+            case 4:
+                out[0] = out[1] = out[2] = to8(samples[0]);
+                out[3] = to8(samples[1]);
+                break;
+            case 6:
+                out[0] = to8(samples[0]);
+                out[1] = to8(samples[1]);
+                out[2] = to8(samples[2]);
+                out[3] = to8(samples[3]);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool decodeTGA(const vector<uint8_t>& file, const PTImageSink& sink)
+{
+    if (file.size() < 18)
+        return false;
+
+    uint8_t id_length = file[0];
+    uint8_t colour_map_type = file[1];
+    uint8_t image_type = file[2];
+    uint16_t colour_map_start = readLE16(&file[3]);
+    uint16_t colour_map_length = readLE16(&file[5]);
+    uint8_t colour_map_bits = file[7];
+    uint32_t width = readLE16(&file[12]);
+    uint32_t height = readLE16(&file[14]);
+    uint8_t pixel_bits = file[16];
+    uint8_t descriptor = file[17];
+
+    bool run_length = image_type >= 9;
+    uint8_t base_type = run_length ? image_type - 8 : image_type;
+    if (base_type < 1 || base_type > 3 || !validImageSize(width, height))
+        return false;
+    if (base_type == 1 && (colour_map_type != 1 || pixel_bits != 8 || (colour_map_bits != 24 && colour_map_bits != 32)))
+        return false;
+    if (base_type == 2 && pixel_bits != 16 && pixel_bits != 24 && pixel_bits != 32)
+        return false;
+    if (base_type == 3 && pixel_bits != 8)
+        return false;
+
+    size_t position = 18 + id_length;
+    uint32_t map_entry_bytes = (colour_map_bits + 7) / 8;
+    const uint8_t* colour_map = file.data() + position;
+    if (colour_map_type == 1)
+        position += static_cast<size_t>(colour_map_length) * map_entry_bytes;
+    if (position > file.size())
+        return false;
+
+    uint32_t pixel_bytes = pixel_bits / 8;
+    auto toRGBA = [&](const uint8_t* in, uint8_t* out) -> bool
+    {
+        if (base_type == 1)
+        {
+            if (in[0] < colour_map_start || in[0] - colour_map_start >= colour_map_length)
+                return false;
+            in = colour_map + ((in[0] - colour_map_start) * map_entry_bytes);
+        }
+        uint32_t bytes = (base_type == 1) ? map_entry_bytes : pixel_bytes;
+
+        if (base_type == 3)
+        {
+            out[0] = out[1] = out[2] = in[0];
+            out[3] = 255;
+        }
+        else if (bytes == 2)
+        {
+            // a1r5g5b5
+            uint16_t packed = readLE16(in);
+            out[0] = static_cast<uint8_t>((((packed >> 10) & 0x1f) * 255) / 31);
+            out[1] = static_cast<uint8_t>((((packed >> 5) & 0x1f) * 255) / 31);
+            out[2] = static_cast<uint8_t>(((packed & 0x1f) * 255) / 31);
+            out[3] = 255;
+        }
+        else
+        {
+            // stored as bgr(a)
+            out[0] = in[2];
+            out[1] = in[1];
+            out[2] = in[0];
+            out[3] = (bytes == 4) ? in[3] : 255;
+        }
+        return true;
+    };
+
+    if (!sink.begin(PTImageInfo{ width, height, PTImagePixelFormat::PIXEL_RGBA8 }))
+        return false;
+
+    // rows are bottom-up unless the descriptor says the origin is at the top, and rle packets are allowed to run
+    // from one row onto the next
+    bool top_down = descriptor & 0x20;
+    bool right_to_left = descriptor & 0x10;
+    uint32_t packet_remaining = 0;
+    bool packet_repeats = false;
+    // plain uncompressed bgr(a) rows can be converted a whole row at a time
+    bool whole_rows = !run_length && base_type == 2 && pixel_bytes >= 3 && !right_to_left;
+    for (uint32_t r = 0; r < height; r++)
+    {
+        uint8_t* out = sink.row(top_down ? height - 1 - r : r);
+        if (whole_rows)
+        {
+            if (position + (static_cast<size_t>(width) * pixel_bytes) > file.size())
+                return false;
+            if (pixel_bytes == 4)
+                swizzleRGBAToBGRA(file.data() + position, out, width);
+            else
+                expandBGRToRGBA(file.data() + position, out, width);
+            position += static_cast<size_t>(width) * pixel_bytes;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < width; i++)
+        {
+            uint32_t x = right_to_left ? width - 1 - i : i;
+            if (run_length && packet_remaining == 0)
+            {
+                if (position >= file.size())
+                    return false;
+                uint8_t packet = file[position++];
+                packet_repeats = packet & 0x80;
+                packet_remaining = (packet & 0x7f) + 1;
+            }
+
+            if (position + pixel_bytes > file.size())
+                return false;
+            if (!toRGBA(file.data() + position, out + (x * 4)))
+                return false;
+
+            if (run_length)
+            {
+                packet_remaining--;
+                // a repeat packet has one pixel value, which is only stepped past once the run is done
+                if (!packet_repeats || packet_remaining == 0)
+                    position += pixel_bytes;
+            }
+            else
+                position += pixel_bytes;
+        }
+    }
+
+    return true;
+}
+
+// reads one scanline of rgbe texels, either flat or in the newer per-component run length encoding
+static bool readHDRScanline(const vector<uint8_t>& file, size_t& position, uint32_t width, uint8_t* rgbe)
+{
+    if (position + 4 > file.size())
+        return false;
+    const uint8_t* start = file.data() + position;
+    bool run_length = width >= 8 && width < 0x8000 && start[0] == 2 && start[1] == 2 && !(start[2] & 0x80);
+    if (!run_length)
+    {
+        if (position + (static_cast<size_t>(width) * 4) > file.size())
+            return false;
+        memcpy(rgbe, start, static_cast<size_t>(width) * 4);
+        position += static_cast<size_t>(width) * 4;
+        // the old style of run length encoding marks runs with a pixel of 1, 1, 1, which isn't supported
+        for (uint32_t x = 0; x < width; x++)
+        {
+            if (rgbe[(x * 4) + 0] == 1 && rgbe[(x * 4) + 1] == 1 && rgbe[(x * 4) + 2] == 1)
+                return false;
+        }
+        return true;
+    }
+
+    if (static_cast<uint32_t>((start[2] << 8) | start[3]) != width)
+        return false;
+    position += 4;
+
+    // each component is stored separately, as runs (count > 128) or literal spans
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        uint32_t x = 0;
+        while (x < width)
+        {
+            if (position >= file.size())
+                return false;
+            uint32_t count = file[position++];
+            if (count > 128)
+            {
+                count -= 128;
+                if (count > width - x || position >= file.size())
+                    return false;
+                uint8_t value = file[position++];
+                for (uint32_t i = 0; i < count; i++, x++)
+                    rgbe[(x * 4) + c] = value;
+            }
+            else
+            {
+                if (count == 0 || count > width - x || position + count > file.size())
+                    return false;
+                for (uint32_t i = 0; i < count; i++, x++)
+                    rgbe[(x * 4) + c] = file[position++];
+            }
+        }
+    }
+    return true;
+}
+
+static bool decodeHDR(const vector<uint8_t>& file, const PTImageSink& sink)
+{
+    // a text header of lines, ending with a blank one, then the resolution line
+    size_t position = 0;
+    auto readLine = [&](string& line) -> bool
+    {
+        line.clear();
+        while (position < file.size() && file[position] != '\n')
+            line.push_back(static_cast<char>(file[position++]));
+        if (position >= file.size())
+            return false;
+        position++;
+        return true;
+    };
+
+    string line;
+    if (!readLine(line) || line.rfind("#?", 0) != 0)
+        return false;
+    while (true)
+    {
+        if (!readLine(line))
+            return false;
+        if (line.empty())
+            break;
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe")
+            return false;
+    }
+
+    // only the standard orientations, rows either top-down (-Y) or bottom-up (+Y), columns left to right
+    if (!readLine(line))
+        return false;
+    char y_sign;
+    char x_sign;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (sscanf(line.c_str(), "%cY %u %cX %u", &y_sign, &height, &x_sign, &width) != 4 || x_sign != '+' || (y_sign != '-' && y_sign != '+'))
+        return false;
+    if (!validImageSize(width, height))
+        return false;
+    bool top_down = y_sign == '-';
+
+    if (!sink.begin(PTImageInfo{ width, height, PTImagePixelFormat::PIXEL_RGBA16F }))
+        return false;
+
+    vector<uint8_t> rgbe(static_cast<size_t>(width) * 4);
+    for (uint32_t r = 0; r < height; r++)
+    {
+        if (!readHDRScanline(file, position, width, rgbe.data()))
+            return false;
+
+        uint16_t* out = reinterpret_cast<uint16_t*>(sink.row(top_down ? height - 1 - r : r));
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint8_t* texel = rgbe.data() + (x * 4);
+            // shared exponent, with the mantissas as 8 bit fractions
+            float scale = (texel[3] == 0) ? 0.0f : ldexpf(1.0f, static_cast<int>(texel[3]) - (128 + 8));
+            out[(x * 4) + 0] = floatToHalf(texel[0] * scale);
+            out[(x * 4) + 1] = floatToHalf(texel[1] * scale);
+            out[(x * 4) + 2] = floatToHalf(texel[2] * scale);
+            out[(x * 4) + 3] = 0x3c00;
+        }
+    }
+
+    return true;
+}
+
+bool decodeImage(const string& path, const PTImageSink& sink)
+{
+    ifstream stream(path, ios::binary | ios::ate);
+    if (!stream.is_open())
+        return false;
+    streamoff end = stream.tellg();
+    if (end < 0)
+        return false;
+    size_t size = static_cast<size_t>(end);
+    stream.seekg(0);
+    vector<uint8_t> file(size);
+    stream.read(reinterpret_cast<char*>(file.data()), size);
+    if (!stream.good())
+        return false;
+    stream.close();
+
+    if (size >= 8 && memcmp(file.data(), PNG_SIGNATURE, 8) == 0)
+        return decodePNG(file, sink);
+    if (size >= 2 && file[0] == 'B' && file[1] == 'M')
+        return decodeBMP(file, sink);
+    if (size >= 2 && file[0] == '#' && file[1] == '?')
+        return decodeHDR(file, sink);
+
+    // tga has no signature, so go by the extension
+    string extension = path.substr(min(path.find_last_of('.'), path.size()));
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".tga")
+        return decodeTGA(file, sink);
+
+    return false;
+}
\ No newline at end of file
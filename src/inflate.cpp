@@ -0,0 +1,304 @@
+#include "inflate.h"
+
+#include <array>
+#include <algorithm>
+
+using namespace std;
+
+static const uint32_t MAX_CODE_BITS = 15;
+
+static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+// the order code length code lengths are stored in, most likely first
+static const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// deflate packs bits starting from the least significant bit of each byte
+struct PTBitReader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    uint64_t buffer = 0;
+    uint32_t count = 0;
+    // reading past the end feeds in zeros, this records that it happened so the caller can bail
+    bool overrun = false;
+
+    inline void refill()
+    {
+        while (count <= 56)
+        {
+            if (position < size)
+                buffer |= static_cast<uint64_t>(data[position]) << count;
+            else if (position >= size + 8)
+                overrun = true;
+            position++;
+            count += 8;
+        }
+    }
+
+    inline uint32_t peek(uint32_t bits)
+    {
+        if (count < bits)
+            refill();
+        return static_cast<uint32_t>(buffer & ((1ull << bits) - 1));
+    }
+
+    inline void consume(uint32_t bits)
+    {
+        buffer >>= bits;
+        count -= bits;
+    }
+
+    inline uint32_t read(uint32_t bits)
+    {
+        if (bits == 0)
+            return 0;
+        uint32_t value = peek(bits);
+        consume(bits);
+        return value;
+    }
+
+    // stored blocks start on a byte boundary, and the bytes after them come straight from the data
+    inline void alignToByte()
+    {
+        consume(count % 8);
+    }
+
+    inline size_t bytePosition() const
+    {
+        return position - (count / 8);
+    }
+
+    inline void seekToByte(size_t byte)
+    {
+        position = byte;
+        buffer = 0;
+        count = 0;
+    }
+};
+
+// a huffman code as one flat table indexed by the next max_bits bits of input. each entry packs the symbol and the
+// code's length (zero where no code lands)
+struct PTHuffmanTable
+{
+    vector<uint16_t> entries;
+    uint32_t max_bits = 0;
+
+    bool build(const uint8_t* lengths, uint32_t symbol_count)
+    {
+        uint32_t length_counts[MAX_CODE_BITS + 1] = { };
+        max_bits = 0;
+        for (uint32_t s = 0; s < symbol_count; s++)
+        {
+            length_counts[lengths[s]]++;
+            max_bits = max(max_bits, static_cast<uint32_t>(lengths[s]));
+        }
+        length_counts[0] = 0;
+
+        // canonical codes: shorter codes come first, and within a length codes go in symbol order
+        uint32_t next_code[MAX_CODE_BITS + 1] = { };
+        uint32_t code = 0;
+        for (uint32_t bits = 1; bits <= MAX_CODE_BITS; bits++)
+        {
+            code = (code + length_counts[bits - 1]) << 1;
+            next_code[bits] = code;
+            if (length_counts[bits] > (1u << bits))
+                return false;
+        }
+
+        entries.assign(static_cast<size_t>(1) << max_bits, 0);
+        for (uint32_t s = 0; s < symbol_count; s++)
+        {
+            uint32_t length = lengths[s];
+            if (length == 0)
+                continue;
+
+            // codes are stored most significant bit first, but the reader hands over bits in the other order
+            uint32_t reversed = 0;
+            uint32_t c = next_code[length]++;
+            for (uint32_t b = 0; b < length; b++)
+                reversed |= ((c >> b) & 1) << (length - 1 - b);
+            if (reversed >= entries.size())
+                return false;
+
+            for (size_t index = reversed; index < entries.size(); index += static_cast<size_t>(1) << length)
+                entries[index] = static_cast<uint16_t>((s << 4) | length);
+        }
+        return true;
+    }
+
+    inline int32_t decode(PTBitReader& reader) const
+    {
+        uint16_t entry = entries[reader.peek(max_bits)];
+        uint32_t length = entry & 0xf;
+        if (length == 0)
+            return -1;
+        reader.consume(length);
+        return entry >> 4;
+    }
+};
+
+static bool readDynamicTables(PTBitReader& reader, PTHuffmanTable& literal_table, PTHuffmanTable& distance_table)
+{
+    uint32_t literal_count = reader.read(5) + 257;
+    uint32_t distance_count = reader.read(5) + 1;
+    uint32_t code_length_count = reader.read(4) + 4;
+    // the fields have room for more codes than deflate defines
+    if (literal_count > 286 || distance_count > 30)
+        return false;
+
+    uint8_t code_length_lengths[19] = { };
+    for (uint32_t i = 0; i < code_length_count; i++)
+        code_length_lengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.read(3));
+    PTHuffmanTable code_length_table;
+    if (!code_length_table.build(code_length_lengths, 19))
+        return false;
+
+    // literal and distance lengths are one run, and repeats are allowed to cross from one into the other
+    array<uint8_t, 286 + 30> lengths{ };
+    uint32_t total = literal_count + distance_count;
+    uint32_t i = 0;
+    while (i < total)
+    {
+        int32_t symbol = code_length_table.decode(reader);
+        if (symbol < 0 || reader.overrun)
+            return false;
+
+        if (symbol < 16)
+        {
+            lengths[i++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t value = 0;
+        uint32_t repeat = 0;
+        if (symbol == 16)
+        {
+            if (i == 0)
+                return false;
+            value = lengths[i - 1];
+            repeat = 3 + reader.read(2);
+        }
+        else if (symbol == 17)
+            repeat = 3 + reader.read(3);
+        else
+            repeat = 11 + reader.read(7);
+
+        if (i + repeat > total)
+            return false;
+        fill(lengths.begin() + i, lengths.begin() + i + repeat, value);
+        i += repeat;
+    }
+
+    if (lengths[256] == 0)
+        return false;
+    return literal_table.build(lengths.data(), literal_count) && distance_table.build(lengths.data() + literal_count, distance_count);
+}
+
+static void buildFixedTables(PTHuffmanTable& literal_table, PTHuffmanTable& distance_table)
+{
+    uint8_t lengths[288];
+    fill(lengths, lengths + 144, 8);
+    fill(lengths + 144, lengths + 256, 9);
+    fill(lengths + 256, lengths + 280, 7);
+    fill(lengths + 280, lengths + 288, 8);
+    literal_table.build(lengths, 288);
+
+    fill(lengths, lengths + 30, 5);
+    distance_table.build(lengths, 30);
+}
+
+static bool inflateBlock(PTBitReader& reader, const PTHuffmanTable& literal_table, const PTHuffmanTable& distance_table, vector<uint8_t>& out, size_t max_out)
+{
+    while (true)
+    {
+        int32_t symbol = literal_table.decode(reader);
+        if (symbol < 0 || reader.overrun)
+            return false;
+
+        if (symbol < 256)
+        {
+            if (out.size() >= max_out)
+                return false;
+            out.push_back(static_cast<uint8_t>(symbol));
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+        uint32_t length = LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+
+        int32_t distance_symbol = distance_table.decode(reader);
+        if (distance_symbol < 0 || distance_symbol >= 30)
+            return false;
+        size_t distance = DISTANCE_BASE[distance_symbol] + reader.read(DISTANCE_EXTRA[distance_symbol]);
+        if (distance > out.size() || length > max_out - min(out.size(), max_out))
+            return false;
+
+        // copies can overlap what they're writing (that's how runs are encoded), so go a byte at a time
+        size_t start = out.size() - distance;
+        for (uint32_t i = 0; i < length; i++)
+            out.push_back(out[start + i]);
+    }
+}
+
+bool zlibInflate(const uint8_t* data, size_t size, vector<uint8_t>& out, size_t max_out)
+{
+    if (size < 2)
+        return false;
+
+    // the zlib header: deflate with a window of at most 32k, no preset dictionary, and a checksum over both bytes
+    uint8_t method = data[0];
+    uint8_t flags = data[1];
+    if ((method & 0x0f) != 8 || (method >> 4) > 7 || (flags & 0x20) || (((method << 8) | flags) % 31) != 0)
+        return false;
+
+    PTBitReader reader{ data + 2, size - 2 };
+    PTHuffmanTable literal_table;
+    PTHuffmanTable distance_table;
+    bool final_block = false;
+    while (!final_block)
+    {
+        final_block = reader.read(1);
+        uint32_t type = reader.read(2);
+
+        if (type == 0)
+        {
+            reader.alignToByte();
+            size_t position = reader.bytePosition();
+            if (position + 4 > reader.size)
+                return false;
+            uint16_t length = reader.data[position] | (reader.data[position + 1] << 8);
+            uint16_t inverse = reader.data[position + 2] | (reader.data[position + 3] << 8);
+            if (length != static_cast<uint16_t>(~inverse) || position + 4 + length > reader.size || length > max_out - min(out.size(), max_out))
+                return false;
+            out.insert(out.end(), reader.data + position + 4, reader.data + position + 4 + length);
+            reader.seekToByte(position + 4 + length);
+        }
+        else if (type == 1)
+        {
+            buildFixedTables(literal_table, distance_table);
+            if (!inflateBlock(reader, literal_table, distance_table, out, max_out))
+                return false;
+        }
+        else if (type == 2)
+        {
+            if (!readDynamicTables(reader, literal_table, distance_table))
+                return false;
+            if (!inflateBlock(reader, literal_table, distance_table, out, max_out))
+                return false;
+        }
+        else
+            return false;
+
+        if (reader.overrun)
+            return false;
+    }
+
+    return true;
+}
\ No newline at end of file
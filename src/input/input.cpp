@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 
 #include "debug.h"
+#include "profiler.h"
 #include "input.h"
 
 using namespace std;
@@ -208,11 +209,15 @@ PTVector2i PTInput::getMousePosition() const
 void PTInput::setMousePosition(PTVector2i position)
 {
     mouse_position = position;
+    if (window == nullptr)
+        return;
     glfwSetCursorPos(window, static_cast<double>(position.x), static_cast<double>(position.y));
 }
 
 void PTInput::setMouseVisible(bool visible)
 {
+    if (window == nullptr)
+        return;
     if (visible) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     else glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
@@ -246,6 +251,10 @@ void PTInput::mouseButtonCallback(GLFWwindow* window, int button, int action, in
 PTInput::PTInput(GLFWwindow* _window)
 {
     window = _window;
+    // headless, so there's nothing to listen to and glfw isn't even initialised. everything just reads as released
+    if (window == nullptr)
+        return;
+
     glfwSetKeyCallback(window, keyboardCallback);
     glfwSetCursorPosCallback(window, cursorCallback);
     glfwSetMouseButtonCallback(window, mouseButtonCallback);
@@ -261,11 +270,13 @@ PTInput::~PTInput()
 {
     should_exit = true;
     
-    mainloop_thread.join();
+    if (mainloop_thread.joinable())
+        mainloop_thread.join();
 }
 
 void PTInput::mainLoop()
 {
+    profileSetThreadName("input");
     while (!should_exit)
     {
         pollGamepads();
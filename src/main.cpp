@@ -6,12 +6,48 @@
 
 using namespace std;
 
+// usage: planetarium [--scene path] [--headless] [--frames n] [--timestep seconds] [--capture path.bmp]
+//                    [--record prefix]
 int main(int argc, char* argv[])
 {
-    debugInit();
+    string scene_path = DEFAULT_SCENE_PATH;
+    PTHeadlessSettings headless;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try
+        {
+            if (arg == "--headless")
+                headless.enabled = true;
+            else if (arg == "--scene" && has_value)
+                scene_path = argv[++i];
+            else if (arg == "--frames" && has_value)
+                headless.frame_count = static_cast<uint32_t>(stoul(argv[++i]));
+            else if (arg == "--timestep" && has_value)
+                headless.timestep = stof(argv[++i]);
+            else if (arg == "--capture" && has_value)
+                headless.capture_path = argv[++i];
+            else if (arg == "--record" && has_value)
+                headless.record_prefix = argv[++i];
+            else
+            {
+                cerr << "unrecognised argument '" << arg << "'" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            cerr << "invalid value for '" << arg << "'" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // there's no terminal to draw the debug ui in on a build machine, so headless just prints the log
+    debugInit(!headless.enabled);
 
     debugLog("Hello, Universe!");
-    PTApplication app = PTApplication(640, 480);
+    PTApplication app = PTApplication(640, 480, scene_path, headless);
     try
     {
         app.start();
@@ -0,0 +1,112 @@
+#include "mipmap.h"
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// 12 bits is plenty to get back to 8 bit srgb without visible banding
+static const uint32_t LINEAR_TO_SRGB_SIZE = 4096;
+
+struct SRGBTables
+{
+    array<float, 256> to_linear;
+    array<uint8_t, LINEAR_TO_SRGB_SIZE> to_srgb;
+
+    SRGBTables()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            to_linear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (uint32_t i = 0; i < LINEAR_TO_SRGB_SIZE; i++)
+        {
+            float l = i / static_cast<float>(LINEAR_TO_SRGB_SIZE - 1);
+            float c = (l <= 0.0031308f) ? l * 12.92f : (1.055f * powf(l, 1.0f / 2.4f)) - 0.055f;
+            to_srgb[i] = static_cast<uint8_t>(clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+    }
+};
+
+static const SRGBTables& getSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    uint32_t largest = max(width, height);
+    while (largest > 1)
+    {
+        largest >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+// each output texel is the average of the (up to) 2x2 block above it. odd edges just reuse the last row/column
+static void downsample(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst, uint32_t dst_width, uint32_t dst_height, bool srgb)
+{
+    const SRGBTables& tables = getSRGBTables();
+    for (uint32_t y = 0; y < dst_height; y++)
+    {
+        const uint8_t* row_0 = src + (static_cast<size_t>(min(y * 2, src_height - 1)) * src_width * 4);
+        const uint8_t* row_1 = src + (static_cast<size_t>(min((y * 2) + 1, src_height - 1)) * src_width * 4);
+        uint8_t* out = dst + (static_cast<size_t>(y) * dst_width * 4);
+        for (uint32_t x = 0; x < dst_width; x++)
+        {
+            size_t x_0 = static_cast<size_t>(min(x * 2, src_width - 1)) * 4;
+            size_t x_1 = static_cast<size_t>(min((x * 2) + 1, src_width - 1)) * 4;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                if (srgb && c < 3)
+                {
+                    float sum = tables.to_linear[row_0[x_0 + c]] + tables.to_linear[row_0[x_1 + c]] + tables.to_linear[row_1[x_0 + c]] + tables.to_linear[row_1[x_1 + c]];
+                    out[(x * 4) + c] = tables.to_srgb[static_cast<uint32_t>(sum * 0.25f * (LINEAR_TO_SRGB_SIZE - 1) + 0.5f)];
+                }
+                else
+                {
+                    uint32_t sum = row_0[x_0 + c] + row_0[x_1 + c] + row_1[x_0 + c] + row_1[x_1 + c];
+                    out[(x * 4) + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+vector<PTMipLevel> mipChainLayoutRGBA8(uint32_t width, uint32_t height)
+{
+    vector<PTMipLevel> levels(mipLevelCount(width, height));
+    size_t offset = 0;
+    uint32_t w = width;
+    uint32_t h = height;
+    for (PTMipLevel& level : levels)
+    {
+        level = PTMipLevel{ w, h, offset };
+        offset += static_cast<size_t>(w) * h * 4;
+        w = max(w / 2, 1u);
+        h = max(h / 2, 1u);
+    }
+    return levels;
+}
+
+size_t mipChainSizeRGBA8(const vector<PTMipLevel>& levels)
+{
+    if (levels.empty())
+        return 0;
+    return levels.back().offset + (static_cast<size_t>(levels.back().width) * levels.back().height * 4);
+}
+
+void generateMipChainRGBA8(uint8_t* chain, const vector<PTMipLevel>& levels, bool srgb)
+{
+    for (size_t i = 1; i < levels.size(); i++)
+    {
+        const PTMipLevel& src = levels[i - 1];
+        const PTMipLevel& dst = levels[i];
+        downsample(chain + src.offset, src.width, src.height, chain + dst.offset, dst.width, dst.height, srgb);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "profiler.h"
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <format>
+#include <algorithm>
+
+#include "debug.h"
+
+using namespace std;
+
+struct ProfileEvent
+{
+    const char* name = nullptr;
+    uint64_t start = 0;
+    uint64_t end = 0;
+};
+
+// enough for a good few seconds of frames. once it's full the oldest zones are overwritten
+static const size_t EVENT_CAPACITY = 1 << 15;
+
+// only the owning thread writes to a buffer. a dump running on another thread copies the events out and then checks
+// head again, throwing away any slot the thread may have started overwriting in the meantime
+struct ThreadBuffer
+{
+    array<ProfileEvent, EVENT_CAPACITY> events;
+    atomic<uint64_t> head = 0;
+    uint32_t id = 0;
+    string name;
+};
+
+// buffers are never freed, so zones from threads which have exited still make it into the trace
+static mutex registry_mutex;
+static vector<unique_ptr<ThreadBuffer>> registry;
+static thread_local ThreadBuffer* local_buffer = nullptr;
+
+static ThreadBuffer* getLocalBuffer()
+{
+    // only the first zone on each thread takes the lock
+    if (local_buffer == nullptr)
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        registry.push_back(make_unique<ThreadBuffer>());
+        local_buffer = registry.back().get();
+        local_buffer->id = static_cast<uint32_t>(registry.size());
+        local_buffer->name = "thread " + to_string(local_buffer->id);
+    }
+    return local_buffer;
+}
+
+uint64_t profileNow()
+{
+    static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count());
+}
+
+void profileRecord(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+    ThreadBuffer* buffer = getLocalBuffer();
+    uint64_t index = buffer->head.load(memory_order_relaxed);
+    // keeps the overwrite from being seen before the head that says it's coming
+    atomic_thread_fence(memory_order_release);
+    buffer->events[index % EVENT_CAPACITY] = ProfileEvent{ name, start_ns, end_ns };
+    buffer->head.store(index + 1, memory_order_release);
+}
+
+void profileSetThreadName(string name)
+{
+    ThreadBuffer* buffer = getLocalBuffer();
+    lock_guard<mutex> lock(registry_mutex);
+    buffer->name = name;
+}
+
+static string escapeJSON(const string& text)
+{
+    string out;
+    out.reserve(text.size());
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+
+bool profileDumpTrace(string path)
+{
+#ifndef PT_PROFILING_ENABLED
+    debugLog("WARNING: this build has profiling compiled out, the trace will be empty");
+#endif
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        debugLog("WARNING: unable to open trace file '" + path + "'");
+        return false;
+    }
+
+    // chrome trace format: a thread name record for each thread, then one complete ("X") event per zone.
+    // times are in microseconds
+    size_t event_count = 0;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    lock_guard<mutex> lock(registry_mutex);
+    for (const unique_ptr<ThreadBuffer>& buffer : registry)
+    {
+        file << (first ? "" : ",") << "\n" << format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", buffer->id, escapeJSON(buffer->name));
+        first = false;
+
+        // copy the ring out before formatting any of it, since that's slow enough for a busy thread to lap the
+        // whole buffer. the write of event n overwrites event n - EVENT_CAPACITY, so anything at or below
+        // head_after - EVENT_CAPACITY may have been torn while it was copied
+        uint64_t head = buffer->head.load(memory_order_acquire);
+        uint64_t copied = (head > EVENT_CAPACITY) ? head - EVENT_CAPACITY : 0;
+        vector<ProfileEvent> events(head - copied);
+        for (uint64_t i = copied; i < head; i++)
+            events[i - copied] = buffer->events[i % EVENT_CAPACITY];
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t head_after = buffer->head.load(memory_order_relaxed);
+        uint64_t oldest = (head_after >= EVENT_CAPACITY) ? max(copied, head_after - EVENT_CAPACITY + 1) : copied;
+
+        for (uint64_t i = oldest; i < head; i++)
+        {
+            const ProfileEvent& event = events[i - copied];
+            file << ",\n" << format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}", escapeJSON(event.name), buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+            event_count++;
+        }
+    }
+    file << "\n]}\n";
+
+    debugLog("wrote " + to_string(event_count) + " profile zones to '" + path + "'");
+    return true;
+}
\ No newline at end of file
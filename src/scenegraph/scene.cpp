@@ -4,6 +4,7 @@
 
 #include "application.h"
 #include "debug.h"
+#include "profiler.h"
 #include "math/ptmath.h"
 #include "graphics/resource_manager.h"
 #include "input/input.h"
@@ -52,6 +53,7 @@ void PTScene::addResource(std::string identifier, PTResource* resource)
 
 void PTScene::update(float delta_time)
 {
+    PT_PROFILE_ZONE("PTScene::update");
     for (auto pair : all_nodes)
         pair.second->process(delta_time);
 }
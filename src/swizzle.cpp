@@ -0,0 +1,85 @@
+#include "swizzle.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+void swizzleRGBAToBGRA(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    for (; i + 8 <= pixels; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + (i * 4)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + (i * 4)), _mm256_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 4)), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    // no byte shuffle, but swapping bytes 0 and 2 of each 32 bit lane is just masks and shifts
+    const __m128i keep = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+    const __m128i low = _mm_set1_epi32(0x000000ff);
+    for (; i + 4 <= pixels; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+        __m128i swapped = _mm_or_si128(_mm_and_si128(v, keep), _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low), _mm_slli_epi32(_mm_and_si128(v, low), 16)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 4)), swapped);
+    }
+#endif
+    for (; i < pixels; i++)
+    {
+        uint8_t r = src[(i * 4) + 0];
+        uint8_t b = src[(i * 4) + 2];
+        dst[(i * 4) + 0] = b;
+        dst[(i * 4) + 1] = src[(i * 4) + 1];
+        dst[(i * 4) + 2] = r;
+        dst[(i * 4) + 3] = src[(i * 4) + 3];
+    }
+}
+
+void expandBGRToRGBA(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // four pixels (12 bytes) per load, so only run while there's a full 16 bytes left to read
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+    for (; i + 6 <= pixels; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 3)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 4)), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+#endif
+    for (; i < pixels; i++)
+    {
+        dst[(i * 4) + 0] = src[(i * 3) + 2];
+        dst[(i * 4) + 1] = src[(i * 3) + 1];
+        dst[(i * 4) + 2] = src[(i * 3) + 0];
+        dst[(i * 4) + 3] = 255;
+    }
+}
+
+const char* swizzleKernelName()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSSE3__)
+    return "ssse3";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
\ No newline at end of file
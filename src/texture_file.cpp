@@ -0,0 +1,118 @@
+#include "texture_file.h"
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#include "mipmap.h"
+
+using namespace std;
+
+static const uint32_t TEXTURE_FILE_VERSION = 1;
+
+uint32_t textureFormatBlockBytes(PTTextureFormat format)
+{
+    switch (format)
+    {
+    case PTTextureFormat::BC1: return 8;
+    case PTTextureFormat::BC3:
+    case PTTextureFormat::BC5:
+    case PTTextureFormat::BC7: return 16;
+    default: return 4;
+    }
+}
+
+bool textureFormatIsCompressed(PTTextureFormat format)
+{
+    return format != PTTextureFormat::RGBA8;
+}
+
+size_t textureLevelSize(PTTextureFormat format, uint32_t width, uint32_t height)
+{
+    if (!textureFormatIsCompressed(format))
+        return static_cast<size_t>(width) * height * 4;
+
+    // partial blocks at the edges still take up a whole block
+    size_t blocks_x = (width + 3) / 4;
+    size_t blocks_y = (height + 3) / 4;
+    return blocks_x * blocks_y * textureFormatBlockBytes(format);
+}
+
+bool writeTextureFile(string path, const PTTextureFile& texture)
+{
+    if (texture.width == 0 || texture.height == 0 || texture.levels.empty())
+        return false;
+
+    ofstream file(path, ios::binary);
+    if (!file.is_open())
+        return false;
+
+    PTTextureFileHeader header;
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = texture.format;
+    header.srgb = texture.srgb ? 1 : 0;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.mip_count = static_cast<uint32_t>(texture.levels.size());
+
+    file.write((char*)(&header), sizeof(PTTextureFileHeader));
+    file.write((char*)(texture.levels.data()), sizeof(PTTextureFileLevel) * texture.levels.size());
+    file.write((char*)(texture.data.data()), texture.data.size());
+
+    return file.good();
+}
+
+bool readTextureFile(string path, PTTextureFile& texture)
+{
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file.is_open())
+        return false;
+    streamoff end = file.tellg();
+    if (end < 0)
+        return false;
+    size_t file_size = static_cast<size_t>(end);
+    file.seekg(0);
+
+    if (file_size < sizeof(PTTextureFileHeader))
+        return false;
+    PTTextureFileHeader header;
+    file.read((char*)(&header), sizeof(PTTextureFileHeader));
+    if (memcmp(header.magic, "PTTX", 4) != 0 || header.version != TEXTURE_FILE_VERSION)
+        return false;
+    if (header.format > PTTextureFormat::BC7 || header.width == 0 || header.height == 0 || header.mip_count == 0)
+        return false;
+    if (header.mip_count > mipLevelCount(header.width, header.height))
+        return false;
+
+    size_t table_size = sizeof(PTTextureFileLevel) * header.mip_count;
+    if (file_size < sizeof(PTTextureFileHeader) + table_size)
+        return false;
+    texture.levels.resize(header.mip_count);
+    file.read((char*)(texture.levels.data()), table_size);
+
+    size_t data_size = file_size - sizeof(PTTextureFileHeader) - table_size;
+    texture.data.resize(data_size);
+    file.read((char*)(texture.data.data()), data_size);
+    if (!file.good())
+        return false;
+
+    texture.format = static_cast<PTTextureFormat>(header.format);
+    texture.srgb = header.srgb != 0;
+    texture.width = header.width;
+    texture.height = header.height;
+
+    // every level has to be the size its place in the chain says, since that's what gets copied into the image, and
+    // lie entirely inside the data
+    for (uint32_t i = 0; i < header.mip_count; i++)
+    {
+        const PTTextureFileLevel& level = texture.levels[i];
+        if (level.width != max(header.width >> i, 1u) || level.height != max(header.height >> i, 1u))
+            return false;
+        if (level.size != textureLevelSize(texture.format, level.width, level.height))
+            return false;
+        if (level.offset > data_size || level.size > data_size - level.offset)
+            return false;
+    }
+
+    return true;
+}
\ No newline at end of file